@@ -158,7 +158,7 @@ function Compile {
         0 {
             Write-Host -ForegroundColor Blue "Using GCC on Windows from Chocolatey"
             # Includepath = "C:/Program Files (x86)/Windows Kits/10/Include/10.0.22000.0/"
-            C:/ProgramData/Chocolatey/bin/g++.exe -std=c++20 $OOption $WallOption -I"C:/msys64/mingw64/include" -I$IncludePath -o"./output/app.exe" "$LocationPath/src/main.cpp" -static -pthread -g
+            C:/ProgramData/Chocolatey/bin/g++.exe -std=c++20 $OOption $WallOption -I"C:/msys64/mingw64/include" -I$IncludePath -o"./output/app.exe" "$LocationPath/src/main.cpp" "$LocationPath/src/lib/terminal.cpp" -static -pthread -g
         }
         1 {
             Write-Host -ForegroundColor Blue "Using Clang"
@@ -176,7 +176,7 @@ function Compile {
             if($env:Path.Contains("C:/msys64/mingw64/bin") -eq $false) {
                 $env:Path += ';C:/msys64/mingw64/bin'
             }
-            C:/msys64/mingw64/bin/g++.exe -std=c++20 $OOption $WallOption -I$IncludePath -o"./output/app.exe" "$LocationPath/src/main.cpp" -g
+            C:/msys64/mingw64/bin/g++.exe -std=c++20 $OOption $WallOption -I$IncludePath -o"./output/app.exe" "$LocationPath/src/main.cpp" "$LocationPath/src/lib/terminal.cpp" -g
         }
         default {
             Write-Host -ForegroundColor Blue "Invalid compiler, Compiler number $Compiler is not configured"
@@ -186,15 +186,15 @@ function Compile {
         switch($Compiler) {
             0 {
                 Write-Host -ForegroundColor Blue "Using GCC-11 on Linux"
-                g++-11 -std=c++20 $OOption $WallOption -o 'output/app' "./src/main.cpp" -pthread -lpthread -g
+                g++-11 -std=c++20 $OOption $WallOption -o 'output/app' "./src/main.cpp" "./src/lib/terminal.cpp" -pthread -lpthread -g
             }
             1 {
                 Write-Host -ForegroundColor Blue "Using GCC-system on Linux"
-                g++-11 -std=c++20 $OOption $WallOption -o 'output/app' "./src/main.cpp" -g
+                g++-11 -std=c++20 $OOption $WallOption -o 'output/app' "./src/main.cpp" "./src/lib/terminal.cpp" -g
             }
             2 {
                 Write-Host -ForegroundColor Blue "Using Clang on Linux"
-                clang++ -std=c++20 $OOption $WallOption -iquote -I"/usr/lib/clang/10/include" -o 'output/app' "./src/main.cpp" -g
+                clang++ -std=c++20 $OOption $WallOption -iquote -I"/usr/lib/clang/10/include" -o 'output/app' "./src/main.cpp" "./src/lib/terminal.cpp" -g
             }
             default {
                 Write-Host -ForegroundColor Blue "$Compiler is not supported"
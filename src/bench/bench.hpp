@@ -0,0 +1,247 @@
+#ifndef BENCHHPP
+#define BENCHHPP
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// Minimal self contained microbenchmark harness
+//
+// A benchmark is a function running its body n times. The harness doubles n until a run takes at least min_time,
+// runs it warmup times, then times repetitions runs and summarizes the time per iteration.
+namespace bench {
+
+    namespace detail {
+#if defined(_MSC_VER) && !defined(__clang__)
+        inline volatile const void* sink;
+#endif
+    }
+
+    // Makes the compiler assume value is read, so the computation producing it can not be removed
+    template<typename T>
+    inline void do_not_optimize(const T &value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        detail::sink = &value;
+        _ReadWriteBarrier();
+#else
+        asm volatile("" : : "r,m"(value) : "memory");
+#endif
+    }
+
+    // Makes the compiler assume all memory is read and written, so stores can not be removed or moved across it
+    inline void clobber() {
+#if defined(_MSC_VER) && !defined(__clang__)
+        _ReadWriteBarrier();
+#else
+        asm volatile("" : : : "memory");
+#endif
+    }
+
+    struct Options {
+        std::size_t warmup = 2;
+        std::size_t repetitions = 25;
+        // Seconds a single repetition should at least take
+        double min_time = 0.005;
+        // Only benchmarks whose name contains filter run
+        std::string filter;
+        // Path of the JSON report, empty for none
+        std::string json;
+    };
+
+    // Times are in nanoseconds per iteration
+    struct Result {
+        std::string name;
+        std::size_t iterations = 0;
+        std::size_t repetitions = 0;
+        // Work items per iteration, used for the throughput column
+        std::size_t items = 1;
+        double min = 0;
+        double mean = 0;
+        double median = 0;
+        double p99 = 0;
+        // Median absolute deviation from the median
+        double mad = 0;
+    };
+
+    struct Benchmark {
+        std::string name;
+        std::size_t items;
+        std::function<void(std::size_t)> run;
+    };
+
+    inline std::vector<Benchmark>& registry() {
+        static std::vector<Benchmark> benchmarks;
+        return benchmarks;
+    }
+
+    // Registers a benchmark, run(n) has to execute the measured body n times
+    inline void add(std::string name, std::function<void(std::size_t)> run, std::size_t items = 1) {
+        registry().push_back(Benchmark{ std::move(name), items, std::move(run) });
+    }
+
+    // Returns the median of sorted values
+    inline double median(const std::vector<double> &sorted) {
+        std::size_t n = sorted.size();
+        if (n == 0) {
+            return 0;
+        }
+        return n % 2 == 1 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+    }
+
+    // Returns the nearest rank percentile p in [0, 1] of sorted values
+    inline double percentile(const std::vector<double> &sorted, double p) {
+        if (sorted.empty()) {
+            return 0;
+        }
+        std::size_t rank = (std::size_t)std::ceil(p * (double)sorted.size());
+        return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+    }
+
+    // Summarizes the nanoseconds per iteration of every repetition
+    inline Result summarize(std::string name, std::vector<double> samples, std::size_t iterations, std::size_t items) {
+        Result result;
+        result.name = std::move(name);
+        result.iterations = iterations;
+        result.repetitions = samples.size();
+        result.items = items;
+        if (samples.empty()) {
+            return result;
+        }
+        std::sort(samples.begin(), samples.end());
+        double sum = 0;
+        for (double s : samples) {
+            sum += s;
+        }
+        result.min = samples.front();
+        result.mean = sum / (double)samples.size();
+        result.median = median(samples);
+        result.p99 = percentile(samples, 0.99);
+        std::vector<double> deviations;
+        deviations.reserve(samples.size());
+        for (double s : samples) {
+            deviations.push_back(std::abs(s - result.median));
+        }
+        std::sort(deviations.begin(), deviations.end());
+        result.mad = median(deviations);
+        return result;
+    }
+
+    // Returns the seconds a single run of n iterations takes
+    inline double time(const Benchmark &benchmark, std::size_t n) {
+        auto begin = std::chrono::steady_clock::now();
+        benchmark.run(n);
+        clobber();
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double>(end - begin).count();
+    }
+
+    inline Result run(const Benchmark &benchmark, const Options &options) {
+        std::size_t n = 1;
+        while (time(benchmark, n) < options.min_time && n < ((std::size_t)1 << 40)) {
+            n *= 2;
+        }
+        for (std::size_t i = 0; i < options.warmup; i++) {
+            time(benchmark, n);
+        }
+        std::vector<double> samples;
+        samples.reserve(options.repetitions);
+        for (std::size_t i = 0; i < options.repetitions; i++) {
+            samples.push_back(time(benchmark, n) * 1e9 / (double)n);
+        }
+        return summarize(benchmark.name, std::move(samples), n, benchmark.items);
+    }
+
+    // Writes the results as a JSON document for comparing runs
+    inline void write_json(std::ostream &out, const std::vector<Result> &results) {
+        auto number = [&](double value) {
+            char buffer[32];
+            std::to_chars_result r = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            out.write(buffer, r.ptr - buffer);
+        };
+        out << "{\n  \"unit\": \"ns\",\n  \"benchmarks\": [";
+        for (std::size_t i = 0; i < results.size(); i++) {
+            const Result &r = results[i];
+            out << (i > 0 ? ",\n" : "\n") << "    { \"name\": \"";
+            for (char c : r.name) {
+                if (c == '"' || c == '\\') {
+                    out << '\\';
+                }
+                out << c;
+            }
+            out << "\", \"iterations\": " << r.iterations << ", \"repetitions\": " << r.repetitions << ", \"items\": " << r.items;
+            out << ", \"min\": "; number(r.min);
+            out << ", \"mean\": "; number(r.mean);
+            out << ", \"median\": "; number(r.median);
+            out << ", \"p99\": "; number(r.p99);
+            out << ", \"mad\": "; number(r.mad);
+            out << " }";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    // Parses --filter=, --json=, --repetitions=, --warmup= and --min-time=
+    inline Options parse_options(int argc, char** argv) {
+        Options options;
+        for (int i = 1; i < argc; i++) {
+            std::string_view arg = argv[i];
+            auto value = [&](std::string_view prefix, std::string_view &out) {
+                if (arg.substr(0, prefix.size()) == prefix) {
+                    out = arg.substr(prefix.size());
+                    return true;
+                }
+                return false;
+            };
+            std::string_view v;
+            if (value("--filter=", v)) {
+                options.filter = v;
+            } else if (value("--json=", v)) {
+                options.json = v;
+            } else if (value("--repetitions=", v)) {
+                std::from_chars(v.data(), v.data() + v.size(), options.repetitions);
+            } else if (value("--warmup=", v)) {
+                std::from_chars(v.data(), v.data() + v.size(), options.warmup);
+            } else if (value("--min-time=", v)) {
+                options.min_time = std::stod(std::string(v));
+            } else {
+                std::fprintf(stderr, "Unknown option %s\n", argv[i]);
+            }
+        }
+        options.repetitions = std::max<std::size_t>(options.repetitions, 1);
+        return options;
+    }
+
+    // Runs every registered benchmark matching the filter, prints a table and writes the JSON report if requested
+    inline std::vector<Result> run_all(const Options &options) {
+        std::vector<Result> results;
+        std::printf("%-36s %12s %12s %12s %10s %14s\n", "benchmark", "median ns", "p99 ns", "mad ns", "mad %", "items/s");
+        for (const Benchmark &benchmark : registry()) {
+            if (!options.filter.empty() && benchmark.name.find(options.filter) == std::string::npos) {
+                continue;
+            }
+            Result r = run(benchmark, options);
+            double rate = r.median > 0 ? (double)r.items * 1e9 / r.median : 0;
+            std::printf("%-36s %12.2f %12.2f %12.2f %9.2f%% %14.4g\n", r.name.c_str(), r.median, r.p99, r.mad, r.median > 0 ? r.mad * 100 / r.median : 0, rate);
+            std::fflush(stdout);
+            results.push_back(std::move(r));
+        }
+        if (!options.json.empty()) {
+            std::ofstream out(options.json);
+            write_json(out, results);
+        }
+        return results;
+    }
+}
+
+#endif
@@ -0,0 +1,193 @@
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "bench.hpp"
+
+#include "../lib/ansi.hpp"
+#include "../lib/escape.hpp"
+#include "../lib/math.hpp"
+#include "../lib/vector.hpp"
+
+// Benchmarks for vector.hpp, math and the ansi writers
+// Usage: bench [--filter=text] [--json=path] [--repetitions=n] [--warmup=n] [--min-time=seconds]
+
+namespace {
+
+    // Vectors per benchmark iteration, small enough to stay in L1
+    constexpr std::size_t count = 256;
+
+    template<typename T, std::size_t N>
+    struct Data {
+        std::vector<Vec<T, N>> a;
+        std::vector<Vec<T, N>> b;
+        std::vector<T> s;
+    };
+
+    template<typename T, std::size_t N>
+    std::shared_ptr<const Data<T, N>> make_data(unsigned seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<double> dist(0.5, 2.0);
+        auto data = std::make_shared<Data<T, N>>();
+        data->a.resize(count);
+        data->b.resize(count);
+        data->s.resize(count);
+        for (std::size_t i = 0; i < count; i++) {
+            for (std::size_t k = 0; k < N; k++) {
+                data->a[i].get(k) = (T)dist(rng);
+                data->b[i].get(k) = (T)dist(rng);
+            }
+            data->s[i] = (T)dist(rng);
+        }
+        return data;
+    }
+
+    // Registers out[i] = f(a[i], b[i], s[i]) over count vectors
+    template<typename T, std::size_t N, typename F>
+    void add_op(const std::string &name, std::shared_ptr<const Data<T, N>> data, F f) {
+        using R = decltype(f(data->a[0], data->b[0], data->s[0]));
+        // std::vector<bool> packs bits, which would time the packing instead
+        using Stored = std::conditional_t<std::is_same_v<R, bool>, char, R>;
+        bench::add(name, [data, f, out = std::vector<Stored>(count)](std::size_t n) mutable {
+            for (std::size_t r = 0; r < n; r++) {
+                for (std::size_t i = 0; i < count; i++) {
+                    out[i] = f(data->a[i], data->b[i], data->s[i]);
+                }
+                bench::clobber();
+            }
+            bench::do_not_optimize(out.data());
+        }, count);
+    }
+
+    template<typename T, std::size_t N>
+    void vec_benchmarks(const std::string &type) {
+        using V = Vec<T, N>;
+        const std::string prefix = "vec" + std::to_string(N) + type + "/";
+        auto data = make_data<T, N>(N * 7 + sizeof(T));
+
+        add_op(prefix + "add", data, [](const V &a, const V &b, T) { return a + b; });
+        add_op(prefix + "sub", data, [](const V &a, const V &b, T) { return a - b; });
+        add_op(prefix + "mul", data, [](const V &a, const V &b, T) { return a * b; });
+        add_op(prefix + "div", data, [](const V &a, const V &b, T) { return a / b; });
+        add_op(prefix + "scale", data, [](const V &a, const V &, T s) { return a * s; });
+        add_op(prefix + "negate", data, [](const V &a, const V &, T) { return -a; });
+        add_op(prefix + "equal", data, [](const V &a, const V &b, T) { return a == b; });
+        add_op(prefix + "lazy", data, [](const V &a, const V &b, T) { return V(lazy(a) + b * a - b); });
+        add_op(prefix + "dot", data, [](const V &a, const V &b, T) { return a.dot(b); });
+        add_op(prefix + "cross", data, [](const V &a, const V &b, T) { return a.cross(b); });
+        add_op(prefix + "length_squared", data, [](const V &a, const V &, T) { return a.length_squared(); });
+        add_op(prefix + "length", data, [](const V &a, const V &, T) { return a.length(); });
+        add_op(prefix + "normalize", data, [](const V &a, const V &, T) { return a.normalize(); });
+        add_op(prefix + "normalize_fast", data, [](const V &a, const V &, T) { return a.normalize_fast(); });
+        add_op(prefix + "distance", data, [](const V &a, const V &b, T) { return a.distance(b); });
+        add_op(prefix + "angle", data, [](const V &a, const V &b, T) { return a.angle(b); });
+    }
+
+    template<typename T>
+    void vec_benchmarks_all(const std::string &type) {
+        vec_benchmarks<T, 2>(type);
+        vec_benchmarks<T, 3>(type);
+        vec_benchmarks<T, 4>(type);
+        vec_benchmarks<T, 5>(type);
+        vec_benchmarks<T, 6>(type);
+    }
+
+    template<typename T>
+    void math_benchmarks(const std::string &type) {
+        auto data = make_data<T, 1>(11);
+        add_op("math/fast_inverse_sqrt_" + type, data, [](const Vec<T, 1> &a, const Vec<T, 1> &, T) { return math::fast_inverse_sqrt(a.get(0)); });
+        add_op("math/fast_inverse_sqrt_" + type + "_3", data, [](const Vec<T, 1> &a, const Vec<T, 1> &, T) { return math::fast_inverse_sqrt(a.get(0), 3); });
+        add_op("math/inverse_sqrt_" + type + "_std", data, [](const Vec<T, 1> &a, const Vec<T, 1> &, T) { return (T)1 / std::sqrt(a.get(0)); });
+
+        std::vector<T> in(count);
+        for (std::size_t i = 0; i < count; i++) {
+            in[i] = data->s[i];
+        }
+        bench::add("math/fast_inverse_sqrt_" + type + "_span", [in, out = std::vector<T>(count)](std::size_t n) mutable {
+            for (std::size_t r = 0; r < n; r++) {
+                math::fast_inverse_sqrt(std::span<const T>(in), std::span<T>(out));
+                bench::clobber();
+            }
+        }, count);
+
+        bench::add("math/compare_" + type, [in, copy = in](std::size_t n) {
+            for (std::size_t r = 0; r < n; r++) {
+                math::Comparison<T> result = math::compare(std::span<const T>(in), std::span<const T>(copy), { (T)0, (T)1e-6, 4 });
+                bench::do_not_optimize(result);
+            }
+        }, count);
+    }
+
+    // Swallows everything written to it, so the ansi writers are timed without the terminal
+    class NullBuffer : public std::streambuf {
+    protected:
+        int overflow(int c) override { return c; };
+        std::streamsize xsputn(const char*, std::streamsize n) override { return n; };
+    };
+
+    void ansi_benchmarks() {
+        // Measures the full sequences even when the benchmark output is redirected
+        terminal::set_capabilities({ true, terminal::ColorSupport::truecolor });
+        // Redirects std::cout for the duration of every run
+        auto muted = [](auto f) {
+            return [f](std::size_t n) {
+                static NullBuffer null;
+                std::streambuf* previous = std::cout.rdbuf(&null);
+                for (std::size_t r = 0; r < n; r++) {
+                    f(r);
+                }
+                std::cout.rdbuf(previous);
+            };
+        };
+        bench::add("ansi/foreground_rgb", muted([](std::size_t r) { ansi::foreground::setColor((unsigned char)r, (unsigned char)(r >> 8), 128); }));
+        bench::add("ansi/background_rgb", muted([](std::size_t r) { ansi::background::setColor((unsigned char)r, (unsigned char)(r >> 8), 128); }));
+        bench::add("ansi/foreground_256", muted([](std::size_t r) { ansi::foreground::hex256((unsigned char)r); }));
+        bench::add("ansi/background_256", muted([](std::size_t r) { ansi::background::hex256((unsigned char)r); }));
+        bench::add("ansi/constant_char", muted([](std::size_t) { std::cout << ansi::fg_red; }));
+        bench::add("ansi/constant_string", muted([](std::size_t) { std::cout << ansi::s_fg_red; }));
+        bench::add("ansi/to_256", [](std::size_t n) {
+            unsigned sum = 0;
+            for (std::size_t r = 0; r < n; r++) {
+                sum += ansi::to_256((std::uint8_t)r, (std::uint8_t)(r >> 8), (std::uint8_t)(r >> 16));
+            }
+            bench::do_not_optimize(sum);
+        });
+
+        // One colourized log line per run
+        static const std::string line = std::string(ansi::sgr<ansi::code::bold, ansi::code::fg_black + 2>) + "[info]" + std::string(ansi::s_reset)
+            + " request handled in 12 ms for user 12345, path /api/v1/items/" + std::string(ansi::s_fg_yellow) + "4711" + std::string(ansi::s_reset) + "\n";
+        bench::add("ansi/strip", [](std::size_t n) {
+            char out[256];
+            for (std::size_t r = 0; r < n; r++) {
+                bench::do_not_optimize(ansi::strip(line, out));
+            }
+        });
+        bench::add("ansi/visible_width", [](std::size_t n) {
+            for (std::size_t r = 0; r < n; r++) {
+                bench::do_not_optimize(ansi::visible_width(line));
+            }
+        });
+    }
+}
+
+int main(int argc, char** argv) {
+    bench::Options options = bench::parse_options(argc, argv);
+
+    vec_benchmarks_all<float>("f");
+    vec_benchmarks_all<double>("d");
+    math_benchmarks<float>("float");
+    math_benchmarks<double>("double");
+
+    auto data = make_data<float, 2>(5);
+    add_op("math/fequal", data, [](const vec2f &a, const vec2f &b, float) { return math::fequal(a.x, b.x); });
+
+    ansi_benchmarks();
+
+    bench::run_all(options);
+    return 0;
+}
@@ -1,547 +1,737 @@
 #ifndef ANSIHPP
 #define ANSIHPP
 
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
 #include <string>
+#include <string_view>
 #include <iostream>
 
+#include "terminal.hpp"
+
 // ANSI terminal manipulation
 namespace ansi {
-    const char* black                        = "\033[1;30m";
-    const char* red                          = "\033[1;31m";
-    const char* green                        = "\033[1;32m";
-    const char* yellow                       = "\033[1;33m";
-    const char* blue                         = "\033[1;34m";
-    const char* magenta                      = "\033[1;35m";
-    const char* cyan                         = "\033[1;36m";
-    const char* white                        = "\033[1;37m";
-    const char* fg_black                     = "\033[1;30m";
-    const char* fg_red                       = "\033[1;31m";
-    const char* fg_green                     = "\033[1;32m";
-    const char* fg_yellow                    = "\033[1;33m";
-    const char* fg_blue                      = "\033[1;34m";
-    const char* fg_magenta                   = "\033[1;35m";
-    const char* fg_cyan                      = "\033[1;36m";
-    const char* fg_white                     = "\033[1;37m";
-    const char* fg_default                   = "\033[1;39m";
-    const char* bg_black                     = "\033[1;40m";
-    const char* bg_red                       = "\033[1;41m";
-    const char* bg_green                     = "\033[1;42m";
-    const char* bg_yellow                    = "\033[1;43m";
-    const char* bg_blue                      = "\033[1;44m";
-    const char* bg_magenta                   = "\033[1;45m";
-    const char* bg_cyan                      = "\033[1;46m";
-    const char* bg_white                     = "\033[1;47m";
-    const char* bg_default                   = "\033[1;49m";
-    const char* reset                        = "\033[0m";  // Resets styles
-    const char* bold                         = "\033[1m";  // makes it bold/bright, this is often a brighter shade of the same color
-    const char* bright                       = "\033[1m";  // makes it bold/bright, this is often a brighter shade of the same color
-    const char* underline                    = "\033[4m";
-    const char* underlined                   = "\033[4m";
-    const char* crossed                      = "\033[9m";
-    const char* crossed_out                  = "\033[9m";
-    const char* blink                        = "\033[5m";
-    const char* blink_slow                   = "\033[5m";
-    const char* blink_fast                   = "\033[6m";  // Not widely supported
-    const char* overline                     = "\033[53m";
-    const char* overlined                    = "\033[53m";
-    const char* inverse                      = "\033[7m";  // Swap foreground and background colors
-    const char* bold_off                     = "\033[22m";
-    const char* bright_off                   = "\033[22m"; // May underline
-    const char* underline_off                = "\033[24m";
-    const char* underlined_off               = "\033[24m";
-    const char* inverse_off                  = "\033[27m";
-    const char* crossed_off                  = "\033[29m";
-    const char* crossed_out_off              = "\033[29m";
-    const char* blink_off                    = "\033[25m";
-    const char* overline_off                 = "\033[55m";
-    const char* overlined_off                = "\033[55m";
-    const char* intensity_normal             = "\033[22m"; // May underline
-    const char* intensity_increased          = "\033[1m";
-    const char* intensity_decreased          = "\033[2m";  // Light font weight
-    const char* newline                      = "\n";
-    const char* upline                       = "\x1b[A";
-    const char* clearline                    = "\033[2K";
-    const char* clear                        = "\033c";
-
-    const wchar_t* w_black                   = L"\033[1;30m";
-    const wchar_t* w_red                     = L"\033[1;31m";
-    const wchar_t* w_green                   = L"\033[1;32m";
-    const wchar_t* w_yellow                  = L"\033[1;33m";
-    const wchar_t* w_blue                    = L"\033[1;34m";
-    const wchar_t* w_magenta                 = L"\033[1;35m";
-    const wchar_t* w_cyan                    = L"\033[1;36m";
-    const wchar_t* w_white                   = L"\033[1;37m";
-    const wchar_t* w_fg_black                = L"\033[1;30m";
-    const wchar_t* w_fg_red                  = L"\033[1;31m";
-    const wchar_t* w_fg_green                = L"\033[1;32m";
-    const wchar_t* w_fg_yellow               = L"\033[1;33m";
-    const wchar_t* w_fg_blue                 = L"\033[1;34m";
-    const wchar_t* w_fg_magenta              = L"\033[1;35m";
-    const wchar_t* w_fg_cyan                 = L"\033[1;36m";
-    const wchar_t* w_fg_white                = L"\033[1;37m";
-    const wchar_t* w_fg_default              = L"\033[1;39m";
-    const wchar_t* w_bg_black                = L"\033[1;40m";
-    const wchar_t* w_bg_red                  = L"\033[1;41m";
-    const wchar_t* w_bg_green                = L"\033[1;42m";
-    const wchar_t* w_bg_yellow               = L"\033[1;43m";
-    const wchar_t* w_bg_blue                 = L"\033[1;44m";
-    const wchar_t* w_bg_magenta              = L"\033[1;45m";
-    const wchar_t* w_bg_cyan                 = L"\033[1;46m";
-    const wchar_t* w_bg_white                = L"\033[1;47m";
-    const wchar_t* w_bg_default              = L"\033[1;49m";
-    const wchar_t* w_reset                   = L"\033[0m";     // Resets styles
-    const wchar_t* w_bold                    = L"\033[1m";     // makes it bold/bright, this is often a brighter shade of the same color
-    const wchar_t* w_bright                  = L"\033[1m";     // makes it bold/bright, this is often a brighter shade of the same color
-    const wchar_t* w_underline               = L"\033[4m";
-    const wchar_t* w_underlined              = L"\033[4m";
-    const wchar_t* w_crossed                 = L"\033[9m";
-    const wchar_t* w_crossed_out             = L"\033[9m";
-    const wchar_t* w_blink                   = L"\033[5m";
-    const wchar_t* w_blink_slow              = L"\033[5m";
-    const wchar_t* w_blink_fast              = L"\033[6m";     // Not widely supported
-    const wchar_t* w_overline                = L"\033[53m";
-    const wchar_t* w_overlined               = L"\033[53m";
-    const wchar_t* w_inverse                 = L"\033[7m";     // Swap foreground and background colors
-    const wchar_t* w_bold_off                = L"\033[22m";
-    const wchar_t* w_bright_off              = L"\033[22m";    // May underline
-    const wchar_t* w_underline_off           = L"\033[24m";
-    const wchar_t* w_underlined_off          = L"\033[24m";
-    const wchar_t* w_inverse_off             = L"\033[27m";
-    const wchar_t* w_crossed_off             = L"\033[29m";
-    const wchar_t* w_crossed_out_off         = L"\033[29m";
-    const wchar_t* w_blink_off               = L"\033[25m";
-    const wchar_t* w_overline_off            = L"\033[55m";
-    const wchar_t* w_overlined_off           = L"\033[55m";
-    const wchar_t* w_intensity_normal        = L"\033[22m";    // May underline
-    const wchar_t* w_intensity_increased     = L"\033[1m";
-    const wchar_t* w_intensity_decreased     = L"\033[2m";     // Light font weight
-    const wchar_t* w_newline                 = L"\n";
-    const wchar_t* w_upline                  = L"\x1b[A";
-    const wchar_t* w_clearline               = L"\033[2K";
-    const wchar_t* w_clear                   = L"\033c";
-
-    const std::string s_black                = std::string("\033[30m");
-    const std::string s_red                  = std::string("\033[31m");
-    const std::string s_green                = std::string("\033[32m");
-    const std::string s_yellow               = std::string("\033[33m");
-    const std::string s_blue                 = std::string("\033[34m");
-    const std::string s_magenta              = std::string("\033[35m");
-    const std::string s_cyan                 = std::string("\033[36m");
-    const std::string s_white                = std::string("\033[37m");
-    const std::string s_fg_black             = std::string("\033[30m");
-    const std::string s_fg_red               = std::string("\033[31m");
-    const std::string s_fg_green             = std::string("\033[32m");
-    const std::string s_fg_yellow            = std::string("\033[33m");
-    const std::string s_fg_blue              = std::string("\033[34m");
-    const std::string s_fg_magenta           = std::string("\033[35m");
-    const std::string s_fg_cyan              = std::string("\033[36m");
-    const std::string s_fg_white             = std::string("\033[37m");
-    const std::string s_fg_default           = std::string("\033[39m");
-    const std::string s_bg_black             = std::string("\033[40m");
-    const std::string s_bg_red               = std::string("\033[41m");
-    const std::string s_bg_green             = std::string("\033[42m");
-    const std::string s_bg_yellow            = std::string("\033[43m");
-    const std::string s_bg_blue              = std::string("\033[44m");
-    const std::string s_bg_magenta           = std::string("\033[45m");
-    const std::string s_bg_cyan              = std::string("\033[46m");
-    const std::string s_bg_white             = std::string("\033[47m");
-    const std::string s_bg_default           = std::string("\033[49m");
-    const std::string s_reset                = std::string("\033[0m");     // Resets styles
-    const std::string s_bold                 = std::string("\033[1m");     // makes it bold/bright, this is often a brighter shade of the same color
-    const std::string s_bright               = std::string("\033[1m");     // makes it bold/bright, this is often a brighter shade of the same color
-    const std::string s_underline            = std::string("\033[4m");
-    const std::string s_underlined           = std::string("\033[4m");
-    const std::string s_crossed              = std::string("\033[9m");
-    const std::string s_crossed_out          = std::string("\033[9m");
-    const std::string s_blink                = std::string("\033[5m");
-    const std::string s_blink_slow           = std::string("\033[5m");
-    const std::string s_blink_fast           = std::string("\033[6m");     // Not widely supported
-    const std::string s_overline             = std::string("\033[53m");
-    const std::string s_overlined            = std::string("\033[53m");
-    const std::string s_inverse              = std::string("\033[7m");     // Swap foreground and background colors
-    const std::string s_bold_off             = std::string("\033[22m");
-    const std::string s_bright_off           = std::string("\033[22m");    // May underline
-    const std::string s_underline_off        = std::string("\033[24m");
-    const std::string s_underlined_off       = std::string("\033[24m");
-    const std::string s_inverse_off          = std::string("\033[27m");
-    const std::string s_crossed_off          = std::string("\033[29m");
-    const std::string s_crossed_out_off      = std::string("\033[29m");
-    const std::string s_blink_off            = std::string("\033[25m");
-    const std::string s_overline_off         = std::string("\033[55m");
-    const std::string s_overlined_off        = std::string("\033[55m");
-    const std::string s_intensity_normal     = std::string("\033[22m");    // May underline
-    const std::string s_intensity_increased  = std::string("\033[1m");
-    const std::string s_intensity_decreased  = std::string("\033[2m");     // Light font weight
-    const std::string s_newline              = std::string("\n");
-    const std::string s_upline               = std::string("\x1b[A");
-    const std::string s_clearline            = std::string("\033[2K");
-    const std::string s_clear                = std::string("\033c");
-
-    const std::wstring ws_black               = std::wstring(L"\033[30m");
-    const std::wstring ws_red                 = std::wstring(L"\033[31m");
-    const std::wstring ws_green               = std::wstring(L"\033[32m");
-    const std::wstring ws_yellow              = std::wstring(L"\033[33m");
-    const std::wstring ws_blue                = std::wstring(L"\033[34m");
-    const std::wstring ws_magenta             = std::wstring(L"\033[35m");
-    const std::wstring ws_cyan                = std::wstring(L"\033[36m");
-    const std::wstring ws_white               = std::wstring(L"\033[37m");
-    const std::wstring ws_fg_black            = std::wstring(L"\033[30m");
-    const std::wstring ws_fg_red              = std::wstring(L"\033[31m");
-    const std::wstring ws_fg_green            = std::wstring(L"\033[32m");
-    const std::wstring ws_fg_yellow           = std::wstring(L"\033[33m");
-    const std::wstring ws_fg_blue             = std::wstring(L"\033[34m");
-    const std::wstring ws_fg_magenta          = std::wstring(L"\033[35m");
-    const std::wstring ws_fg_cyan             = std::wstring(L"\033[36m");
-    const std::wstring ws_fg_white            = std::wstring(L"\033[37m");
-    const std::wstring ws_fg_default          = std::wstring(L"\033[39m");
-    const std::wstring ws_bg_black            = std::wstring(L"\033[40m");
-    const std::wstring ws_bg_red              = std::wstring(L"\033[41m");
-    const std::wstring ws_bg_green            = std::wstring(L"\033[42m");
-    const std::wstring ws_bg_yellow           = std::wstring(L"\033[43m");
-    const std::wstring ws_bg_blue             = std::wstring(L"\033[44m");
-    const std::wstring ws_bg_magenta          = std::wstring(L"\033[45m");
-    const std::wstring ws_bg_cyan             = std::wstring(L"\033[46m");
-    const std::wstring ws_bg_white            = std::wstring(L"\033[47m");
-    const std::wstring ws_bg_default          = std::wstring(L"\033[49m");
-    const std::wstring ws_reset               = std::wstring(L"\033[0m");     // Resets styles
-    const std::wstring ws_bold                = std::wstring(L"\033[1m");     // makes it bold/bright, this is often a brighter shade of the same color
-    const std::wstring ws_bright              = std::wstring(L"\033[1m");     // makes it bold/bright, this is often a brighter shade of the same color
-    const std::wstring ws_underline           = std::wstring(L"\033[4m");
-    const std::wstring ws_underlined          = std::wstring(L"\033[4m");
-    const std::wstring ws_crossed             = std::wstring(L"\033[9m");
-    const std::wstring ws_crossed_out         = std::wstring(L"\033[9m");
-    const std::wstring ws_blink               = std::wstring(L"\033[5m");
-    const std::wstring ws_blink_slow          = std::wstring(L"\033[5m");
-    const std::wstring ws_blink_fast          = std::wstring(L"\033[6m");     // Not widely supported
-    const std::wstring ws_overline            = std::wstring(L"\033[53m");
-    const std::wstring ws_overlined           = std::wstring(L"\033[53m");
-    const std::wstring ws_inverse             = std::wstring(L"\033[7m");     // Swap foreground and background colors
-    const std::wstring ws_bold_off            = std::wstring(L"\033[22m");
-    const std::wstring ws_bright_off          = std::wstring(L"\033[22m");    // May underline
-    const std::wstring ws_underline_off       = std::wstring(L"\033[24m");
-    const std::wstring ws_underlined_off      = std::wstring(L"\033[24m");
-    const std::wstring ws_inverse_off         = std::wstring(L"\033[27m");
-    const std::wstring ws_crossed_off         = std::wstring(L"\033[29m");
-    const std::wstring ws_crossed_out_off     = std::wstring(L"\033[29m");
-    const std::wstring ws_blink_off           = std::wstring(L"\033[25m");
-    const std::wstring ws_overline_off        = std::wstring(L"\033[55m");
-    const std::wstring ws_overlined_off       = std::wstring(L"\033[55m");
-    const std::wstring ws_intensity_normal    = std::wstring(L"\033[22m");    // May underline
-    const std::wstring ws_intensity_increased = std::wstring(L"\033[1m");
-    const std::wstring ws_intensity_decreased = std::wstring(L"\033[2m");     // Light font weight
-    const std::wstring ws_newline             = std::wstring(L"\n");
-    const std::wstring ws_upline              = std::wstring(L"\x1b[A");
-    const std::wstring ws_clearline           = std::wstring(L"\033[2K");
-    const std::wstring ws_clear               = std::wstring(L"\033c");
 
-    namespace color {
+    // SGR parameters, composed into a sequence at compile time with ansi::sgr
+    namespace code {
+        constexpr unsigned reset         = 0;
+        constexpr unsigned bold          = 1;
+        constexpr unsigned dim           = 2;
+        constexpr unsigned italic        = 3;
+        constexpr unsigned underline     = 4;
+        constexpr unsigned blink         = 5;
+        constexpr unsigned blink_fast    = 6;
+        constexpr unsigned inverse       = 7;
+        constexpr unsigned crossed       = 9;
+        constexpr unsigned bold_off      = 22; // Also turns dim off
+        constexpr unsigned italic_off    = 23;
+        constexpr unsigned underline_off = 24;
+        constexpr unsigned blink_off     = 25;
+        constexpr unsigned inverse_off   = 27;
+        constexpr unsigned crossed_off   = 29;
+        constexpr unsigned fg_black      = 30; // Up to fg_black + 7, white
+        constexpr unsigned fg_extended   = 38; // Followed by 5;index or 2;r;g;b
+        constexpr unsigned fg_default    = 39;
+        constexpr unsigned bg_black      = 40; // Up to bg_black + 7, white
+        constexpr unsigned bg_extended   = 48; // Followed by 5;index or 2;r;g;b
+        constexpr unsigned bg_default    = 49;
+        constexpr unsigned overline      = 53;
+        constexpr unsigned overline_off  = 55;
+        constexpr unsigned fg_bright     = 90; // Up to fg_bright + 7
+        constexpr unsigned bg_bright     = 100; // Up to bg_bright + 7
+    }
 
-        const char* black = "\033[30m";
-        const char* red = "\033[31m";
-        const char* green = "\033[32m";
-        const char* yellow = "\033[33m";
-        const char* blue = "\033[34m";
-        const char* magenta = "\033[35m";
-        const char* cyan = "\033[36m";
-        const char* white = "\033[37m";
-
-        const wchar_t* w_black = L"\033[30m";
-        const wchar_t* w_red = L"\033[31m";
-        const wchar_t* w_green = L"\033[32m";
-        const wchar_t* w_yellow = L"\033[33m";
-        const wchar_t* w_blue = L"\033[34m";
-        const wchar_t* w_magenta = L"\033[35m";
-        const wchar_t* w_cyan = L"\033[36m";
-        const wchar_t* w_white = L"\033[37m";
-
-        const std::string s_black = "\033[30m";
-        const std::string s_red = "\033[31m";
-        const std::string s_green = "\033[32m";
-        const std::string s_yellow = "\033[33m";
-        const std::string s_blue = "\033[34m";
-        const std::string s_magenta = "\033[35m";
-        const std::string s_cyan = "\033[36m";
-        const std::string s_white = "\033[37m";
-
-        const std::wstring ws_black = L"\033[30m";
-        const std::wstring ws_red = L"\033[31m";
-        const std::wstring ws_green = L"\033[32m";
-        const std::wstring ws_yellow = L"\033[33m";
-        const std::wstring ws_blue = L"\033[34m";
-        const std::wstring ws_magenta = L"\033[35m";
-        const std::wstring ws_cyan = L"\033[36m";
-        const std::wstring ws_white = L"\033[37m";
+    namespace detail {
+        constexpr std::size_t digits(unsigned value) {
+            std::size_t n = 1;
+            for (; value >= 10; value /= 10) {
+                n++;
+            }
+            return n;
+        }
+
+        // ESC [ codes separated by ; m, null terminated
+        template<unsigned... Codes>
+        struct Sgr {
+            static_assert(sizeof...(Codes) > 0, "An SGR sequence needs at least one code");
+
+            static constexpr std::size_t size = 3 + (digits(Codes) + ...) + sizeof...(Codes) - 1;
+
+            static constexpr std::array<char, size + 1> build() {
+                std::array<char, size + 1> out{};
+                std::size_t i = 0;
+                out[i++] = '\033';
+                out[i++] = '[';
+                for (unsigned code : { Codes... }) {
+                    if (i > 2) {
+                        out[i++] = ';';
+                    }
+                    std::size_t n = digits(code);
+                    for (std::size_t k = n; k-- > 0; code /= 10) {
+                        out[i + k] = (char)('0' + code % 10);
+                    }
+                    i += n;
+                }
+                out[i++] = 'm';
+                out[i] = '\0';
+                return out;
+            }
 
+            static constexpr std::array<char, size + 1> value = build();
+        };
+
+        inline char* write_extended(char* out, char target, unsigned char index) {
+            *out++ = '\033';
+            *out++ = '[';
+            *out++ = target;
+            *out++ = '8';
+            *out++ = ';';
+            *out++ = '5';
+            *out++ = ';';
+            out = std::to_chars(out, out + 3, index).ptr;
+            *out++ = 'm';
+            return out;
+        }
+
+        inline char* write_extended(char* out, char target, unsigned char red, unsigned char green, unsigned char blue) {
+            *out++ = '\033';
+            *out++ = '[';
+            *out++ = target;
+            *out++ = '8';
+            *out++ = ';';
+            *out++ = '2';
+            *out++ = ';';
+            out = std::to_chars(out, out + 3, red).ptr;
+            *out++ = ';';
+            out = std::to_chars(out, out + 3, green).ptr;
+            *out++ = ';';
+            out = std::to_chars(out, out + 3, blue).ptr;
+            *out++ = 'm';
+            return out;
+        }
     }
 
-    namespace foreground {
+    // SGR sequence built at compile time, ansi::sgr<ansi::code::bold, ansi::code::fg_black + 1> is "\033[1;31m"
+    // The view is null terminated, data() can be passed where a C string is expected
+    template<unsigned... Codes>
+    inline constexpr std::string_view sgr = std::string_view(detail::Sgr<Codes...>::value.data(), detail::Sgr<Codes...>::size);
 
-        const char* black = "\033[30m";
-        const char* red = "\033[31m";
-        const char* green = "\033[32m";
-        const char* yellow = "\033[33m";
-        const char* blue = "\033[34m";
-        const char* magenta = "\033[35m";
-        const char* cyan = "\033[36m";
-        const char* white = "\033[37m";
-
-        const wchar_t* w_black = L"\033[30m";
-        const wchar_t* w_red = L"\033[31m";
-        const wchar_t* w_green = L"\033[32m";
-        const wchar_t* w_yellow = L"\033[33m";
-        const wchar_t* w_blue = L"\033[34m";
-        const wchar_t* w_magenta = L"\033[35m";
-        const wchar_t* w_cyan = L"\033[36m";
-        const wchar_t* w_white = L"\033[37m";
-
-        const std::string s_black = "\033[30m";
-        const std::string s_red = "\033[31m";
-        const std::string s_green = "\033[32m";
-        const std::string s_yellow = "\033[33m";
-        const std::string s_blue = "\033[34m";
-        const std::string s_magenta = "\033[35m";
-        const std::string s_cyan = "\033[36m";
-        const std::string s_white = "\033[37m";
-
-        const std::wstring ws_black = L"\033[30m";
-        const std::wstring ws_red = L"\033[31m";
-        const std::wstring ws_green = L"\033[32m";
-        const std::wstring ws_yellow = L"\033[33m";
-        const std::wstring ws_blue = L"\033[34m";
-        const std::wstring ws_magenta = L"\033[35m";
-        const std::wstring ws_cyan = L"\033[36m";
-        const std::wstring ws_white = L"\033[37m";
-
-        void hex256(unsigned char color) {
-            if (color < 0) {
-                color = 0;
-            }
-            if (color > 255) {
-                color = 255;
+    // Compile time palette and 24 bit colours
+    template<std::uint8_t Index>
+    inline constexpr std::string_view fg_256 = sgr<code::fg_extended, 5, Index>;
+
+    template<std::uint8_t Index>
+    inline constexpr std::string_view bg_256 = sgr<code::bg_extended, 5, Index>;
+
+    template<std::uint8_t R, std::uint8_t G, std::uint8_t B>
+    inline constexpr std::string_view fg_rgb = sgr<code::fg_extended, 2, R, G, B>;
+
+    template<std::uint8_t R, std::uint8_t G, std::uint8_t B>
+    inline constexpr std::string_view bg_rgb = sgr<code::bg_extended, 2, R, G, B>;
+
+    // Longest sequence the writers produce, "\033[38;2;255;255;255m"
+    constexpr std::size_t max_sequence = 19;
+
+    // The writers format a colour sequence into out, which needs room for max_sequence chars
+    // They return one past the last char written and never allocate
+    inline char* write_foreground(char* out, unsigned char index) {
+        return detail::write_extended(out, '3', index);
+    }
+
+    inline char* write_foreground(char* out, unsigned char red, unsigned char green, unsigned char blue) {
+        return detail::write_extended(out, '3', red, green, blue);
+    }
+
+    inline char* write_background(char* out, unsigned char index) {
+        return detail::write_extended(out, '4', index);
+    }
+
+    inline char* write_background(char* out, unsigned char red, unsigned char green, unsigned char blue) {
+        return detail::write_extended(out, '4', red, green, blue);
+    }
+
+    namespace detail {
+        // Levels of the 6 * 6 * 6 cube, palette entries 16 - 231
+        constexpr std::uint8_t cube_levels[6] = { 0, 95, 135, 175, 215, 255 };
+
+        // Nearest cube level of every channel value
+        constexpr std::array<std::uint8_t, 256> cube_index = []() {
+            std::array<std::uint8_t, 256> out{};
+            for (unsigned v = 0; v < 256; v++) {
+                std::uint8_t i = 0;
+                while (i < 5 && 2 * v > (unsigned)cube_levels[i] + cube_levels[i + 1]) {
+                    i++;
+                }
+                out[v] = i;
             }
-            std::cout << "\033[38;5;" << color << "m";
-        }
-        
-        void setColor(unsigned char red, unsigned char green, unsigned char blue) {
-            if (red < 0) {
-                red = 0;
+            return out;
+        }();
+
+        // Nearest step of the gray ramp, palette entries 232 - 255 at 8 + 10 * i, for every average
+        constexpr std::array<std::uint8_t, 256> gray_index = []() {
+            std::array<std::uint8_t, 256> out{};
+            for (unsigned v = 0; v < 256; v++) {
+                out[v] = (std::uint8_t)(v < 8 ? 0 : v > 238 ? 23 : (v - 8 + 5) / 10);
             }
-            if (red > 255) {
-                red = 255;
+            return out;
+        }();
+
+        // RGB of every palette entry, the 16 basic colours as xterm draws them
+        constexpr std::array<std::array<std::uint8_t, 3>, 256> palette_rgb = []() {
+            std::array<std::array<std::uint8_t, 3>, 256> out{};
+            constexpr std::uint8_t basic[16][3] = {
+                { 0, 0, 0 }, { 205, 0, 0 }, { 0, 205, 0 }, { 205, 205, 0 }, { 0, 0, 238 }, { 205, 0, 205 }, { 0, 205, 205 }, { 229, 229, 229 },
+                { 127, 127, 127 }, { 255, 0, 0 }, { 0, 255, 0 }, { 255, 255, 0 }, { 92, 92, 255 }, { 255, 0, 255 }, { 0, 255, 255 }, { 255, 255, 255 },
+            };
+            for (std::size_t i = 0; i < 16; i++) {
+                out[i] = { basic[i][0], basic[i][1], basic[i][2] };
             }
-            if (green < 0) {
-                green = 0;
+            for (std::size_t i = 0; i < 216; i++) {
+                out[16 + i] = { cube_levels[i / 36], cube_levels[i / 6 % 6], cube_levels[i % 6] };
             }
-            if (green > 255) {
-                green = 255;
+            for (std::size_t i = 0; i < 24; i++) {
+                const std::uint8_t level = (std::uint8_t)(8 + 10 * i);
+                out[232 + i] = { level, level, level };
             }
-            if (blue < 0) {
-                blue = 0;
+            return out;
+        }();
+
+        constexpr unsigned distance_squared(const std::array<std::uint8_t, 3> &a, unsigned r, unsigned g, unsigned b) {
+            const int dr = (int)a[0] - (int)r;
+            const int dg = (int)a[1] - (int)g;
+            const int db = (int)a[2] - (int)b;
+            return (unsigned)(dr * dr + dg * dg + db * db);
+        }
+
+        // Nearest basic colour of every palette entry
+        constexpr std::array<std::uint8_t, 256> basic_index = []() {
+            std::array<std::uint8_t, 256> out{};
+            for (std::size_t i = 0; i < 256; i++) {
+                const std::array<std::uint8_t, 3> &c = palette_rgb[i];
+                std::uint8_t best = 0;
+                for (std::uint8_t k = 1; k < 16; k++) {
+                    if (distance_squared(palette_rgb[k], c[0], c[1], c[2]) < distance_squared(palette_rgb[best], c[0], c[1], c[2])) {
+                        best = k;
+                    }
+                }
+                out[i] = i < 16 ? (std::uint8_t)i : best;
             }
-            if (blue > 255) {
-                blue = 255;
+            return out;
+        }();
+
+        // ESC [ 3x m or ESC [ 9x m for one of the 16 basic colours, target is '3' or '4'
+        inline char* write_basic(char* out, char target, std::uint8_t index) {
+            *out++ = '\033';
+            *out++ = '[';
+            if (index < 8) {
+                *out++ = target;
+            } else if (target == '3') {
+                *out++ = '9';
+            } else {
+                *out++ = '1';
+                *out++ = '0';
             }
+            *out++ = (char)('0' + (index & 7));
+            *out++ = 'm';
+            return out;
+        }
+    }
+
+    // Returns the palette entry closest to r, g, b, the nearer of the colour cube and the gray ramp
+    constexpr std::uint8_t to_256(std::uint8_t r, std::uint8_t g, std::uint8_t b) {
+        const std::uint8_t ri = detail::cube_index[r];
+        const std::uint8_t gi = detail::cube_index[g];
+        const std::uint8_t bi = detail::cube_index[b];
+        const std::uint8_t cube = (std::uint8_t)(16 + 36 * ri + 6 * gi + bi);
+        const std::uint8_t gray = (std::uint8_t)(232 + detail::gray_index[((unsigned)r + g + b) / 3]);
+        return detail::distance_squared(detail::palette_rgb[gray], r, g, b) < detail::distance_squared(detail::palette_rgb[cube], r, g, b) ? gray : cube;
+    }
+
+    // Returns the basic colour, 0 - 15, closest to a palette entry
+    constexpr std::uint8_t to_16(std::uint8_t index) {
+        return detail::basic_index[index];
+    }
+
+    constexpr std::uint8_t to_16(std::uint8_t r, std::uint8_t g, std::uint8_t b) {
+        return to_16(to_256(r, g, b));
+    }
+
+    // Same as the writers above but downsampled to what the terminal supports, nothing is written for ColorSupport::none
+    inline char* write_foreground(char* out, unsigned char index, terminal::ColorSupport support) {
+        switch (support) {
+            case terminal::ColorSupport::none: return out;
+            case terminal::ColorSupport::basic: return detail::write_basic(out, '3', to_16(index));
+            default: return write_foreground(out, index);
+        }
+    }
+
+    inline char* write_foreground(char* out, unsigned char red, unsigned char green, unsigned char blue, terminal::ColorSupport support) {
+        switch (support) {
+            case terminal::ColorSupport::none: return out;
+            case terminal::ColorSupport::basic: return detail::write_basic(out, '3', to_16(red, green, blue));
+            case terminal::ColorSupport::palette: return write_foreground(out, to_256(red, green, blue));
+            default: return write_foreground(out, red, green, blue);
+        }
+    }
+
+    inline char* write_background(char* out, unsigned char index, terminal::ColorSupport support) {
+        switch (support) {
+            case terminal::ColorSupport::none: return out;
+            case terminal::ColorSupport::basic: return detail::write_basic(out, '4', to_16(index));
+            default: return write_background(out, index);
+        }
+    }
+
+    inline char* write_background(char* out, unsigned char red, unsigned char green, unsigned char blue, terminal::ColorSupport support) {
+        switch (support) {
+            case terminal::ColorSupport::none: return out;
+            case terminal::ColorSupport::basic: return detail::write_basic(out, '4', to_16(red, green, blue));
+            case terminal::ColorSupport::palette: return write_background(out, to_256(red, green, blue));
+            default: return write_background(out, red, green, blue);
+        }
+    }
+
+    // Returns sequence when colours are enabled and an empty view otherwise, enabled defaults to whether stdout
+    // shows colours: std::cout << ansi::style(ansi::red) << "error" << ansi::style(ansi::reset)
+    inline std::string_view style(std::string_view sequence, bool enabled = terminal::capabilities().color != terminal::ColorSupport::none) {
+        return enabled ? sequence : std::string_view();
+    }
+
+    inline std::wstring_view style(std::wstring_view sequence, bool enabled = terminal::capabilities().color != terminal::ColorSupport::none) {
+        return enabled ? sequence : std::wstring_view();
+    }
+
+    // The named sequences below are unconditional, they are written even when stdout is a file or a pipe
+    // Pass them through style to drop them there
+    inline constexpr const char* black                        = "\033[1;30m";
+    inline constexpr const char* red                          = "\033[1;31m";
+    inline constexpr const char* green                        = "\033[1;32m";
+    inline constexpr const char* yellow                       = "\033[1;33m";
+    inline constexpr const char* blue                         = "\033[1;34m";
+    inline constexpr const char* magenta                      = "\033[1;35m";
+    inline constexpr const char* cyan                         = "\033[1;36m";
+    inline constexpr const char* white                        = "\033[1;37m";
+    inline constexpr const char* fg_black                     = "\033[1;30m";
+    inline constexpr const char* fg_red                       = "\033[1;31m";
+    inline constexpr const char* fg_green                     = "\033[1;32m";
+    inline constexpr const char* fg_yellow                    = "\033[1;33m";
+    inline constexpr const char* fg_blue                      = "\033[1;34m";
+    inline constexpr const char* fg_magenta                   = "\033[1;35m";
+    inline constexpr const char* fg_cyan                      = "\033[1;36m";
+    inline constexpr const char* fg_white                     = "\033[1;37m";
+    inline constexpr const char* fg_default                   = "\033[1;39m";
+    inline constexpr const char* bg_black                     = "\033[1;40m";
+    inline constexpr const char* bg_red                       = "\033[1;41m";
+    inline constexpr const char* bg_green                     = "\033[1;42m";
+    inline constexpr const char* bg_yellow                    = "\033[1;43m";
+    inline constexpr const char* bg_blue                      = "\033[1;44m";
+    inline constexpr const char* bg_magenta                   = "\033[1;45m";
+    inline constexpr const char* bg_cyan                      = "\033[1;46m";
+    inline constexpr const char* bg_white                     = "\033[1;47m";
+    inline constexpr const char* bg_default                   = "\033[1;49m";
+    inline constexpr const char* reset                        = "\033[0m";  // Resets styles
+    inline constexpr const char* bold                         = "\033[1m";  // makes it bold/bright, this is often a brighter shade of the same color
+    inline constexpr const char* bright                       = "\033[1m";  // makes it bold/bright, this is often a brighter shade of the same color
+    inline constexpr const char* underline                    = "\033[4m";
+    inline constexpr const char* underlined                   = "\033[4m";
+    inline constexpr const char* crossed                      = "\033[9m";
+    inline constexpr const char* crossed_out                  = "\033[9m";
+    inline constexpr const char* blink                        = "\033[5m";
+    inline constexpr const char* blink_slow                   = "\033[5m";
+    inline constexpr const char* blink_fast                   = "\033[6m";  // Not widely supported
+    inline constexpr const char* overline                     = "\033[53m";
+    inline constexpr const char* overlined                    = "\033[53m";
+    inline constexpr const char* inverse                      = "\033[7m";  // Swap foreground and background colors
+    inline constexpr const char* bold_off                     = "\033[22m";
+    inline constexpr const char* bright_off                   = "\033[22m"; // May underline
+    inline constexpr const char* underline_off                = "\033[24m";
+    inline constexpr const char* underlined_off               = "\033[24m";
+    inline constexpr const char* inverse_off                  = "\033[27m";
+    inline constexpr const char* crossed_off                  = "\033[29m";
+    inline constexpr const char* crossed_out_off              = "\033[29m";
+    inline constexpr const char* blink_off                    = "\033[25m";
+    inline constexpr const char* overline_off                 = "\033[55m";
+    inline constexpr const char* overlined_off                = "\033[55m";
+    inline constexpr const char* intensity_normal             = "\033[22m"; // May underline
+    inline constexpr const char* intensity_increased          = "\033[1m";
+    inline constexpr const char* intensity_decreased          = "\033[2m";  // Light font weight
+    inline constexpr const char* newline                      = "\n";
+    inline constexpr const char* upline                       = "\x1b[A";
+    inline constexpr const char* clearline                    = "\033[2K";
+    inline constexpr const char* clear                        = "\033c";
+
+    inline constexpr const wchar_t* w_black                   = L"\033[1;30m";
+    inline constexpr const wchar_t* w_red                     = L"\033[1;31m";
+    inline constexpr const wchar_t* w_green                   = L"\033[1;32m";
+    inline constexpr const wchar_t* w_yellow                  = L"\033[1;33m";
+    inline constexpr const wchar_t* w_blue                    = L"\033[1;34m";
+    inline constexpr const wchar_t* w_magenta                 = L"\033[1;35m";
+    inline constexpr const wchar_t* w_cyan                    = L"\033[1;36m";
+    inline constexpr const wchar_t* w_white                   = L"\033[1;37m";
+    inline constexpr const wchar_t* w_fg_black                = L"\033[1;30m";
+    inline constexpr const wchar_t* w_fg_red                  = L"\033[1;31m";
+    inline constexpr const wchar_t* w_fg_green                = L"\033[1;32m";
+    inline constexpr const wchar_t* w_fg_yellow               = L"\033[1;33m";
+    inline constexpr const wchar_t* w_fg_blue                 = L"\033[1;34m";
+    inline constexpr const wchar_t* w_fg_magenta              = L"\033[1;35m";
+    inline constexpr const wchar_t* w_fg_cyan                 = L"\033[1;36m";
+    inline constexpr const wchar_t* w_fg_white                = L"\033[1;37m";
+    inline constexpr const wchar_t* w_fg_default              = L"\033[1;39m";
+    inline constexpr const wchar_t* w_bg_black                = L"\033[1;40m";
+    inline constexpr const wchar_t* w_bg_red                  = L"\033[1;41m";
+    inline constexpr const wchar_t* w_bg_green                = L"\033[1;42m";
+    inline constexpr const wchar_t* w_bg_yellow               = L"\033[1;43m";
+    inline constexpr const wchar_t* w_bg_blue                 = L"\033[1;44m";
+    inline constexpr const wchar_t* w_bg_magenta              = L"\033[1;45m";
+    inline constexpr const wchar_t* w_bg_cyan                 = L"\033[1;46m";
+    inline constexpr const wchar_t* w_bg_white                = L"\033[1;47m";
+    inline constexpr const wchar_t* w_bg_default              = L"\033[1;49m";
+    inline constexpr const wchar_t* w_reset                   = L"\033[0m";     // Resets styles
+    inline constexpr const wchar_t* w_bold                    = L"\033[1m";     // makes it bold/bright, this is often a brighter shade of the same color
+    inline constexpr const wchar_t* w_bright                  = L"\033[1m";     // makes it bold/bright, this is often a brighter shade of the same color
+    inline constexpr const wchar_t* w_underline               = L"\033[4m";
+    inline constexpr const wchar_t* w_underlined              = L"\033[4m";
+    inline constexpr const wchar_t* w_crossed                 = L"\033[9m";
+    inline constexpr const wchar_t* w_crossed_out             = L"\033[9m";
+    inline constexpr const wchar_t* w_blink                   = L"\033[5m";
+    inline constexpr const wchar_t* w_blink_slow              = L"\033[5m";
+    inline constexpr const wchar_t* w_blink_fast              = L"\033[6m";     // Not widely supported
+    inline constexpr const wchar_t* w_overline                = L"\033[53m";
+    inline constexpr const wchar_t* w_overlined               = L"\033[53m";
+    inline constexpr const wchar_t* w_inverse                 = L"\033[7m";     // Swap foreground and background colors
+    inline constexpr const wchar_t* w_bold_off                = L"\033[22m";
+    inline constexpr const wchar_t* w_bright_off              = L"\033[22m";    // May underline
+    inline constexpr const wchar_t* w_underline_off           = L"\033[24m";
+    inline constexpr const wchar_t* w_underlined_off          = L"\033[24m";
+    inline constexpr const wchar_t* w_inverse_off             = L"\033[27m";
+    inline constexpr const wchar_t* w_crossed_off             = L"\033[29m";
+    inline constexpr const wchar_t* w_crossed_out_off         = L"\033[29m";
+    inline constexpr const wchar_t* w_blink_off               = L"\033[25m";
+    inline constexpr const wchar_t* w_overline_off            = L"\033[55m";
+    inline constexpr const wchar_t* w_overlined_off           = L"\033[55m";
+    inline constexpr const wchar_t* w_intensity_normal        = L"\033[22m";    // May underline
+    inline constexpr const wchar_t* w_intensity_increased     = L"\033[1m";
+    inline constexpr const wchar_t* w_intensity_decreased     = L"\033[2m";     // Light font weight
+    inline constexpr const wchar_t* w_newline                 = L"\n";
+    inline constexpr const wchar_t* w_upline                  = L"\x1b[A";
+    inline constexpr const wchar_t* w_clearline               = L"\033[2K";
+    inline constexpr const wchar_t* w_clear                   = L"\033c";
+
+    // Views rather than std::string, so including the header constructs nothing at startup
+    inline constexpr std::string_view s_black                = "\033[30m";
+    inline constexpr std::string_view s_red                  = "\033[31m";
+    inline constexpr std::string_view s_green                = "\033[32m";
+    inline constexpr std::string_view s_yellow               = "\033[33m";
+    inline constexpr std::string_view s_blue                 = "\033[34m";
+    inline constexpr std::string_view s_magenta              = "\033[35m";
+    inline constexpr std::string_view s_cyan                 = "\033[36m";
+    inline constexpr std::string_view s_white                = "\033[37m";
+    inline constexpr std::string_view s_fg_black             = "\033[30m";
+    inline constexpr std::string_view s_fg_red               = "\033[31m";
+    inline constexpr std::string_view s_fg_green             = "\033[32m";
+    inline constexpr std::string_view s_fg_yellow            = "\033[33m";
+    inline constexpr std::string_view s_fg_blue              = "\033[34m";
+    inline constexpr std::string_view s_fg_magenta           = "\033[35m";
+    inline constexpr std::string_view s_fg_cyan              = "\033[36m";
+    inline constexpr std::string_view s_fg_white             = "\033[37m";
+    inline constexpr std::string_view s_fg_default           = "\033[39m";
+    inline constexpr std::string_view s_bg_black             = "\033[40m";
+    inline constexpr std::string_view s_bg_red               = "\033[41m";
+    inline constexpr std::string_view s_bg_green             = "\033[42m";
+    inline constexpr std::string_view s_bg_yellow            = "\033[43m";
+    inline constexpr std::string_view s_bg_blue              = "\033[44m";
+    inline constexpr std::string_view s_bg_magenta           = "\033[45m";
+    inline constexpr std::string_view s_bg_cyan              = "\033[46m";
+    inline constexpr std::string_view s_bg_white             = "\033[47m";
+    inline constexpr std::string_view s_bg_default           = "\033[49m";
+    inline constexpr std::string_view s_reset                = "\033[0m";     // Resets styles
+    inline constexpr std::string_view s_bold                 = "\033[1m";     // makes it bold/bright, this is often a brighter shade of the same color
+    inline constexpr std::string_view s_bright               = "\033[1m";     // makes it bold/bright, this is often a brighter shade of the same color
+    inline constexpr std::string_view s_underline            = "\033[4m";
+    inline constexpr std::string_view s_underlined           = "\033[4m";
+    inline constexpr std::string_view s_crossed              = "\033[9m";
+    inline constexpr std::string_view s_crossed_out          = "\033[9m";
+    inline constexpr std::string_view s_blink                = "\033[5m";
+    inline constexpr std::string_view s_blink_slow           = "\033[5m";
+    inline constexpr std::string_view s_blink_fast           = "\033[6m";     // Not widely supported
+    inline constexpr std::string_view s_overline             = "\033[53m";
+    inline constexpr std::string_view s_overlined            = "\033[53m";
+    inline constexpr std::string_view s_inverse              = "\033[7m";     // Swap foreground and background colors
+    inline constexpr std::string_view s_bold_off             = "\033[22m";
+    inline constexpr std::string_view s_bright_off           = "\033[22m";    // May underline
+    inline constexpr std::string_view s_underline_off        = "\033[24m";
+    inline constexpr std::string_view s_underlined_off       = "\033[24m";
+    inline constexpr std::string_view s_inverse_off          = "\033[27m";
+    inline constexpr std::string_view s_crossed_off          = "\033[29m";
+    inline constexpr std::string_view s_crossed_out_off      = "\033[29m";
+    inline constexpr std::string_view s_blink_off            = "\033[25m";
+    inline constexpr std::string_view s_overline_off         = "\033[55m";
+    inline constexpr std::string_view s_overlined_off        = "\033[55m";
+    inline constexpr std::string_view s_intensity_normal     = "\033[22m";    // May underline
+    inline constexpr std::string_view s_intensity_increased  = "\033[1m";
+    inline constexpr std::string_view s_intensity_decreased  = "\033[2m";     // Light font weight
+    inline constexpr std::string_view s_newline              = "\n";
+    inline constexpr std::string_view s_upline               = "\x1b[A";
+    inline constexpr std::string_view s_clearline            = "\033[2K";
+    inline constexpr std::string_view s_clear                = "\033c";
+
+    inline constexpr std::wstring_view ws_black               = L"\033[30m";
+    inline constexpr std::wstring_view ws_red                 = L"\033[31m";
+    inline constexpr std::wstring_view ws_green               = L"\033[32m";
+    inline constexpr std::wstring_view ws_yellow              = L"\033[33m";
+    inline constexpr std::wstring_view ws_blue                = L"\033[34m";
+    inline constexpr std::wstring_view ws_magenta             = L"\033[35m";
+    inline constexpr std::wstring_view ws_cyan                = L"\033[36m";
+    inline constexpr std::wstring_view ws_white               = L"\033[37m";
+    inline constexpr std::wstring_view ws_fg_black            = L"\033[30m";
+    inline constexpr std::wstring_view ws_fg_red              = L"\033[31m";
+    inline constexpr std::wstring_view ws_fg_green            = L"\033[32m";
+    inline constexpr std::wstring_view ws_fg_yellow           = L"\033[33m";
+    inline constexpr std::wstring_view ws_fg_blue             = L"\033[34m";
+    inline constexpr std::wstring_view ws_fg_magenta          = L"\033[35m";
+    inline constexpr std::wstring_view ws_fg_cyan             = L"\033[36m";
+    inline constexpr std::wstring_view ws_fg_white            = L"\033[37m";
+    inline constexpr std::wstring_view ws_fg_default          = L"\033[39m";
+    inline constexpr std::wstring_view ws_bg_black            = L"\033[40m";
+    inline constexpr std::wstring_view ws_bg_red              = L"\033[41m";
+    inline constexpr std::wstring_view ws_bg_green            = L"\033[42m";
+    inline constexpr std::wstring_view ws_bg_yellow           = L"\033[43m";
+    inline constexpr std::wstring_view ws_bg_blue             = L"\033[44m";
+    inline constexpr std::wstring_view ws_bg_magenta          = L"\033[45m";
+    inline constexpr std::wstring_view ws_bg_cyan             = L"\033[46m";
+    inline constexpr std::wstring_view ws_bg_white            = L"\033[47m";
+    inline constexpr std::wstring_view ws_bg_default          = L"\033[49m";
+    inline constexpr std::wstring_view ws_reset               = L"\033[0m";     // Resets styles
+    inline constexpr std::wstring_view ws_bold                = L"\033[1m";     // makes it bold/bright, this is often a brighter shade of the same color
+    inline constexpr std::wstring_view ws_bright              = L"\033[1m";     // makes it bold/bright, this is often a brighter shade of the same color
+    inline constexpr std::wstring_view ws_underline           = L"\033[4m";
+    inline constexpr std::wstring_view ws_underlined          = L"\033[4m";
+    inline constexpr std::wstring_view ws_crossed             = L"\033[9m";
+    inline constexpr std::wstring_view ws_crossed_out         = L"\033[9m";
+    inline constexpr std::wstring_view ws_blink               = L"\033[5m";
+    inline constexpr std::wstring_view ws_blink_slow          = L"\033[5m";
+    inline constexpr std::wstring_view ws_blink_fast          = L"\033[6m";     // Not widely supported
+    inline constexpr std::wstring_view ws_overline            = L"\033[53m";
+    inline constexpr std::wstring_view ws_overlined           = L"\033[53m";
+    inline constexpr std::wstring_view ws_inverse             = L"\033[7m";     // Swap foreground and background colors
+    inline constexpr std::wstring_view ws_bold_off            = L"\033[22m";
+    inline constexpr std::wstring_view ws_bright_off          = L"\033[22m";    // May underline
+    inline constexpr std::wstring_view ws_underline_off       = L"\033[24m";
+    inline constexpr std::wstring_view ws_underlined_off      = L"\033[24m";
+    inline constexpr std::wstring_view ws_inverse_off         = L"\033[27m";
+    inline constexpr std::wstring_view ws_crossed_off         = L"\033[29m";
+    inline constexpr std::wstring_view ws_crossed_out_off     = L"\033[29m";
+    inline constexpr std::wstring_view ws_blink_off           = L"\033[25m";
+    inline constexpr std::wstring_view ws_overline_off        = L"\033[55m";
+    inline constexpr std::wstring_view ws_overlined_off       = L"\033[55m";
+    inline constexpr std::wstring_view ws_intensity_normal    = L"\033[22m";    // May underline
+    inline constexpr std::wstring_view ws_intensity_increased = L"\033[1m";
+    inline constexpr std::wstring_view ws_intensity_decreased = L"\033[2m";     // Light font weight
+    inline constexpr std::wstring_view ws_newline             = L"\n";
+    inline constexpr std::wstring_view ws_upline              = L"\x1b[A";
+    inline constexpr std::wstring_view ws_clearline           = L"\033[2K";
+    inline constexpr std::wstring_view ws_clear               = L"\033c";
+
+    namespace color {
+
+        inline constexpr const char* black = "\033[30m";
+        inline constexpr const char* red = "\033[31m";
+        inline constexpr const char* green = "\033[32m";
+        inline constexpr const char* yellow = "\033[33m";
+        inline constexpr const char* blue = "\033[34m";
+        inline constexpr const char* magenta = "\033[35m";
+        inline constexpr const char* cyan = "\033[36m";
+        inline constexpr const char* white = "\033[37m";
+
+        inline constexpr const wchar_t* w_black = L"\033[30m";
+        inline constexpr const wchar_t* w_red = L"\033[31m";
+        inline constexpr const wchar_t* w_green = L"\033[32m";
+        inline constexpr const wchar_t* w_yellow = L"\033[33m";
+        inline constexpr const wchar_t* w_blue = L"\033[34m";
+        inline constexpr const wchar_t* w_magenta = L"\033[35m";
+        inline constexpr const wchar_t* w_cyan = L"\033[36m";
+        inline constexpr const wchar_t* w_white = L"\033[37m";
+
+        inline constexpr std::string_view s_black = "\033[30m";
+        inline constexpr std::string_view s_red = "\033[31m";
+        inline constexpr std::string_view s_green = "\033[32m";
+        inline constexpr std::string_view s_yellow = "\033[33m";
+        inline constexpr std::string_view s_blue = "\033[34m";
+        inline constexpr std::string_view s_magenta = "\033[35m";
+        inline constexpr std::string_view s_cyan = "\033[36m";
+        inline constexpr std::string_view s_white = "\033[37m";
+
+        inline constexpr std::wstring_view ws_black = L"\033[30m";
+        inline constexpr std::wstring_view ws_red = L"\033[31m";
+        inline constexpr std::wstring_view ws_green = L"\033[32m";
+        inline constexpr std::wstring_view ws_yellow = L"\033[33m";
+        inline constexpr std::wstring_view ws_blue = L"\033[34m";
+        inline constexpr std::wstring_view ws_magenta = L"\033[35m";
+        inline constexpr std::wstring_view ws_cyan = L"\033[36m";
+        inline constexpr std::wstring_view ws_white = L"\033[37m";
 
-            std::cout << "\033[38;2;" << (short int)red << ";" << (short int)green << ";" << (short int)blue << "m";
+    }
+
+    namespace foreground {
+
+        inline constexpr const char* black = "\033[30m";
+        inline constexpr const char* red = "\033[31m";
+        inline constexpr const char* green = "\033[32m";
+        inline constexpr const char* yellow = "\033[33m";
+        inline constexpr const char* blue = "\033[34m";
+        inline constexpr const char* magenta = "\033[35m";
+        inline constexpr const char* cyan = "\033[36m";
+        inline constexpr const char* white = "\033[37m";
+
+        inline constexpr const wchar_t* w_black = L"\033[30m";
+        inline constexpr const wchar_t* w_red = L"\033[31m";
+        inline constexpr const wchar_t* w_green = L"\033[32m";
+        inline constexpr const wchar_t* w_yellow = L"\033[33m";
+        inline constexpr const wchar_t* w_blue = L"\033[34m";
+        inline constexpr const wchar_t* w_magenta = L"\033[35m";
+        inline constexpr const wchar_t* w_cyan = L"\033[36m";
+        inline constexpr const wchar_t* w_white = L"\033[37m";
+
+        inline constexpr std::string_view s_black = "\033[30m";
+        inline constexpr std::string_view s_red = "\033[31m";
+        inline constexpr std::string_view s_green = "\033[32m";
+        inline constexpr std::string_view s_yellow = "\033[33m";
+        inline constexpr std::string_view s_blue = "\033[34m";
+        inline constexpr std::string_view s_magenta = "\033[35m";
+        inline constexpr std::string_view s_cyan = "\033[36m";
+        inline constexpr std::string_view s_white = "\033[37m";
+
+        inline constexpr std::wstring_view ws_black = L"\033[30m";
+        inline constexpr std::wstring_view ws_red = L"\033[31m";
+        inline constexpr std::wstring_view ws_green = L"\033[32m";
+        inline constexpr std::wstring_view ws_yellow = L"\033[33m";
+        inline constexpr std::wstring_view ws_blue = L"\033[34m";
+        inline constexpr std::wstring_view ws_magenta = L"\033[35m";
+        inline constexpr std::wstring_view ws_cyan = L"\033[36m";
+        inline constexpr std::wstring_view ws_white = L"\033[37m";
+
+        inline void hex256(unsigned char color) {
+            char buffer[max_sequence];
+            std::cout.write(buffer, write_foreground(buffer, color, terminal::capabilities().color) - buffer);
+        }
+        
+        inline void setColor(unsigned char red, unsigned char green, unsigned char blue) {
+            char buffer[max_sequence];
+            std::cout.write(buffer, write_foreground(buffer, red, green, blue, terminal::capabilities().color) - buffer);
         }
     }
 
     namespace background {
     
-        const char* black = "\033[40m";
-        const char* red = "\033[41m";
-        const char* green = "\033[42m";
-        const char* yellow = "\033[43m";
-        const char* blue = "\033[44m";
-        const char* magenta = "\033[45m";
-        const char* cyan = "\033[46m";
-        const char* white = "\033[47m";
-
-        const wchar_t* w_black = L"\033[40m";
-        const wchar_t* w_red = L"\033[41m";
-        const wchar_t* w_green = L"\033[42m";
-        const wchar_t* w_yellow = L"\033[43m";
-        const wchar_t* w_blue = L"\033[44m";
-        const wchar_t* w_magenta = L"\033[45m";
-        const wchar_t* w_cyan = L"\033[46m";
-        const wchar_t* w_white = L"\033[47m";
-
-        const std::string s_black = "\033[40m";
-        const std::string s_red = "\033[41m";
-        const std::string s_green = "\033[42m";
-        const std::string s_yellow = "\033[43m";
-        const std::string s_blue = "\033[44m";
-        const std::string s_magenta = "\033[45m";
-        const std::string s_cyan = "\033[46m";
-        const std::string s_white = "\033[47m";
-
-        const std::wstring ws_black = L"\033[40m";
-        const std::wstring ws_red = L"\033[41m";
-        const std::wstring ws_green = L"\033[42m";
-        const std::wstring ws_yellow = L"\033[43m";
-        const std::wstring ws_blue = L"\033[44m";
-        const std::wstring ws_magenta = L"\033[45m";
-        const std::wstring ws_cyan = L"\033[46m";
-        const std::wstring ws_white = L"\033[47m";
-
-        void hex256(unsigned char color) {
-            if (color < 0) {
-                color = 0;
-            }
-            if (color > 255) {
-                color = 255;
-            }
-            std::cout << "\033[48;5;" << color << "m";
+        inline constexpr const char* black = "\033[40m";
+        inline constexpr const char* red = "\033[41m";
+        inline constexpr const char* green = "\033[42m";
+        inline constexpr const char* yellow = "\033[43m";
+        inline constexpr const char* blue = "\033[44m";
+        inline constexpr const char* magenta = "\033[45m";
+        inline constexpr const char* cyan = "\033[46m";
+        inline constexpr const char* white = "\033[47m";
+
+        inline constexpr const wchar_t* w_black = L"\033[40m";
+        inline constexpr const wchar_t* w_red = L"\033[41m";
+        inline constexpr const wchar_t* w_green = L"\033[42m";
+        inline constexpr const wchar_t* w_yellow = L"\033[43m";
+        inline constexpr const wchar_t* w_blue = L"\033[44m";
+        inline constexpr const wchar_t* w_magenta = L"\033[45m";
+        inline constexpr const wchar_t* w_cyan = L"\033[46m";
+        inline constexpr const wchar_t* w_white = L"\033[47m";
+
+        inline constexpr std::string_view s_black = "\033[40m";
+        inline constexpr std::string_view s_red = "\033[41m";
+        inline constexpr std::string_view s_green = "\033[42m";
+        inline constexpr std::string_view s_yellow = "\033[43m";
+        inline constexpr std::string_view s_blue = "\033[44m";
+        inline constexpr std::string_view s_magenta = "\033[45m";
+        inline constexpr std::string_view s_cyan = "\033[46m";
+        inline constexpr std::string_view s_white = "\033[47m";
+
+        inline constexpr std::wstring_view ws_black = L"\033[40m";
+        inline constexpr std::wstring_view ws_red = L"\033[41m";
+        inline constexpr std::wstring_view ws_green = L"\033[42m";
+        inline constexpr std::wstring_view ws_yellow = L"\033[43m";
+        inline constexpr std::wstring_view ws_blue = L"\033[44m";
+        inline constexpr std::wstring_view ws_magenta = L"\033[45m";
+        inline constexpr std::wstring_view ws_cyan = L"\033[46m";
+        inline constexpr std::wstring_view ws_white = L"\033[47m";
+
+        inline void hex256(unsigned char color) {
+            char buffer[max_sequence];
+            std::cout.write(buffer, write_background(buffer, color, terminal::capabilities().color) - buffer);
         }
         
-        void setColor(unsigned char red, unsigned char green, unsigned char blue) {
-            if (red < 0) {
-                red = 0;
-            }
-            if (red > 255) {
-                red = 255;
-            }
-            if (green < 0) {
-                green = 0;
-            }
-            if (green > 255) {
-                green = 255;
-            }
-            if (blue < 0) {
-                blue = 0;
-            }
-            if (blue > 255) {
-                blue = 255;
-            }
-
-            std::cout << "\033[48;2;" << (short int)red << ";" << (short int)green << ";" << (short int)blue << "m";
+        inline void setColor(unsigned char red, unsigned char green, unsigned char blue) {
+            char buffer[max_sequence];
+            std::cout.write(buffer, write_background(buffer, red, green, blue, terminal::capabilities().color) - buffer);
         }
 
     }
 
     namespace cursor {
-        const char* hide = "\033[?25l";
-        const char* show = "\033[?25h";
-
-        void back (int x) {
-            std::cout << "\u001b[" << x << "D";
+        inline constexpr const char* hide = "\033[?25l";
+        inline constexpr const char* show = "\033[?25h";
+
+        inline void back (int x) {
+            char buffer[16] = { '\033', '[' };
+            char* end = std::to_chars(buffer + 2, buffer + sizeof(buffer) - 1, x).ptr;
+            *end++ = 'D';
+            std::cout.write(buffer, end - buffer);
         }
     }
 
     // Resets the console
-    void resetconsole() {
+    inline void resetconsole() {
         std::cout << ansi::reset;
         std::cout << ansi::cursor::show;
     }
 
     // Clears the console
-    void clearconsole() {
+    inline void clearconsole() {
         std::cout << ansi::clear;
     }
 
-    void registeratexit() {
+    inline void registeratexit() {
         // Reset the console when exiting
         std::atexit(resetconsole);
     }
 
-    void setColor(unsigned char color) {
-        if (color < 0) {
-            color = 0;
-        }
-        if (color > 255) {
-            color = 255;
-        }
-        std::cout << "\033[38;5;" << (short int)color << "m";
+    // The colour functions downsample to terminal::capabilities() and write nothing when stdout has no colours
+    inline void setColor(unsigned char color) {
+        char buffer[max_sequence];
+        std::cout.write(buffer, write_foreground(buffer, color, terminal::capabilities().color) - buffer);
     }
 
-    void setColor(unsigned char red, unsigned char green, unsigned char blue) {
-        if (red < 0) {
-            red = 0;
-        }
-        if (red > 255) {
-            red = 255;
-        }
-        if (green < 0) {
-            green = 0;
-        }
-        if (green > 255) {
-            green = 255;
-        }
-        if (blue < 0) {
-            blue = 0;
-        }
-        if (blue > 255) {
-            blue = 255;
-        }
-
-        std::cout << "\033[38;2;" << (short int)red << ";" << (short int)green << ";" << (short int)blue << "m";
+    inline void setColor(unsigned char red, unsigned char green, unsigned char blue) {
+        char buffer[max_sequence];
+        std::cout.write(buffer, write_foreground(buffer, red, green, blue, terminal::capabilities().color) - buffer);
     }
 
-    void setForeground(unsigned char color) {
-        if (color < 0) {
-            color = 0;
-        }
-        if (color > 255) {
-            color = 255;
-        }
-        std::cout << "\033[38;5;" << (short int)color << "m";
+    inline void setForeground(unsigned char color) {
+        char buffer[max_sequence];
+        std::cout.write(buffer, write_foreground(buffer, color, terminal::capabilities().color) - buffer);
     }
 
-    void setForeground(unsigned char red, unsigned char green, unsigned char blue) {
-        if (red < 0) {
-            red = 0;
-        }
-        if (red > 255) {
-            red = 255;
-        }
-        if (green < 0) {
-            green = 0;
-        }
-        if (green > 255) {
-            green = 255;
-        }
-        if (blue < 0) {
-            blue = 0;
-        }
-        if (blue > 255) {
-            blue = 255;
-        }
-
-        std::cout << "\033[38;2;" << (short int)red << ";" << (short int)green << ";" << (short int)blue << "m";
+    inline void setForeground(unsigned char red, unsigned char green, unsigned char blue) {
+        char buffer[max_sequence];
+        std::cout.write(buffer, write_foreground(buffer, red, green, blue, terminal::capabilities().color) - buffer);
     }
 
     
-    void setBackground(unsigned char color) {
-        if (color < 0) {
-            color = 0;
-        }
-        if (color > 255) {
-            color = 255;
-        }
-        std::cout << "\033[48;5;" << (short int)color << "m";
+    inline void setBackground(unsigned char color) {
+        char buffer[max_sequence];
+        std::cout.write(buffer, write_background(buffer, color, terminal::capabilities().color) - buffer);
     }
 
-    void setBackground(unsigned char red, unsigned char green, unsigned char blue) {
-        if (red < 0) {
-            red = 0;
-        }
-        if (red > 255) {
-            red = 255;
-        }
-        if (green < 0) {
-            green = 0;
-        }
-        if (green > 255) {
-            green = 255;
-        }
-        if (blue < 0) {
-            blue = 0;
-        }
-        if (blue > 255) {
-            blue = 255;
-        }
-
-        std::cout << "\033[48;2;" << (short int)red << ";" << (short int)green << ";" << (short int)blue << "m";
+    inline void setBackground(unsigned char red, unsigned char green, unsigned char blue) {
+        char buffer[max_sequence];
+        std::cout.write(buffer, write_background(buffer, red, green, blue, terminal::capabilities().color) - buffer);
     }
 }
 
@@ -0,0 +1,287 @@
+#ifndef CURVEHPP
+#define CURVEHPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "parallel.hpp"
+#include "simd.hpp"
+#include "vector.hpp"
+#include "vectorarray.hpp"
+
+// Space filling curves mapping 2D and 3D integer coordinates to a single 64 bit key and back
+// Points sorted by their key are close in memory when they are close in space
+//
+// Morton (Z order) codes interleave the coordinate bits. Hilbert codes cost more to compute but never jump, consecutive
+// keys are always neighbouring cells, which gives slightly better locality after sorting.
+namespace curve {
+
+    enum class Type {
+        morton,
+        hilbert
+    };
+
+    // Bits per coordinate, 32 in 2D and 21 in 3D so a key fits 64 bits
+    template<std::size_t N>
+    constexpr unsigned bits = N == 2 ? 32 : 21;
+
+    namespace detail {
+        // Spreads the low 32 bits of x to the even bits
+        constexpr std::uint64_t spread2(std::uint64_t x) {
+            x &= 0xFFFFFFFFull;
+            x = (x | x << 16) & 0x0000FFFF0000FFFFull;
+            x = (x | x << 8) & 0x00FF00FF00FF00FFull;
+            x = (x | x << 4) & 0x0F0F0F0F0F0F0F0Full;
+            x = (x | x << 2) & 0x3333333333333333ull;
+            x = (x | x << 1) & 0x5555555555555555ull;
+            return x;
+        }
+
+        // Gathers the even bits of x to the low 32 bits
+        constexpr std::uint32_t compact2(std::uint64_t x) {
+            x &= 0x5555555555555555ull;
+            x = (x | x >> 1) & 0x3333333333333333ull;
+            x = (x | x >> 2) & 0x0F0F0F0F0F0F0F0Full;
+            x = (x | x >> 4) & 0x00FF00FF00FF00FFull;
+            x = (x | x >> 8) & 0x0000FFFF0000FFFFull;
+            x = (x | x >> 16) & 0x00000000FFFFFFFFull;
+            return (std::uint32_t)x;
+        }
+
+        // Spreads the low 21 bits of x to every third bit
+        constexpr std::uint64_t spread3(std::uint64_t x) {
+            x &= 0x1FFFFFull;
+            x = (x | x << 32) & 0x001F00000000FFFFull;
+            x = (x | x << 16) & 0x001F0000FF0000FFull;
+            x = (x | x << 8) & 0x100F00F00F00F00Full;
+            x = (x | x << 4) & 0x10C30C30C30C30C3ull;
+            x = (x | x << 2) & 0x1249249249249249ull;
+            return x;
+        }
+
+        // Gathers every third bit of x to the low 21 bits
+        constexpr std::uint32_t compact3(std::uint64_t x) {
+            x &= 0x1249249249249249ull;
+            x = (x | x >> 2) & 0x10C30C30C30C30C3ull;
+            x = (x | x >> 4) & 0x100F00F00F00F00Full;
+            x = (x | x >> 8) & 0x001F0000FF0000FFull;
+            x = (x | x >> 16) & 0x001F00000000FFFFull;
+            x = (x | x >> 32) & 0x00000000001FFFFFull;
+            return (std::uint32_t)x;
+        }
+
+        constexpr std::uint64_t mask2 = 0x5555555555555555ull;
+        constexpr std::uint64_t mask3 = 0x1249249249249249ull;
+    }
+
+    // Interleaves the bits of x and y, x takes the even bits
+    // With BMI2 this is a pdep per axis, which is microcoded and slower than the shifts on AMD before Zen 3
+    constexpr std::uint64_t morton(const Vec2<std::uint32_t> &v) {
+#if defined(EXTLIB_BMI2)
+        if (!std::is_constant_evaluated()) {
+            return _pdep_u64(v.x, detail::mask2) | _pdep_u64(v.y, detail::mask2 << 1);
+        }
+#endif
+        return detail::spread2(v.x) | detail::spread2(v.y) << 1;
+    }
+
+    // Interleaves the low 21 bits of x, y and z, x takes bits 0, 3, 6...
+    constexpr std::uint64_t morton(const Vec3<std::uint32_t> &v) {
+#if defined(EXTLIB_BMI2)
+        if (!std::is_constant_evaluated()) {
+            return _pdep_u64(v.x, detail::mask3) | _pdep_u64(v.y, detail::mask3 << 1) | _pdep_u64(v.z, detail::mask3 << 2);
+        }
+#endif
+        return detail::spread3(v.x) | detail::spread3(v.y) << 1 | detail::spread3(v.z) << 2;
+    }
+
+    // Returns the coordinates of a Morton code
+    template<std::size_t N>
+    constexpr Vec<std::uint32_t, N> morton_decode(std::uint64_t code) {
+        static_assert(N == 2 || N == 3, "Morton codes support 2 and 3 dimensions");
+#if defined(EXTLIB_BMI2)
+        if (!std::is_constant_evaluated()) {
+            if constexpr (N == 2) {
+                return Vec<std::uint32_t, N>((std::uint32_t)_pext_u64(code, detail::mask2), (std::uint32_t)_pext_u64(code, detail::mask2 << 1));
+            } else {
+                return Vec<std::uint32_t, N>((std::uint32_t)_pext_u64(code, detail::mask3), (std::uint32_t)_pext_u64(code, detail::mask3 << 1), (std::uint32_t)_pext_u64(code, detail::mask3 << 2));
+            }
+        }
+#endif
+        if constexpr (N == 2) {
+            return Vec<std::uint32_t, N>(detail::compact2(code), detail::compact2(code >> 1));
+        } else {
+            return Vec<std::uint32_t, N>(detail::compact3(code), detail::compact3(code >> 1), detail::compact3(code >> 2));
+        }
+    }
+
+    namespace detail {
+        // Skilling's transform, "Programming the Hilbert curve" (2004), the Hilbert index is the transposed
+        // coordinates interleaved with the first axis as the most significant bit of every group
+
+        // Inverts the low bits of x[0] when bit q of x[i] is set, swaps them between x[0] and x[i] otherwise
+        // Written without branches, the bits are random and a branch mispredicts half the time
+        template<std::size_t N>
+        constexpr void step(std::uint32_t (&x)[N], std::size_t i, std::uint32_t q) {
+            const std::uint32_t p = q - 1;
+            const std::uint32_t set = 0u - ((x[i] & q) != 0);
+            x[0] ^= p & set;
+            std::uint32_t t = (x[0] ^ x[i]) & p & ~set;
+            x[0] ^= t;
+            x[i] ^= t;
+        }
+
+        template<std::size_t N>
+        constexpr void axes_to_transpose(std::uint32_t (&x)[N]) {
+            const std::uint32_t m = (std::uint32_t)1 << (bits<N> - 1);
+            for (std::uint32_t q = m; q > 1; q >>= 1) {
+                Vec<std::uint32_t, N>::template unroll<0, N>([&](std::size_t i) { step(x, i, q); });
+            }
+            // Gray encode
+            for (std::size_t i = 1; i < N; i++) {
+                x[i] ^= x[i - 1];
+            }
+            std::uint32_t t = 0;
+            for (std::uint32_t q = m; q > 1; q >>= 1) {
+                t ^= (q - 1) & (0u - ((x[N - 1] & q) != 0));
+            }
+            for (std::size_t i = 0; i < N; i++) {
+                x[i] ^= t;
+            }
+        }
+
+        template<std::size_t N>
+        constexpr void transpose_to_axes(std::uint32_t (&x)[N]) {
+            // Gray decode
+            std::uint32_t gray = x[N - 1] >> 1;
+            for (std::size_t i = N - 1; i > 0; i--) {
+                x[i] ^= x[i - 1];
+            }
+            x[0] ^= gray;
+            // 64 bit so the loop also ends for 32 bit coordinates
+            for (std::uint64_t q = 2; q != (std::uint64_t)1 << bits<N>; q <<= 1) {
+                Vec<std::uint32_t, N>::template unroll<0, N>([&](std::size_t i) { step(x, N - 1 - i, (std::uint32_t)q); });
+            }
+        }
+    }
+
+    // Returns the distance of the cell v along the Hilbert curve, coordinates past bits<N> are ignored
+    template<std::size_t N>
+    constexpr std::uint64_t hilbert(const Vec<std::uint32_t, N> &v) {
+        static_assert(N == 2 || N == 3, "Hilbert codes support 2 and 3 dimensions");
+        constexpr std::uint32_t mask = (std::uint32_t)(((std::uint64_t)1 << bits<N>) - 1);
+        std::uint32_t x[N];
+        for (std::size_t i = 0; i < N; i++) {
+            x[i] = v.get(i) & mask;
+        }
+        detail::axes_to_transpose(x);
+        if constexpr (N == 2) {
+            return morton(Vec2<std::uint32_t>(x[1], x[0]));
+        } else {
+            return morton(Vec3<std::uint32_t>(x[2], x[1], x[0]));
+        }
+    }
+
+    // Returns the cell at distance code along the Hilbert curve
+    template<std::size_t N>
+    constexpr Vec<std::uint32_t, N> hilbert_decode(std::uint64_t code) {
+        static_assert(N == 2 || N == 3, "Hilbert codes support 2 and 3 dimensions");
+        Vec<std::uint32_t, N> t = morton_decode<N>(code);
+        std::uint32_t x[N];
+        for (std::size_t i = 0; i < N; i++) {
+            x[i] = t.get(N - 1 - i);
+        }
+        detail::transpose_to_axes(x);
+        Vec<std::uint32_t, N> out;
+        for (std::size_t i = 0; i < N; i++) {
+            out.get(i) = x[i];
+        }
+        return out;
+    }
+
+    template<std::size_t N>
+    constexpr std::uint64_t encode(const Vec<std::uint32_t, N> &v, Type type) {
+        return type == Type::hilbert ? hilbert(v) : morton(v);
+    }
+
+    template<std::size_t N>
+    constexpr Vec<std::uint32_t, N> decode(std::uint64_t code, Type type) {
+        return type == Type::hilbert ? hilbert_decode<N>(code) : morton_decode<N>(code);
+    }
+
+    // Maps p from the box [min, max] to the integer grid with bits<N> bits per axis, points outside are clamped
+    template<typename T, std::size_t N>
+    inline Vec<std::uint32_t, N> quantize(const Vec<T, N> &p, const Vec<T, N> &min, const Vec<T, N> &max) {
+        static_assert(N == 2 || N == 3, "Points are quantized in 2 and 3 dimensions");
+        constexpr double cells = (double)(((std::uint64_t)1 << bits<N>) - 1);
+        Vec<std::uint32_t, N> out;
+        for (std::size_t i = 0; i < N; i++) {
+            double extent = (double)max.get(i) - (double)min.get(i);
+            double f = extent > 0 ? ((double)p.get(i) - (double)min.get(i)) / extent * cells : 0;
+            // Also maps NaN to 0
+            f = f > 0 ? f : 0;
+            f = f < cells ? f : cells;
+            out.get(i) = (std::uint32_t)(f + 0.5);
+        }
+        return out;
+    }
+
+    // out[i] = key of points[i] within the bounds of all points
+    template<typename T, std::size_t N>
+    inline void keys(std::span<const Vec<T, N>> points, std::span<std::uint64_t> out, Type type = Type::hilbert, std::size_t threads = 0) {
+        if (out.size() < points.size()) {
+            throw std::invalid_argument("Output span too small");
+        }
+        if (points.empty()) {
+            return;
+        }
+        parallel::Bounds<T, N> box = parallel::bounds(points, threads);
+        parallel::transform(points, out, [&](const Vec<T, N> &p) {
+            return encode(quantize(p, box.min, box.max), type);
+        }, threads);
+    }
+
+    // Returns the order that sorts points along the curve, order[i] is the index of the point that goes to i
+    template<typename T, std::size_t N>
+    inline std::vector<std::uint32_t> order(std::span<const Vec<T, N>> points, Type type = Type::hilbert, std::size_t threads = 0) {
+        if (points.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::invalid_argument("Too many points");
+        }
+        std::vector<std::uint64_t> codes(points.size());
+        keys(points, std::span<std::uint64_t>(codes), type, threads);
+        std::vector<std::uint32_t> out(points.size());
+        for (std::size_t i = 0; i < out.size(); i++) {
+            out[i] = (std::uint32_t)i;
+        }
+        parallel::radix_sort(std::span<std::uint64_t>(codes), std::span<std::uint32_t>(out), threads);
+        return out;
+    }
+
+    // Sorts points along the curve, returns the order so other arrays can follow with parallel::gather
+    template<typename T, std::size_t N>
+    inline std::vector<std::uint32_t> sort(std::span<Vec<T, N>> points, Type type = Type::hilbert, std::size_t threads = 0) {
+        std::vector<std::uint32_t> indices = order(std::span<const Vec<T, N>>(points), type, threads);
+        std::vector<Vec<T, N>> copy(points.begin(), points.end());
+        parallel::gather(std::span<const Vec<T, N>>(copy), std::span<const std::uint32_t>(indices), points, threads);
+        return indices;
+    }
+
+    template<typename T, std::size_t N>
+    inline std::vector<std::uint32_t> sort(VecArray<T, N> &points, Type type = Type::hilbert, std::size_t threads = 0) {
+        std::vector<Vec<T, N>> aos = points.to_vector();
+        std::vector<std::uint32_t> indices = order(std::span<const Vec<T, N>>(aos), type, threads);
+        soa::lane<T> lane(points.size());
+        for (std::size_t k = 0; k < N; k++) {
+            parallel::gather(std::span<const T>(points.lanes[k]), std::span<const std::uint32_t>(indices), std::span<T>(lane), threads);
+            points.lanes[k].swap(lane);
+        }
+        return indices;
+    }
+}
+
+#endif
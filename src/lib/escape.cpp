@@ -0,0 +1,344 @@
+#include "./escape.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#include "./simd.hpp"
+
+namespace ansi {
+
+    namespace {
+        constexpr char esc = '\033';
+
+        struct Range {
+            char32_t first;
+            char32_t last;
+        };
+
+        // Combining marks, zero width spaces and joiners, variation selectors and emoji modifiers
+        constexpr Range zero_width[] = {
+            { 0x0300, 0x036F }, { 0x0483, 0x0489 }, { 0x0591, 0x05C7 }, { 0x0610, 0x061A }, { 0x064B, 0x065F },
+            { 0x0670, 0x0670 }, { 0x06D6, 0x06ED }, { 0x0900, 0x0903 }, { 0x093A, 0x094F }, { 0x0E31, 0x0E31 },
+            { 0x0E34, 0x0E3A }, { 0x0E47, 0x0E4E }, { 0x1160, 0x11FF }, { 0x1AB0, 0x1AFF }, { 0x1DC0, 0x1DFF },
+            { 0x200B, 0x200F }, { 0x2028, 0x202E }, { 0x2060, 0x2064 }, { 0x20D0, 0x20FF }, { 0xFE00, 0xFE0F },
+            { 0xFE20, 0xFE2F }, { 0xFEFF, 0xFEFF }, { 0x1F3FB, 0x1F3FF }, { 0xE0001, 0xE007F }, { 0xE0100, 0xE01EF },
+        };
+
+        // East Asian wide and fullwidth characters and emoji drawn as two columns
+        constexpr Range wide[] = {
+            { 0x1100, 0x115F }, { 0x231A, 0x231B }, { 0x2329, 0x232A }, { 0x23E9, 0x23EC }, { 0x23F0, 0x23F0 },
+            { 0x23F3, 0x23F3 }, { 0x25FD, 0x25FE }, { 0x2614, 0x2615 }, { 0x2648, 0x2653 }, { 0x267F, 0x267F },
+            { 0x2693, 0x2693 }, { 0x26A1, 0x26A1 }, { 0x26AA, 0x26AB }, { 0x26BD, 0x26BE }, { 0x26C4, 0x26C5 },
+            { 0x26CE, 0x26CE }, { 0x26D4, 0x26D4 }, { 0x26EA, 0x26EA }, { 0x26F2, 0x26F3 }, { 0x26F5, 0x26F5 },
+            { 0x26FA, 0x26FA }, { 0x26FD, 0x26FD }, { 0x2705, 0x2705 }, { 0x270A, 0x270B }, { 0x2728, 0x2728 },
+            { 0x274C, 0x274C }, { 0x274E, 0x274E }, { 0x2753, 0x2755 }, { 0x2757, 0x2757 }, { 0x2795, 0x2797 },
+            { 0x27B0, 0x27B0 }, { 0x27BF, 0x27BF }, { 0x2B1B, 0x2B1C }, { 0x2B50, 0x2B50 }, { 0x2B55, 0x2B55 },
+            { 0x2E80, 0x303E }, { 0x3041, 0x33FF }, { 0x3400, 0x4DBF }, { 0x4E00, 0x9FFF }, { 0xA000, 0xA4CF },
+            { 0xA960, 0xA97F }, { 0xAC00, 0xD7A3 }, { 0xF900, 0xFAFF }, { 0xFE10, 0xFE19 }, { 0xFE30, 0xFE6F },
+            { 0xFF00, 0xFF60 }, { 0xFFE0, 0xFFE6 }, { 0x16FE0, 0x16FE4 }, { 0x17000, 0x18CFF }, { 0x1B000, 0x1B2FF },
+            { 0x1F004, 0x1F004 }, { 0x1F0CF, 0x1F0CF }, { 0x1F18E, 0x1F18E }, { 0x1F191, 0x1F19A }, { 0x1F200, 0x1F251 },
+            { 0x1F300, 0x1F64F }, { 0x1F680, 0x1F6FF }, { 0x1F7E0, 0x1F7EB }, { 0x1F90C, 0x1F9FF }, { 0x1FA70, 0x1FAFF },
+            { 0x20000, 0x2FFFD }, { 0x30000, 0x3FFFD },
+        };
+
+        template<std::size_t N>
+        inline bool contains(const Range (&ranges)[N], char32_t c) {
+            const Range* it = std::upper_bound(ranges, ranges + N, c, [](char32_t value, const Range &range) { return value < range.first; });
+            return it != ranges && c <= (it - 1)->last;
+        }
+
+        // Decodes the code point at p[i] and advances i, malformed sequences decode to U+FFFD one byte at a time
+        inline char32_t next_utf8(const char* p, std::size_t n, std::size_t &i) {
+            const unsigned char lead = (unsigned char)p[i++];
+            if (lead < 0x80) {
+                return lead;
+            }
+            const std::size_t extra = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : 0;
+            if (extra == 0 || lead > 0xF4 || i + extra > n) {
+                return 0xFFFD;
+            }
+            char32_t c = lead & (0x3F >> extra);
+            for (std::size_t k = 0; k < extra; k++) {
+                const unsigned char byte = (unsigned char)p[i + k];
+                if ((byte & 0xC0) != 0x80) {
+                    return 0xFFFD;
+                }
+                c = (c << 6) | (byte & 0x3F);
+            }
+            // Overlong encodings
+            constexpr char32_t smallest[4] = { 0, 0x80, 0x800, 0x10000 };
+            if (c < smallest[extra]) {
+                return 0xFFFD;
+            }
+            i += extra;
+            return c;
+        }
+
+        // Returns the index of the first byte at or after i that is not printable ASCII, n when there is none
+        // Signed bytes below 0x20 are the control characters, ESC among them, and everything from 0x80 up
+        inline std::size_t find_special(const char* p, std::size_t i, std::size_t n) {
+#if defined(EXTLIB_AVX2)
+            const __m256i space = _mm256_set1_epi8(0x20);
+            const __m256i del = _mm256_set1_epi8(0x7F);
+            for (; i + 32 <= n; i += 32) {
+                const __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+                const __m256i special = _mm256_or_si256(_mm256_cmpgt_epi8(space, v), _mm256_cmpeq_epi8(v, del));
+                const unsigned mask = (unsigned)_mm256_movemask_epi8(special);
+                if (mask != 0) {
+                    return i + std::countr_zero(mask);
+                }
+            }
+#endif
+#if defined(EXTLIB_SSE2)
+            const __m128i space16 = _mm_set1_epi8(0x20);
+            const __m128i del16 = _mm_set1_epi8(0x7F);
+            for (; i + 16 <= n; i += 16) {
+                const __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+                const __m128i special = _mm_or_si128(_mm_cmplt_epi8(v, space16), _mm_cmpeq_epi8(v, del16));
+                const unsigned mask = (unsigned)_mm_movemask_epi8(special);
+                if (mask != 0) {
+                    return i + std::countr_zero(mask);
+                }
+            }
+#endif
+            for (; i < n; i++) {
+                const signed char c = (signed char)p[i];
+                if (c < 0x20 || c == 0x7F) {
+                    return i;
+                }
+            }
+            return n;
+        }
+
+        inline std::uint8_t clamp_byte(unsigned value) {
+            return (std::uint8_t)std::min(value, 255u);
+        }
+    }
+
+    std::size_t find_escape(std::string_view text, std::size_t from) {
+        const char* p = text.data();
+        const std::size_t n = text.size();
+        std::size_t i = from;
+#if defined(EXTLIB_AVX2)
+        const __m256i escape = _mm256_set1_epi8(esc);
+        for (; i + 32 <= n; i += 32) {
+            const unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + i)), escape));
+            if (mask != 0) {
+                return i + std::countr_zero(mask);
+            }
+        }
+#endif
+#if defined(EXTLIB_SSE2)
+        const __m128i escape16 = _mm_set1_epi8(esc);
+        for (; i + 16 <= n; i += 16) {
+            const unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + i)), escape16));
+            if (mask != 0) {
+                return i + std::countr_zero(mask);
+            }
+        }
+#endif
+        if (i >= n) {
+            return n;
+        }
+        const void* hit = std::memchr(p + i, esc, n - i);
+        return hit != nullptr ? (std::size_t)((const char*)hit - p) : n;
+    }
+
+    std::size_t sequence_length(std::string_view text, std::size_t at) {
+        const std::size_t n = text.size();
+        std::size_t i = at + 1;
+        if (i >= n) {
+            return n - at;
+        }
+        unsigned char c = (unsigned char)text[i];
+        if (c == '[') {
+            // Parameters and intermediates up to a final byte, a byte outside the grammar ends it early
+            for (i++; i < n; i++) {
+                c = (unsigned char)text[i];
+                if (c >= 0x40 && c <= 0x7E) {
+                    return i + 1 - at;
+                }
+                if (c < 0x20 || c > 0x7E) {
+                    return i - at;
+                }
+            }
+            return n - at;
+        }
+        if (c == ']' || c == 'P' || c == '_' || c == '^' || c == 'X') {
+            // String sequences end with ESC \, OSC also with BEL
+            for (i++; i < n; i++) {
+                c = (unsigned char)text[i];
+                if (c == '\a') {
+                    return i + 1 - at;
+                }
+                if (c == (unsigned char)esc) {
+                    return i + 1 < n && text[i + 1] == '\\' ? i + 2 - at : i - at;
+                }
+            }
+            return n - at;
+        }
+        // Intermediates and a final byte, ESC c, ESC 7, ESC ( B
+        while (c >= 0x20 && c <= 0x2F && ++i < n) {
+            c = (unsigned char)text[i];
+        }
+        if (i < n && c >= 0x30 && c <= 0x7E) {
+            return i + 1 - at;
+        }
+        return i - at;
+    }
+
+    std::size_t strip(std::string_view text, char* out) {
+        const std::size_t n = text.size();
+        std::size_t written = 0;
+        std::size_t i = 0;
+        while (i < n) {
+            const std::size_t end = find_escape(text, i);
+            // memmove, out may be the text itself
+            std::memmove(out + written, text.data() + i, end - i);
+            written += end - i;
+            if (end == n) {
+                break;
+            }
+            i = end + sequence_length(text, end);
+        }
+        return written;
+    }
+
+    std::string strip(std::string_view text) {
+        std::string out(text.size(), '\0');
+        out.resize(strip(text, out.data()));
+        return out;
+    }
+
+    int column_width(char32_t c) {
+        if (c < 0x20 || (c >= 0x7F && c < 0xA0)) {
+            return 0;
+        }
+        if (c < 0x300) {
+            return 1;
+        }
+        if (contains(zero_width, c)) {
+            return 0;
+        }
+        return contains(wide, c) ? 2 : 1;
+    }
+
+    std::size_t visible_width(std::string_view text) {
+        const char* p = text.data();
+        const std::size_t n = text.size();
+        std::size_t width = 0;
+        std::size_t i = 0;
+        while (i < n) {
+            // Printable ASCII is one column a byte and gets skipped a vector at a time
+            const std::size_t special = find_special(p, i, n);
+            width += special - i;
+            i = special;
+            if (i == n) {
+                break;
+            }
+            if (p[i] == esc) {
+                i += sequence_length(text, i);
+            } else if ((unsigned char)p[i] < 0x80) {
+                i++;
+            } else {
+                width += (std::size_t)column_width(next_utf8(p, n, i));
+            }
+        }
+        return width;
+    }
+
+    void Style::apply(std::string_view params) {
+        // Parameters past the first 32 are ignored, no sequence ansi writes comes close
+        unsigned values[32];
+        std::size_t count = 0;
+        unsigned value = 0;
+        for (char c : params) {
+            if (c == ';' || c == ':') {
+                if (count < 32) {
+                    values[count++] = value;
+                }
+                value = 0;
+            } else if (c >= '0' && c <= '9') {
+                value = std::min(value * 10 + (unsigned)(c - '0'), 65535u);
+            }
+        }
+        if (count < 32) {
+            values[count++] = value;
+        }
+
+        for (std::size_t k = 0; k < count; k++) {
+            const unsigned code = values[k];
+            if (code >= 30 && code <= 37) {
+                fg = Color::indexed((std::uint8_t)(code - 30));
+            } else if (code >= 40 && code <= 47) {
+                bg = Color::indexed((std::uint8_t)(code - 40));
+            } else if (code >= 90 && code <= 97) {
+                fg = Color::indexed((std::uint8_t)(code - 90 + 8));
+            } else if (code >= 100 && code <= 107) {
+                bg = Color::indexed((std::uint8_t)(code - 100 + 8));
+            } else if (code == 38 || code == 48) {
+                Color color;
+                if (k + 2 < count && values[k + 1] == 5) {
+                    color = Color::indexed(clamp_byte(values[k + 2]));
+                    k += 2;
+                } else if (k + 4 < count && values[k + 1] == 2) {
+                    color = Color::rgb(clamp_byte(values[k + 2]), clamp_byte(values[k + 3]), clamp_byte(values[k + 4]));
+                    k += 4;
+                } else {
+                    // Malformed, the rest cannot be told apart from its arguments
+                    return;
+                }
+                (code == 38 ? fg : bg) = color;
+            } else {
+                switch (code) {
+                    case 0: *this = Style(); break;
+                    case 1: attributes |= attribute::bold; break;
+                    case 2: attributes |= attribute::dim; break;
+                    case 3: attributes |= attribute::italic; break;
+                    case 4: attributes |= attribute::underline; break;
+                    case 5: case 6: attributes |= attribute::blink; break;
+                    case 7: attributes |= attribute::inverse; break;
+                    case 9: attributes |= attribute::crossed; break;
+                    case 53: attributes |= attribute::overline; break;
+                    case 22: attributes &= (std::uint8_t)~(attribute::bold | attribute::dim); break;
+                    case 23: attributes &= (std::uint8_t)~attribute::italic; break;
+                    case 24: attributes &= (std::uint8_t)~attribute::underline; break;
+                    case 25: attributes &= (std::uint8_t)~attribute::blink; break;
+                    case 27: attributes &= (std::uint8_t)~attribute::inverse; break;
+                    case 29: attributes &= (std::uint8_t)~attribute::crossed; break;
+                    case 55: attributes &= (std::uint8_t)~attribute::overline; break;
+                    case 39: fg = Color::none(); break;
+                    case 49: bg = Color::none(); break;
+                    default: break;
+                }
+            }
+        }
+    }
+
+    bool Scanner::next(Token &token) {
+        if (offset >= text.size()) {
+            return false;
+        }
+        if (text[offset] != esc) {
+            const std::size_t end = find_escape(text, offset);
+            token = { Token::Kind::text, text.substr(offset, end - offset), {} };
+            offset = end;
+            return true;
+        }
+        const std::size_t length = sequence_length(text, offset);
+        const std::string_view bytes = text.substr(offset, length);
+        offset += length;
+        // CSI sequences ending in m with private markers, ESC [ > 4 ; 2 m, are not SGR
+        if (length >= 3 && bytes[1] == '[' && bytes.back() == 'm') {
+            const std::string_view params = bytes.substr(2, length - 3);
+            if (params.find_first_not_of("0123456789;:") == std::string_view::npos) {
+                current.apply(params);
+                token = { Token::Kind::sgr, bytes, params };
+                return true;
+            }
+        }
+        token = { Token::Kind::escape, bytes, {} };
+        return true;
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef ESCAPEHPP
+#define ESCAPEHPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "screen.hpp"
+
+// Scanning of text holding ANSI escape sequences
+//
+// Escape sequences are found with a SIMD search for ESC, the text between them is copied or measured a block at a
+// time. Recognized are CSI sequences (ESC [ ... final byte), string sequences (OSC, DCS, APC, PM and SOS, ended by
+// BEL or ESC \) and two byte escapes, a sequence cut off by the end of the input runs to the end.
+namespace ansi {
+
+    // Returns the index of the first ESC in text at or after from, text.size() when there is none
+    std::size_t find_escape(std::string_view text, std::size_t from = 0);
+
+    // Returns the length of the escape sequence starting at text[at], which has to be an ESC
+    std::size_t sequence_length(std::string_view text, std::size_t at);
+
+    // Copies text without its escape sequences to out, which needs text.size() chars and may be text itself
+    // Returns the number of chars written
+    std::size_t strip(std::string_view text, char* out);
+
+    // Returns text without its escape sequences
+    std::string strip(std::string_view text);
+
+    // Returns the number of terminal columns of a code point, 0 for control and combining characters, 2 for wide ones
+    // East Asian wide and fullwidth ranges and the emoji blocks are wide, a table of the common ranges and not a full
+    // implementation of Unicode's East Asian Width
+    int column_width(char32_t c);
+
+    // Returns the number of columns text takes on one line, escape sequences take none
+    // Malformed UTF-8 counts one column per byte
+    std::size_t visible_width(std::string_view text);
+
+    /**
+     * @brief The colours and attributes set by SGR sequences
+     */
+    struct Style {
+        Color fg;
+        Color bg;
+        std::uint8_t attributes = attribute::none;
+
+        constexpr bool operator == (const Style &other) const = default;
+
+        // Applies the parameters of an SGR sequence, the text between ESC [ and m
+        void apply(std::string_view params);
+    };
+
+    /**
+     * @brief A piece of scanned text, a run of plain text or a single escape sequence
+     */
+    struct Token {
+        enum class Kind : std::uint8_t {
+            text,   // Plain text without escapes
+            sgr,    // ESC [ params m, params holds the parameters
+            escape, // Any other escape sequence
+        };
+
+        Kind kind = Kind::text;
+        // The bytes of the token in the scanned text
+        std::string_view bytes;
+        // Parameters of an SGR sequence, empty for the other kinds
+        std::string_view params;
+    };
+
+    /**
+     * @brief Splits text into tokens and tracks the style the SGR sequences set
+     *
+     * The text is not copied, it has to outlive the tokens.
+     */
+    class Scanner {
+    public:
+        inline explicit Scanner(std::string_view text, Style style = Style()) : text(text), current(style) {}
+
+        // Reads the next token, returns false at the end of the text
+        // After an SGR token style() holds the style it leaves
+        bool next(Token &token);
+
+        // Style in effect at the current position
+        inline const Style& style() const { return current; };
+
+        // Index of the next unread byte
+        inline std::size_t position() const { return offset; };
+
+    private:
+        std::string_view text;
+        std::size_t offset = 0;
+        Style current;
+    };
+}
+
+#endif
@@ -1,5 +1,8 @@
 #include "memory.hpp"
 
+#include <algorithm>
+
+#if defined(_WIN32)
 MEMORYSTATUSEX getSystemMemory()
 {
     MEMORYSTATUSEX status;
@@ -7,3 +10,65 @@ MEMORYSTATUSEX getSystemMemory()
     GlobalMemoryStatusEx(&status);
     return status;
 };
+#endif
+
+namespace memory {
+
+    Arena::Arena(std::size_t block_size, std::pmr::memory_resource* upstream)
+        : upstream(upstream), block_size(std::max<std::size_t>(block_size, alignment)) {}
+
+    Arena::~Arena() {
+        release();
+    }
+
+    void Arena::release() {
+        for (const Block &block : blocks) {
+            upstream->deallocate(block.data, block.size, alignment);
+        }
+        blocks.clear();
+        current = 0;
+        used = 0;
+    }
+
+    std::size_t Arena::size() const {
+        std::size_t out = used;
+        for (std::size_t i = 0; i < current && i < blocks.size(); i++) {
+            out += blocks[i].size;
+        }
+        return out;
+    }
+
+    std::size_t Arena::capacity() const {
+        std::size_t out = 0;
+        for (const Block &block : blocks) {
+            out += block.size;
+        }
+        return out;
+    }
+
+    void* Arena::grow(std::size_t bytes, std::size_t align) {
+        // Blocks are only aligned to alignment, larger alignments need room to shift the start
+        const std::size_t slack = align > alignment ? align : 0;
+        if (bytes > (std::size_t)-1 - slack - alignment) {
+            throw std::bad_alloc();
+        }
+        const std::size_t needed = align_up(bytes, alignment) + slack;
+        // Blocks kept from earlier frames are reused before allocating
+        std::size_t next = blocks.empty() ? 0 : current + 1;
+        while (next < blocks.size() && blocks[next].size < needed) {
+            next++;
+        }
+        if (next == blocks.size()) {
+            // Every block is at least twice the last, so a growing frame needs few of them
+            std::size_t size = std::max(block_size, needed);
+            if (!blocks.empty()) {
+                size = std::max(size, blocks.back().size * 2);
+            }
+            blocks.reserve(blocks.size() + 1);
+            blocks.push_back({ static_cast<std::byte*>(upstream->allocate(size, alignment)), size });
+        }
+        current = next;
+        used = 0;
+        return do_allocate(bytes, align);
+    }
+}
@@ -1,3 +1,274 @@
+#ifndef MEMORYHPP
+#define MEMORYHPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../simd.hpp"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
 #include <windows.h>
 
-MEMORYSTATUSEX getSystemMemory();
\ No newline at end of file
+MEMORYSTATUSEX getSystemMemory();
+#endif
+
+// Allocators for short lived and fixed size data
+//
+// Arena hands out memory by bumping a pointer and frees everything at once with reset, Pool recycles slots of a
+// single type through a free list. Both get their blocks from an upstream std::pmr::memory_resource, 64 byte aligned
+// by default so SIMD lanes never straddle a cache line.
+namespace memory {
+
+    // Alignment of every block, one cache line
+    constexpr std::size_t alignment = simd::alignment;
+
+    // Rounds n up to a multiple of align, align must be a power of two
+    constexpr std::size_t align_up(std::size_t n, std::size_t align) {
+        return (n + align - 1) & ~(align - 1);
+    };
+
+    // Standard allocator aligning every allocation to Align bytes, std::vector<vec4f, memory::aligned_allocator<vec4f>>
+    template<typename T, std::size_t Align = alignment>
+    using aligned_allocator = simd::aligned_allocator<T, Align>;
+
+    template<typename T, std::size_t Align = alignment>
+    using aligned_vector = std::vector<T, aligned_allocator<T, Align>>;
+
+    /**
+     * @brief Memory resource aligning every allocation to at least Align bytes, backed by the aligned operator new
+     *
+     * @tparam Align Minimum alignment in bytes
+     */
+    template<std::size_t Align = alignment>
+    class AlignedResource final : public std::pmr::memory_resource {
+        static_assert((Align & (Align - 1)) == 0, "Alignment must be a power of two");
+
+    protected:
+        inline void* do_allocate(std::size_t bytes, std::size_t align) override {
+            return ::operator new(bytes, std::align_val_t(align > Align ? align : Align));
+        }
+
+        inline void do_deallocate(void* p, std::size_t bytes, std::size_t align) override {
+            ::operator delete(p, bytes, std::align_val_t(align > Align ? align : Align));
+        }
+
+        inline bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+            return dynamic_cast<const AlignedResource*>(&other) != nullptr;
+        }
+    };
+
+    // Returns the process wide 64 byte aligned resource
+    inline std::pmr::memory_resource* aligned_resource() {
+        static AlignedResource<> resource;
+        return &resource;
+    }
+
+    /**
+     * @brief Monotonic arena, allocations bump a pointer and are only freed all at once
+     *
+     * Meant for per frame temporaries: allocate during the frame, reset at its end. Blocks are kept across resets,
+     * so once the arena has grown to the peak size of a frame it no longer calls upstream. Destructors of objects in
+     * the arena are never run.
+     *
+     * Usable directly, as the resource of std::pmr containers, or through std::pmr::polymorphic_allocator.
+     */
+    class Arena final : public std::pmr::memory_resource {
+    public:
+        // A position to rewind to, everything allocated after it is freed
+        struct Marker {
+            std::size_t block;
+            std::size_t used;
+        };
+
+        explicit Arena(std::size_t block_size = 1 << 20, std::pmr::memory_resource* upstream = aligned_resource());
+        ~Arena() override;
+
+        Arena(const Arena &) = delete;
+        Arena& operator = (const Arena &) = delete;
+
+        // Returns count default initialized objects of T, T has to be trivially destructible
+        template<typename T>
+        inline std::span<T> allocate_array(std::size_t count, std::size_t align = alignof(T)) {
+            static_assert(std::is_trivially_destructible_v<T>, "Arena never runs destructors");
+            if (count > (std::size_t)-1 / sizeof(T)) {
+                throw std::bad_array_new_length();
+            }
+            T* p = static_cast<T*>(allocate(count * sizeof(T), align));
+            std::uninitialized_default_construct_n(p, count);
+            return std::span<T>(p, count);
+        }
+
+        // Constructs a T in the arena, T has to be trivially destructible
+        template<typename T, typename... Args>
+        inline T* create(Args &&... args) {
+            static_assert(std::is_trivially_destructible_v<T>, "Arena never runs destructors");
+            return ::new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        inline Marker mark() const { return { current, used }; };
+
+        // Frees everything allocated after marker
+        inline void rewind(Marker marker) {
+            current = marker.block;
+            used = marker.used;
+        }
+
+        // Frees everything, keeps the blocks for the next frame
+        inline void reset() { rewind({ 0, 0 }); };
+
+        // Frees everything and returns the blocks to upstream
+        void release();
+
+        // Bytes handed out since the last reset, padding included
+        std::size_t size() const;
+
+        // Bytes held in blocks
+        std::size_t capacity() const;
+
+    protected:
+        inline void* do_allocate(std::size_t bytes, std::size_t align) override {
+            if (current < blocks.size()) {
+                const Block &block = blocks[current];
+                const std::size_t offset = align_up((std::uintptr_t)block.data + used, align) - (std::uintptr_t)block.data;
+                if (offset <= block.size && bytes <= block.size - offset) {
+                    used = offset + bytes;
+                    return block.data + offset;
+                }
+            }
+            return grow(bytes, align);
+        }
+
+        inline void do_deallocate(void*, std::size_t, std::size_t) override {}
+
+        inline bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+            return this == &other;
+        }
+
+    private:
+        struct Block {
+            std::byte* data;
+            std::size_t size;
+        };
+
+        // Moves to the next block that fits, allocating one if none does
+        void* grow(std::size_t bytes, std::size_t align);
+
+        std::pmr::memory_resource* upstream;
+        std::size_t block_size;
+        std::vector<Block> blocks;
+        std::size_t current = 0;
+        std::size_t used = 0;
+    };
+
+    /**
+     * @brief Pool of fixed size slots for objects of type T, freed slots are reused first
+     *
+     * Slots are carved from blocks of per_block slots and linked through a free list, create and destroy are a few
+     * instructions and never touch the upstream resource once the pool has grown. Objects still alive when the pool
+     * is destroyed are not destroyed.
+     *
+     * @tparam T Type of the objects
+     */
+    template<typename T>
+    class Pool {
+    public:
+        inline explicit Pool(std::size_t per_block = 256, std::pmr::memory_resource* upstream = aligned_resource())
+            : upstream(upstream), per_block(per_block > 0 ? per_block : 1) {}
+
+        inline ~Pool() {
+            release();
+        }
+
+        Pool(const Pool &) = delete;
+        Pool& operator = (const Pool &) = delete;
+
+        // Returns an uninitialized slot
+        inline void* allocate() {
+            if (free_list == nullptr) {
+                grow();
+            }
+            Slot* slot = free_list;
+            free_list = slot->next;
+            live++;
+            return slot;
+        }
+
+        // Returns a slot to the pool, p must come from this pool
+        inline void deallocate(void* p) {
+            Slot* slot = static_cast<Slot*>(p);
+            slot->next = free_list;
+            free_list = slot;
+            live--;
+        }
+
+        template<typename... Args>
+        inline T* create(Args &&... args) {
+            void* p = allocate();
+            try {
+                return ::new (p) T(std::forward<Args>(args)...);
+            } catch (...) {
+                deallocate(p);
+                throw;
+            }
+        }
+
+        inline void destroy(T* object) {
+            object->~T();
+            deallocate(object);
+        }
+
+        // Number of slots in use
+        inline std::size_t size() const { return live; };
+
+        // Number of slots in every block
+        inline std::size_t capacity() const { return blocks.size() * per_block; };
+
+        // Returns every block to upstream, only valid once every object is destroyed
+        inline void release() {
+            for (std::byte* block : blocks) {
+                upstream->deallocate(block, per_block * sizeof(Slot), block_alignment);
+            }
+            blocks.clear();
+            free_list = nullptr;
+            live = 0;
+        }
+
+    private:
+        union Slot {
+            Slot* next;
+            alignas(T) std::byte storage[sizeof(T)];
+        };
+
+        static constexpr std::size_t block_alignment = alignof(Slot) > alignment ? alignof(Slot) : alignment;
+
+        inline void grow() {
+            blocks.reserve(blocks.size() + 1);
+            std::byte* block = static_cast<std::byte*>(upstream->allocate(per_block * sizeof(Slot), block_alignment));
+            blocks.push_back(block);
+            // Linked back to front so slots are handed out in address order
+            Slot* slots = reinterpret_cast<Slot*>(block);
+            for (std::size_t i = per_block; i-- > 0;) {
+                slots[i].next = free_list;
+                free_list = &slots[i];
+            }
+        }
+
+        std::pmr::memory_resource* upstream;
+        std::size_t per_block;
+        std::vector<std::byte*> blocks;
+        Slot* free_list = nullptr;
+        std::size_t live = 0;
+    };
+}
+
+#endif
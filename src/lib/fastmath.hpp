@@ -0,0 +1,437 @@
+#ifndef FASTMATHHPP
+#define FASTMATHHPP
+
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+#include "simd.hpp"
+
+/**
+ * Polynomial approximations of sin, cos, acos, atan2, exp and log over float and double arrays
+ *
+ * The kernels are branchless and work is done in blocks so the main loop vectorizes, with -O2 on
+ * clang and -O3 on gcc, double needs SSE4.1 or AVX for the 64 bit compares. Inputs outside the
+ * domain of a kernel are passed to the standard library in a second pass over the block, so NaN,
+ * infinity, denormals and huge arguments behave like <cmath>. out may be in for every function.
+ *
+ * Maximum error against a correctly rounded result, inside the domain of the kernel:
+ *
+ *   function   float      double     domain
+ *   sin, cos   1.6 ulp    3 ulp      |x| <= 512 float, |x| <= 1.6e6 double
+ *   acos       2 ulp      2 ulp      |x| <= 1
+ *   atan2      4 ulp      3 ulp      finite x and y
+ *   exp        1 ulp      1 ulp      [-86, 88] float, [-708, 709] double
+ *   log        1 ulp      1 ulp      normal positive x
+ */
+namespace math {
+
+    namespace detail {
+        // Number of elements handled per block
+        constexpr std::size_t block = 256;
+
+        template<typename T>
+        struct traits;
+
+        template<>
+        struct traits<float> {
+            using bits = std::uint32_t;
+            using sbits = std::int32_t;
+            static constexpr int mantissa = 23;
+            static constexpr int bias = 127;
+            // Adding and subtracting this rounds to the nearest integer, which lands in the low mantissa bits
+            static constexpr float round = 12582912.0f;
+        };
+
+        template<>
+        struct traits<double> {
+            using bits = std::uint64_t;
+            using sbits = std::int64_t;
+            static constexpr int mantissa = 52;
+            static constexpr int bias = 1023;
+            static constexpr double round = 6755399441055744.0;
+        };
+
+        // Returns the integer x was rounded to by x + traits<T>::round
+        template<typename T>
+        inline typename traits<T>::sbits rounded(T shifted) {
+            using sbits = typename traits<T>::sbits;
+            return std::bit_cast<sbits>(shifted) - std::bit_cast<sbits>(traits<T>::round);
+        }
+
+        // Multiplies y by 2^k, the result has to be a normal number
+        template<typename T>
+        inline T scale(T y, typename traits<T>::sbits k) {
+            using bits = typename traits<T>::bits;
+            return std::bit_cast<T>(std::bit_cast<bits>(y) + ((bits)k << traits<T>::mantissa));
+        }
+
+        // Returns c ? a : b through bit masks, branches on floating point compares keep gcc from vectorizing
+        template<typename T>
+        inline T select(bool c, T a, T b) {
+            using bits = typename traits<T>::bits;
+            bits mask = (bits)0 - (bits)c;
+            return std::bit_cast<T>((std::bit_cast<bits>(a) & mask) | (std::bit_cast<bits>(b) & ~mask));
+        }
+
+        template<typename T>
+        inline void check(std::size_t in, std::size_t out) {
+            static_assert(std::is_same_v<T, float> || std::is_same_v<T, double>, "Kernels support float and double");
+            if (out < in) {
+                throw std::invalid_argument("Output span too small");
+            }
+        }
+
+        // Runs kernel over in, then fallback over every element outside [lo, hi]
+        template<typename T, typename Kernel, typename Fallback>
+        inline void apply(std::span<const T> in, std::span<T> out, T lo, T hi, Kernel kernel, Fallback fallback) {
+            check<T>(in.size(), out.size());
+            T x[block];
+            for (std::size_t begin = 0; begin < in.size(); begin += block) {
+                const std::size_t n = in.size() - begin < block ? in.size() - begin : block;
+                T* dst = out.data() + begin;
+                for (std::size_t i = 0; i < n; i++) {
+                    x[i] = in[begin + i];
+                }
+                for (std::size_t i = 0; i < n; i++) {
+                    dst[i] = kernel(x[i]);
+                }
+                for (std::size_t i = 0; i < n; i++) {
+                    if (!(x[i] >= lo && x[i] <= hi)) {
+                        dst[i] = fallback(x[i]);
+                    }
+                }
+            }
+        }
+
+        // Reduces x by the nearest multiple k of pi / 2, returns x - k * pi / 2 and stores k in quadrant
+        template<typename T>
+        inline T reduce_half_pi(T x, typename traits<T>::sbits &quadrant) {
+            if constexpr (std::is_same_v<T, float>) {
+                T k = (x * 0.636619772367581343f + traits<T>::round);
+                quadrant = rounded(k);
+                k -= traits<T>::round;
+                // A float split of pi / 2 cancels next to its multiples, the subtraction runs in double with a
+                // 33 bit high part so k * hi is exact, only the reduced argument is narrowed
+                double kd = k;
+                double r = (double)x - kd * 1.57079632673412561417;
+                r = r - kd * 6.07710050630396597660e-11;
+                return (T)r;
+            } else {
+                T k = (x * 0.636619772367581343 + traits<T>::round);
+                quadrant = rounded(k);
+                k -= traits<T>::round;
+                x = x - k * 1.57079632673412561417;
+                x = x - k * 6.07710050630396597660e-11;
+                return x - k * 2.02226624879595063154e-21;
+            }
+        }
+
+        // sin(r) and cos(r) for |r| <= pi / 4
+        template<typename T>
+        inline T sin_poly(T r) {
+            T z = r * r;
+            if constexpr (std::is_same_v<T, float>) {
+                T p = -1.9515295891e-4f;
+                p = p * z + 8.3321608736e-3f;
+                p = p * z - 1.6666654611e-1f;
+                return r + r * z * p;
+            } else {
+                T p = 1.58962301576546568060e-10;
+                p = p * z - 2.50507477628578072866e-8;
+                p = p * z + 2.75573136213857245213e-6;
+                p = p * z - 1.98412698295895385996e-4;
+                p = p * z + 8.33333333332211858878e-3;
+                p = p * z - 1.66666666666666307295e-1;
+                return r + r * z * p;
+            }
+        }
+
+        template<typename T>
+        inline T cos_poly(T r) {
+            T z = r * r;
+            if constexpr (std::is_same_v<T, float>) {
+                T p = 2.443315711809948e-5f;
+                p = p * z - 1.388731625493765e-3f;
+                p = p * z + 4.166664568298827e-2f;
+                return (T)1 - (T)0.5 * z + z * z * p;
+            } else {
+                T p = -1.13585365213876817300e-11;
+                p = p * z + 2.08757008419747316778e-9;
+                p = p * z - 2.75573141792967388112e-7;
+                p = p * z + 2.48015872888517045348e-5;
+                p = p * z - 1.38888888888730564116e-3;
+                p = p * z + 4.16666666666665929218e-2;
+                return (T)1 - (T)0.5 * z + z * z * p;
+            }
+        }
+
+        // sin(x) when offset is 0, cos(x) when offset is 1
+        template<typename T>
+        inline T sincos(T x, int offset) {
+            typename traits<T>::sbits q;
+            T r = reduce_half_pi(x, q);
+            q += offset;
+            T s = sin_poly(r);
+            T c = cos_poly(r);
+            T out = select((q & 1) != 0, c, s);
+            return select((q & 2) != 0, -out, out);
+        }
+
+        // asin(s) for 0 <= s <= 0.5, z = s * s
+        template<typename T>
+        inline T asin_poly(T s, T z) {
+            if constexpr (std::is_same_v<T, float>) {
+                T p = 4.2163199048e-2f;
+                p = p * z + 2.4181311049e-2f;
+                p = p * z + 4.5470025998e-2f;
+                p = p * z + 7.4953002686e-2f;
+                p = p * z + 1.6666752422e-1f;
+                return s + s * z * p;
+            } else {
+                T p = 3.47933107596021167570e-05;
+                p = p * z + 7.91534994289814532176e-04;
+                p = p * z - 4.00555345006794114027e-02;
+                p = p * z + 2.01212532134862925881e-01;
+                p = p * z - 3.25565818622400915405e-01;
+                p = p * z + 1.66666666666666657415e-01;
+                T q = 7.70381505559019352791e-02;
+                q = q * z - 6.88283971605453293030e-01;
+                q = q * z + 2.02094576023350569471e+00;
+                q = q * z - 2.40339491173441421878e+00;
+                q = q * z + (T)1;
+                return s + s * (z * p / q);
+            }
+        }
+
+        // atan(t) for |t| <= tan(pi / 8)
+        template<typename T>
+        inline T atan_poly(T t) {
+            T z = t * t;
+            if constexpr (std::is_same_v<T, float>) {
+                T p = 8.05374449538e-2f;
+                p = p * z - 1.38776856032e-1f;
+                p = p * z + 1.99777106478e-1f;
+                p = p * z - 3.33329491539e-1f;
+                return t + t * z * p;
+            } else {
+                T p = -8.750608600031904122785e-1;
+                p = p * z - 1.615753718733365076637e1;
+                p = p * z - 7.500855792314704667340e1;
+                p = p * z - 1.228866684490136173410e2;
+                p = p * z - 6.485021904942025371773e1;
+                T q = z + 2.485846490142306297962e1;
+                q = q * z + 1.650270098316988542046e2;
+                q = q * z + 4.328810604912902668951e2;
+                q = q * z + 4.853903996359136964868e2;
+                q = q * z + 1.945506571482613964425e2;
+                return t + t * (z * p / q);
+            }
+        }
+
+        // root is sqrt((1 - |x|) / 2), computed in its own pass since std::sqrt sets errno and does not vectorize
+        template<typename T>
+        inline T acos(T x, T root) {
+            constexpr T pi = (T)3.14159265358979323846;
+            T a = std::fabs(x);
+            bool large = a > (T)0.5;
+            // acos(a) = 2 asin(sqrt((1 - a) / 2)) above 0.5, pi / 2 - asin(a) below
+            T z = select(large, ((T)1 - a) * (T)0.5, a * a);
+            T s = select(large, root, a);
+            T p = asin_poly(s, z);
+            T small = pi / (T)2 - std::copysign(p, x);
+            T big = select(x < (T)0, pi - (T)2 * p, (T)2 * p);
+            return select(large, big, small);
+        }
+
+        template<typename T>
+        inline T atan2(T y, T x) {
+            constexpr T pi = (T)3.14159265358979323846;
+            constexpr T tan_pi_8 = (T)0.41421356237309504880;
+            T ax = std::fabs(x);
+            T ay = std::fabs(y);
+            bool swap = ay > ax;
+            T num = select(swap, ax, ay);
+            T den = select(swap, ay, ax);
+            T a = select(den > (T)0, num / den, (T)0);
+            // Shifts [tan(pi / 8), 1] down to [-tan(pi / 8), 0] with atan(a) = pi / 4 + atan((a - 1) / (a + 1))
+            bool shift = a > tan_pi_8;
+            T t = select(shift, (a - (T)1) / (a + (T)1), a);
+            T r = atan_poly(t) + select(shift, pi / (T)4, (T)0);
+            r = select(swap, pi / (T)2 - r, r);
+            r = select(std::signbit(x), pi - r, r);
+            return std::copysign(r, y);
+        }
+
+        template<typename T>
+        inline T exp(T x) {
+            T k = x * (T)1.44269504088896340736 + traits<T>::round;
+            typename traits<T>::sbits ki = rounded(k);
+            k -= traits<T>::round;
+            if constexpr (std::is_same_v<T, float>) {
+                T r = x - k * 0.693359375f;
+                r = r + k * 2.12194440e-4f;
+                T p = 1.9875691500e-4f;
+                p = p * r + 1.3981999507e-3f;
+                p = p * r + 8.3334519073e-3f;
+                p = p * r + 4.1665795894e-2f;
+                p = p * r + 1.6666665459e-1f;
+                p = p * r + 5.0000001201e-1f;
+                return scale(p * r * r + r + (T)1, ki);
+            } else {
+                T r = x - k * 6.93147180369123816490e-01;
+                r = r - k * 1.90821492927058770002e-10;
+                // Taylor series up to r^13 / 13!, |r| <= ln(2) / 2
+                T p = 1.0 / 6227020800.0;
+                p = p * r + 1.0 / 479001600.0;
+                p = p * r + 1.0 / 39916800.0;
+                p = p * r + 1.0 / 3628800.0;
+                p = p * r + 1.0 / 362880.0;
+                p = p * r + 1.0 / 40320.0;
+                p = p * r + 1.0 / 5040.0;
+                p = p * r + 1.0 / 720.0;
+                p = p * r + 1.0 / 120.0;
+                p = p * r + 1.0 / 24.0;
+                p = p * r + 1.0 / 6.0;
+                p = p * r + 0.5;
+                return scale(p * r * r + r + (T)1, ki);
+            }
+        }
+
+        template<typename T>
+        inline T log(T x) {
+            using bits = typename traits<T>::bits;
+            constexpr bits mantissa_mask = ((bits)1 << traits<T>::mantissa) - 1;
+            constexpr bits one = (bits)traits<T>::bias << traits<T>::mantissa;
+            bits b = std::bit_cast<bits>(x);
+            // Biased exponent converted to T through the mantissa of a 2^mantissa float
+            constexpr T exponent_base = (T)((bits)1 << traits<T>::mantissa);
+            constexpr bits exponent_bits = std::bit_cast<bits>(exponent_base);
+            T e = std::bit_cast<T>(exponent_bits | (b >> traits<T>::mantissa)) - (exponent_base + (T)traits<T>::bias);
+            // x = m * 2^e with m in [sqrt(1/2), sqrt(2))
+            T m = std::bit_cast<T>((b & mantissa_mask) | one);
+            bool high = m > (T)1.41421356237309504880;
+            m = select(high, m * (T)0.5, m);
+            e = select(high, e + (T)1, e);
+            T f = m - (T)1;
+            if constexpr (std::is_same_v<T, float>) {
+                T z = f * f;
+                T p = 7.0376836292e-2f;
+                p = p * f - 1.1514610310e-1f;
+                p = p * f + 1.1676998740e-1f;
+                p = p * f - 1.2420140846e-1f;
+                p = p * f + 1.4249322787e-1f;
+                p = p * f - 1.6668057665e-1f;
+                p = p * f + 2.0000714765e-1f;
+                p = p * f - 2.4999993993e-1f;
+                p = p * f + 3.3333331174e-1f;
+                T y = f * z * p;
+                y = y - e * 2.12194440e-4f;
+                y = y - (T)0.5 * z;
+                return f + y + e * 0.693359375f;
+            } else {
+                T s = f / ((T)2 + f);
+                T z = s * s;
+                T r = 1.479819860511658591e-01;
+                r = r * z + 1.531383769920937332e-01;
+                r = r * z + 1.818357216161805012e-01;
+                r = r * z + 2.222219843214978396e-01;
+                r = r * z + 2.857142874366239149e-01;
+                r = r * z + 3.999999999940941908e-01;
+                r = r * z + 6.666666666666735130e-01;
+                r = r * z;
+                T hfsq = (T)0.5 * f * f;
+                return e * 6.93147180369123816490e-01 - ((hfsq - (s * (hfsq + r) + e * 1.90821492927058770002e-10)) - f);
+            }
+        }
+    }
+
+    // out[i] = sin(in[i])
+    template<typename T>
+    inline void sin(std::span<const T> in, std::span<T> out) {
+        constexpr T limit = std::is_same_v<T, float> ? (T)512 : (T)1.6e6;
+        detail::apply(in, out, -limit, limit, [](T x) { return detail::sincos(x, 0); }, [](T x) { return std::sin(x); });
+    }
+
+    // out[i] = cos(in[i])
+    template<typename T>
+    inline void cos(std::span<const T> in, std::span<T> out) {
+        constexpr T limit = std::is_same_v<T, float> ? (T)512 : (T)1.6e6;
+        detail::apply(in, out, -limit, limit, [](T x) { return detail::sincos(x, 1); }, [](T x) { return std::cos(x); });
+    }
+
+    // out[i] = acos(in[i])
+    template<typename T>
+    inline void acos(std::span<const T> in, std::span<T> out) {
+        detail::check<T>(in.size(), out.size());
+        T x[detail::block];
+        T roots[detail::block];
+        for (std::size_t begin = 0; begin < in.size(); begin += detail::block) {
+            const std::size_t n = in.size() - begin < detail::block ? in.size() - begin : detail::block;
+            T* dst = out.data() + begin;
+            for (std::size_t i = 0; i < n; i++) {
+                x[i] = in[begin + i];
+                roots[i] = ((T)1 - std::fabs(x[i])) * (T)0.5;
+            }
+            simd::sqrt(roots, n);
+            for (std::size_t i = 0; i < n; i++) {
+                dst[i] = detail::acos(x[i], roots[i]);
+            }
+            for (std::size_t i = 0; i < n; i++) {
+                if (!(x[i] >= (T)-1 && x[i] <= (T)1)) {
+                    dst[i] = std::acos(x[i]);
+                }
+            }
+        }
+    }
+
+    // out[i] = exp(in[i])
+    template<typename T>
+    inline void exp(std::span<const T> in, std::span<T> out) {
+        constexpr T lo = std::is_same_v<T, float> ? (T)-86 : (T)-708;
+        constexpr T hi = std::is_same_v<T, float> ? (T)88 : (T)709;
+        detail::apply(in, out, lo, hi, [](T x) { return detail::exp(x); }, [](T x) { return std::exp(x); });
+    }
+
+    // out[i] = log(in[i])
+    template<typename T>
+    inline void log(std::span<const T> in, std::span<T> out) {
+        detail::apply(in, out, std::numeric_limits<T>::min(), std::numeric_limits<T>::max(),
+            [](T x) { return detail::log(x); }, [](T x) { return std::log(x); });
+    }
+
+    // out[i] = atan2(y[i], x[i]), out may be y or x
+    template<typename T>
+    inline void atan2(std::span<const T> y, std::span<const T> x, std::span<T> out) {
+        detail::check<T>(y.size(), out.size());
+        if (x.size() != y.size()) {
+            throw std::invalid_argument("Array sizes do not match");
+        }
+        T ys[detail::block];
+        T xs[detail::block];
+        constexpr T limit = std::numeric_limits<T>::max();
+        for (std::size_t begin = 0; begin < y.size(); begin += detail::block) {
+            const std::size_t n = y.size() - begin < detail::block ? y.size() - begin : detail::block;
+            T* dst = out.data() + begin;
+            for (std::size_t i = 0; i < n; i++) {
+                ys[i] = y[begin + i];
+                xs[i] = x[begin + i];
+            }
+            for (std::size_t i = 0; i < n; i++) {
+                dst[i] = detail::atan2(ys[i], xs[i]);
+            }
+            for (std::size_t i = 0; i < n; i++) {
+                if (!(ys[i] >= -limit && ys[i] <= limit && xs[i] >= -limit && xs[i] <= limit)) {
+                    dst[i] = std::atan2(ys[i], xs[i]);
+                }
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,460 @@
+#ifndef FIXEDHPP
+#define FIXEDHPP
+
+#include <bit>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "simd.hpp"
+#include "vector.hpp"
+
+namespace fixed {
+
+    namespace detail {
+#if defined(__SIZEOF_INT128__)
+        __extension__ typedef __int128 int128;
+        __extension__ typedef unsigned __int128 uint128;
+#endif
+
+        // Raw storage of a fixed point number and the integers twice as wide used for products
+        template<int Bits>
+        struct storage;
+
+        template<>
+        struct storage<32> {
+            using raw = std::int32_t;
+            using uraw = std::uint32_t;
+            using wide = std::int64_t;
+            using uwide = std::uint64_t;
+        };
+
+#if defined(__SIZEOF_INT128__)
+        template<>
+        struct storage<64> {
+            using raw = std::int64_t;
+            using uraw = std::uint64_t;
+            using wide = int128;
+            using uwide = uint128;
+        };
+#endif
+    }
+}
+
+/**
+ * @brief A signed fixed point number for deterministic integer only arithmetic, usable as the component type of Vec
+ *
+ * Values are stored as raw / 2^FracBits in an int32 when IntBits + FracBits <= 31 and in an int64 otherwise,
+ * which needs a compiler with 128 bit integers for the products. +, -, * and / wrap like the underlying integer,
+ * * and / round to nearest. Conversions and dot products saturate.
+ *
+ * @tparam IntBits Number of integer bits, without the sign bit
+ * @tparam FracBits Number of fractional bits
+ */
+template<int IntBits, int FracBits>
+struct Fixed {
+    static_assert(IntBits >= 0 && FracBits >= 0 && IntBits + FracBits <= 63, "Fixed supports up to 63 bits");
+#if !defined(__SIZEOF_INT128__)
+    static_assert(IntBits + FracBits <= 31, "Fixed with more than 31 bits needs 128 bit integers");
+#endif
+
+    using storage = fixed::detail::storage<(IntBits + FracBits <= 31) ? 32 : 64>;
+    using raw_type = typename storage::raw;
+    using wide_type = typename storage::wide;
+
+    static constexpr int int_bits = IntBits;
+    static constexpr int frac_bits = FracBits;
+
+    raw_type raw = 0;
+
+    constexpr Fixed() = default;
+
+    template<typename U>
+    requires std::is_integral_v<U>
+    constexpr Fixed(U value) : raw(from_integer(value)) {}
+
+    template<typename U>
+    requires std::is_floating_point_v<U>
+    constexpr Fixed(U value) : raw(from_floating(value)) {}
+
+    static constexpr Fixed from_raw(raw_type raw) {
+        Fixed out;
+        out.raw = raw;
+        return out;
+    }
+
+    static constexpr Fixed max() { return from_raw(std::numeric_limits<raw_type>::max()); };
+    static constexpr Fixed min() { return from_raw(std::numeric_limits<raw_type>::min()); };
+    // Returns the smallest positive value
+    static constexpr Fixed epsilon() { return from_raw(1); };
+
+    template<typename U>
+    requires std::is_floating_point_v<U>
+    constexpr explicit operator U() const {
+        return (U)raw / (U)scale;
+    }
+
+    // Converts to an integer, rounding towards zero
+    template<typename U>
+    requires std::is_integral_v<U>
+    constexpr explicit operator U() const {
+        return (U)(raw / (raw_type)scale);
+    }
+
+    constexpr Fixed operator + (Fixed other) const { return from_raw((raw_type)((uraw)raw + (uraw)other.raw)); };
+    constexpr Fixed operator - (Fixed other) const { return from_raw((raw_type)((uraw)raw - (uraw)other.raw)); };
+    constexpr Fixed operator - () const { return from_raw((raw_type)((uraw)0 - (uraw)raw)); };
+
+    constexpr Fixed operator * (Fixed other) const {
+        return from_raw((raw_type)round_shift((wide_type)raw * other.raw));
+    }
+
+    constexpr Fixed operator / (Fixed other) const {
+        if (other.raw == 0) {
+            throw std::domain_error("Division by zero");
+        }
+        wide_type n = (wide_type)raw * scale;
+        wide_type d = other.raw;
+        wide_type half = (d < 0 ? -d : d) / 2;
+        return from_raw((raw_type)(((n < 0) == (d < 0) ? n + half : n - half) / d));
+    }
+
+    constexpr Fixed& operator += (Fixed other) { return *this = *this + other; };
+    constexpr Fixed& operator -= (Fixed other) { return *this = *this - other; };
+    constexpr Fixed& operator *= (Fixed other) { return *this = *this * other; };
+    constexpr Fixed& operator /= (Fixed other) { return *this = *this / other; };
+
+    constexpr bool operator == (const Fixed &other) const = default;
+    constexpr auto operator <=> (const Fixed &other) const = default;
+
+    // Square root rounded to nearest, zero for negative values
+    constexpr Fixed sqrt() const {
+        if (raw <= 0) {
+            return Fixed();
+        }
+        uwide n = (uwide)raw << FracBits;
+        uwide root = 0;
+        uwide bit = (uwide)1 << ((std::bit_width((std::uint64_t)raw) + FracBits) & ~1);
+        while (bit > n) {
+            bit >>= 2;
+        }
+        uwide rest = n;
+        while (bit != 0) {
+            if (rest >= root + bit) {
+                rest -= root + bit;
+                root = (root >> 1) + bit;
+            } else {
+                root >>= 1;
+            }
+            bit >>= 2;
+        }
+        if (rest > root) {
+            root++;
+        }
+        return from_raw((raw_type)root);
+    }
+
+    // 1 / x with Newton-Raphson iterations instead of a division, relative error below 2^-28
+    constexpr Fixed reciprocal() const {
+        if (raw == 0) {
+            throw std::domain_error("Division by zero");
+        }
+        std::uint64_t r = raw < 0 ? (std::uint64_t)0 - (std::uint64_t)(std::int64_t)raw : (std::uint64_t)raw;
+        int lz = std::countl_zero(r);
+        // d in [0.5, 1) as a 0.32 number
+        std::uint64_t d = (r << lz) >> 32;
+        // y in 2.30, starts from the minimax line 48/17 - 32/17 d
+        std::uint64_t y = 3031741621ull - ((2021161081ull * d) >> 32);
+        for (int i = 0; i < 3; i++) {
+            std::uint64_t e = (2ull << 30) - ((d * y) >> 32);
+            y = (y * e) >> 30;
+        }
+        // raw result is 2^(2 FracBits) / r = y * 2^(2 FracBits + lz - 94)
+        int shift = 2 * FracBits + lz - 94;
+        wide_type out;
+        if (shift >= 0) {
+            out = shift >= std::numeric_limits<raw_type>::digits - 30 ? std::numeric_limits<raw_type>::max() : (wide_type)y << shift;
+        } else {
+            out = -shift >= 64 ? 0 : (wide_type)((y + (((std::uint64_t)1 << -shift) >> 1)) >> -shift);
+        }
+        out = clamp(out);
+        return from_raw((raw_type)(raw < 0 ? -out : out));
+    }
+
+    // Hooks used by Vec::dot, products are summed at double width and rounded once
+    static constexpr wide_type product(Fixed a, Fixed b) {
+        return (wide_type)a.raw * b.raw;
+    }
+
+    static constexpr wide_type accumulate(wide_type sum, wide_type product) {
+        if (product > 0 && sum > wide_max - product) return wide_max;
+        if (product < 0 && sum < wide_min - product) return wide_min;
+        return sum + product;
+    }
+
+    static constexpr Fixed from_product(wide_type product) {
+        return from_raw((raw_type)clamp(accumulate(product, half) >> FracBits));
+    }
+
+    inline friend std::ostream& operator<<(std::ostream& os, const Fixed& value)
+    {
+        os << (double)value;
+        return os;
+    }
+
+private:
+    using uraw = typename storage::uraw;
+    using uwide = typename storage::uwide;
+
+    static constexpr wide_type scale = (wide_type)1 << FracBits;
+    static constexpr wide_type half = FracBits > 0 ? scale / 2 : 0;
+    static constexpr wide_type wide_max = (wide_type)(~(uwide)0 >> 1);
+    static constexpr wide_type wide_min = -wide_max - 1;
+
+    static constexpr wide_type round_shift(wide_type value) {
+        return (value + half) >> FracBits;
+    }
+
+    static constexpr wide_type clamp(wide_type value) {
+        if (value > (wide_type)std::numeric_limits<raw_type>::max()) return std::numeric_limits<raw_type>::max();
+        if (value < (wide_type)std::numeric_limits<raw_type>::min()) return std::numeric_limits<raw_type>::min();
+        return value;
+    }
+
+    template<typename U>
+    static constexpr raw_type from_integer(U value) {
+        constexpr raw_type limit = std::numeric_limits<raw_type>::max() >> FracBits;
+        if (std::cmp_greater(value, limit)) return std::numeric_limits<raw_type>::max();
+        if (std::cmp_less(value, -limit - 1)) return std::numeric_limits<raw_type>::min();
+        return (raw_type)((wide_type)value * scale);
+    }
+
+    template<typename U>
+    static constexpr raw_type from_floating(U value) {
+        U scaled = value * (U)scale;
+        if (!(scaled == scaled)) return 0;
+        if (scaled >= (U)std::numeric_limits<raw_type>::max()) return std::numeric_limits<raw_type>::max();
+        if (scaled <= (U)std::numeric_limits<raw_type>::min()) return std::numeric_limits<raw_type>::min();
+        // Rounds half away from zero
+        return (raw_type)(scaled + (scaled < (U)0 ? (U)-0.5 : (U)0.5));
+    }
+};
+
+namespace std {
+    template<int IntBits, int FracBits>
+    class numeric_limits<Fixed<IntBits, FracBits>> {
+    public:
+        static constexpr bool is_specialized = true;
+        static constexpr bool is_signed = true;
+        static constexpr bool is_integer = false;
+        static constexpr bool is_exact = true;
+        static constexpr bool has_infinity = false;
+        static constexpr bool has_quiet_NaN = false;
+        static constexpr int digits = numeric_limits<typename Fixed<IntBits, FracBits>::raw_type>::digits;
+
+        static constexpr Fixed<IntBits, FracBits> min() { return Fixed<IntBits, FracBits>::epsilon(); };
+        static constexpr Fixed<IntBits, FracBits> lowest() { return Fixed<IntBits, FracBits>::min(); };
+        static constexpr Fixed<IntBits, FracBits> max() { return Fixed<IntBits, FracBits>::max(); };
+        static constexpr Fixed<IntBits, FracBits> epsilon() { return Fixed<IntBits, FracBits>::epsilon(); };
+    };
+}
+
+// 15.16, the usual choice for lockstep simulation
+using fixed32 = Fixed<15, 16>;
+#if defined(__SIZEOF_INT128__)
+using fixed64 = Fixed<31, 32>;
+#endif
+
+using fixed2 = Vec2<fixed32>;
+using fixed3 = Vec3<fixed32>;
+using fixed4 = Vec4<fixed32>;
+using fixed5 = Vec5<fixed32>;
+using fixed6 = Vec6<fixed32>;
+
+namespace fixed {
+
+    template<int IntBits, int FracBits>
+    constexpr Fixed<IntBits, FracBits> sqrt(Fixed<IntBits, FracBits> x) {
+        return x.sqrt();
+    }
+
+    template<int IntBits, int FracBits>
+    constexpr Fixed<IntBits, FracBits> reciprocal(Fixed<IntBits, FracBits> x) {
+        return x.reciprocal();
+    }
+
+    template<int IntBits, int FracBits>
+    constexpr Fixed<IntBits, FracBits> abs(Fixed<IntBits, FracBits> x) {
+        return x.raw < 0 ? -x : x;
+    }
+
+    namespace detail {
+        inline void check(std::size_t a, std::size_t b, std::size_t out) {
+            if (a != b) {
+                throw std::invalid_argument("Array sizes do not match");
+            }
+            if (out < a) {
+                throw std::invalid_argument("Output span too small");
+            }
+        }
+
+        template<typename F>
+        inline const typename F::raw_type* raw(const F* p) {
+            return reinterpret_cast<const typename F::raw_type*>(p);
+        }
+
+        template<typename F>
+        inline typename F::raw_type* raw(F* p) {
+            return reinterpret_cast<typename F::raw_type*>(p);
+        }
+
+#if defined(EXTLIB_SSE41)
+        // Rounded fixed point product of four 32 bit lanes
+        template<int FracBits>
+        inline __m128i mul_epi32(__m128i a, __m128i b) {
+            const __m128i half = _mm_set1_epi64x(FracBits > 0 ? (std::int64_t)1 << (FracBits - 1) : 0);
+            __m128i even = _mm_add_epi64(_mm_mul_epi32(a, b), half);
+            __m128i odd = _mm_add_epi64(_mm_mul_epi32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32)), half);
+            // The logical shift keeps the same low 32 bits as an arithmetic one
+            even = _mm_srli_epi64(even, FracBits);
+            odd = _mm_slli_epi64(_mm_srli_epi64(odd, FracBits), 32);
+            return _mm_blend_epi16(even, odd, 0xCC);
+        }
+#endif
+#if defined(EXTLIB_AVX2)
+        template<int FracBits>
+        inline __m256i mul_epi32(__m256i a, __m256i b) {
+            const __m256i half = _mm256_set1_epi64x(FracBits > 0 ? (std::int64_t)1 << (FracBits - 1) : 0);
+            __m256i even = _mm256_add_epi64(_mm256_mul_epi32(a, b), half);
+            __m256i odd = _mm256_add_epi64(_mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32)), half);
+            even = _mm256_srli_epi64(even, FracBits);
+            odd = _mm256_slli_epi64(_mm256_srli_epi64(odd, FracBits), 32);
+            return _mm256_blend_epi32(even, odd, 0xAA);
+        }
+#endif
+    }
+
+    // out[i] = a[i] + b[i], out may be a or b
+    template<int IntBits, int FracBits>
+    inline void add(std::span<const Fixed<IntBits, FracBits>> a, std::span<const Fixed<IntBits, FracBits>> b, std::span<Fixed<IntBits, FracBits>> out) {
+        detail::check(a.size(), b.size(), out.size());
+        std::size_t i = 0;
+#if defined(EXTLIB_SSE2)
+        if constexpr (sizeof(typename Fixed<IntBits, FracBits>::raw_type) == 4) {
+            const auto* pa = detail::raw(a.data());
+            const auto* pb = detail::raw(b.data());
+            auto* po = detail::raw(out.data());
+#if defined(EXTLIB_AVX2)
+            for (; i + 8 <= a.size(); i += 8) {
+                __m256i v = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(pa + i)), _mm256_loadu_si256((const __m256i*)(pb + i)));
+                _mm256_storeu_si256((__m256i*)(po + i), v);
+            }
+#endif
+            for (; i + 4 <= a.size(); i += 4) {
+                __m128i v = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(pa + i)), _mm_loadu_si128((const __m128i*)(pb + i)));
+                _mm_storeu_si128((__m128i*)(po + i), v);
+            }
+        }
+#endif
+        for (; i < a.size(); i++) {
+            out[i] = a[i] + b[i];
+        }
+    }
+
+    // out[i] = a[i] - b[i], out may be a or b
+    template<int IntBits, int FracBits>
+    inline void sub(std::span<const Fixed<IntBits, FracBits>> a, std::span<const Fixed<IntBits, FracBits>> b, std::span<Fixed<IntBits, FracBits>> out) {
+        detail::check(a.size(), b.size(), out.size());
+        std::size_t i = 0;
+#if defined(EXTLIB_SSE2)
+        if constexpr (sizeof(typename Fixed<IntBits, FracBits>::raw_type) == 4) {
+            const auto* pa = detail::raw(a.data());
+            const auto* pb = detail::raw(b.data());
+            auto* po = detail::raw(out.data());
+#if defined(EXTLIB_AVX2)
+            for (; i + 8 <= a.size(); i += 8) {
+                __m256i v = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(pa + i)), _mm256_loadu_si256((const __m256i*)(pb + i)));
+                _mm256_storeu_si256((__m256i*)(po + i), v);
+            }
+#endif
+            for (; i + 4 <= a.size(); i += 4) {
+                __m128i v = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(pa + i)), _mm_loadu_si128((const __m128i*)(pb + i)));
+                _mm_storeu_si128((__m128i*)(po + i), v);
+            }
+        }
+#endif
+        for (; i < a.size(); i++) {
+            out[i] = a[i] - b[i];
+        }
+    }
+
+    // out[i] = a[i] * b[i], out may be a or b
+    template<int IntBits, int FracBits>
+    inline void mul(std::span<const Fixed<IntBits, FracBits>> a, std::span<const Fixed<IntBits, FracBits>> b, std::span<Fixed<IntBits, FracBits>> out) {
+        detail::check(a.size(), b.size(), out.size());
+        std::size_t i = 0;
+#if defined(EXTLIB_SSE41)
+        if constexpr (sizeof(typename Fixed<IntBits, FracBits>::raw_type) == 4) {
+            const auto* pa = detail::raw(a.data());
+            const auto* pb = detail::raw(b.data());
+            auto* po = detail::raw(out.data());
+#if defined(EXTLIB_AVX2)
+            for (; i + 8 <= a.size(); i += 8) {
+                __m256i v = detail::mul_epi32<FracBits>(_mm256_loadu_si256((const __m256i*)(pa + i)), _mm256_loadu_si256((const __m256i*)(pb + i)));
+                _mm256_storeu_si256((__m256i*)(po + i), v);
+            }
+#endif
+            for (; i + 4 <= a.size(); i += 4) {
+                __m128i v = detail::mul_epi32<FracBits>(_mm_loadu_si128((const __m128i*)(pa + i)), _mm_loadu_si128((const __m128i*)(pb + i)));
+                _mm_storeu_si128((__m128i*)(po + i), v);
+            }
+        }
+#endif
+        for (; i < a.size(); i++) {
+            out[i] = a[i] * b[i];
+        }
+    }
+
+    // out[i] = a[i] * scalar, out may be a
+    template<int IntBits, int FracBits>
+    inline void scale(std::span<const Fixed<IntBits, FracBits>> a, Fixed<IntBits, FracBits> scalar, std::span<Fixed<IntBits, FracBits>> out) {
+        detail::check(a.size(), a.size(), out.size());
+        std::size_t i = 0;
+#if defined(EXTLIB_SSE41)
+        if constexpr (sizeof(typename Fixed<IntBits, FracBits>::raw_type) == 4) {
+            const auto* pa = detail::raw(a.data());
+            auto* po = detail::raw(out.data());
+#if defined(EXTLIB_AVX2)
+            const __m256i s8 = _mm256_set1_epi32(scalar.raw);
+            for (; i + 8 <= a.size(); i += 8) {
+                _mm256_storeu_si256((__m256i*)(po + i), detail::mul_epi32<FracBits>(_mm256_loadu_si256((const __m256i*)(pa + i)), s8));
+            }
+#endif
+            const __m128i s4 = _mm_set1_epi32(scalar.raw);
+            for (; i + 4 <= a.size(); i += 4) {
+                _mm_storeu_si128((__m128i*)(po + i), detail::mul_epi32<FracBits>(_mm_loadu_si128((const __m128i*)(pa + i)), s4));
+            }
+        }
+#endif
+        for (; i < a.size(); i++) {
+            out[i] = a[i] * scalar;
+        }
+    }
+
+    // out[i] = a[i].dot(b[i]), summed at double width and rounded once like Vec::dot
+    template<int IntBits, int FracBits, std::size_t N>
+    inline void dot(std::span<const Vec<Fixed<IntBits, FracBits>, N>> a, std::span<const Vec<Fixed<IntBits, FracBits>, N>> b, std::span<Fixed<IntBits, FracBits>> out) {
+        detail::check(a.size(), b.size(), out.size());
+        for (std::size_t i = 0; i < a.size(); i++) {
+            out[i] = a[i].dot(b[i]);
+        }
+    }
+}
+
+#endif
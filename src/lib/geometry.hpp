@@ -0,0 +1,220 @@
+#ifndef GEOMETRYHPP
+#define GEOMETRYHPP
+
+#include <cstddef>
+#include <iosfwd>
+#include <limits>
+
+#include "vector.hpp"
+
+/**
+ * @brief An axis aligned bounding box, a default constructed box is empty
+ *
+ * @tparam T Type of the coordinates
+ */
+template<typename T>
+struct AABB {
+    Vec3<T> min = Vec3<T>(std::numeric_limits<T>::max(), std::numeric_limits<T>::max(), std::numeric_limits<T>::max());
+    Vec3<T> max = Vec3<T>(std::numeric_limits<T>::lowest(), std::numeric_limits<T>::lowest(), std::numeric_limits<T>::lowest());
+
+    constexpr AABB() = default;
+
+    constexpr AABB(const Vec3<T> &min, const Vec3<T> &max) : min(min), max(max) {}
+
+    // Box around a single point
+    constexpr explicit AABB(const Vec3<T> &point) : min(point), max(point) {}
+
+    constexpr bool empty() const {
+        return min.x > max.x || min.y > max.y || min.z > max.z;
+    }
+
+    // Grows the box to contain point
+    constexpr AABB<T>& expand(const Vec3<T> &point) {
+        for (std::size_t i = 0; i < 3; i++) {
+            if (point.get(i) < min.get(i)) min.get(i) = point.get(i);
+            if (point.get(i) > max.get(i)) max.get(i) = point.get(i);
+        }
+        return *this;
+    }
+
+    // Grows the box to contain another box
+    constexpr AABB<T>& expand(const AABB<T> &box) {
+        for (std::size_t i = 0; i < 3; i++) {
+            if (box.min.get(i) < min.get(i)) min.get(i) = box.min.get(i);
+            if (box.max.get(i) > max.get(i)) max.get(i) = box.max.get(i);
+        }
+        return *this;
+    }
+
+    constexpr Vec3<T> center() const {
+        return (min + max) / (T)2;
+    }
+
+    constexpr Vec3<T> extent() const {
+        return max - min;
+    }
+
+    // Returns the axis with the largest extent
+    constexpr std::size_t longest_axis() const {
+        Vec3<T> e = extent();
+        if (e.x >= e.y && e.x >= e.z) return 0;
+        return e.y >= e.z ? 1 : 2;
+    }
+
+    constexpr T surface_area() const {
+        if (empty()) {
+            return (T)0;
+        }
+        Vec3<T> e = extent();
+        return (T)2 * (e.x * e.y + e.y * e.z + e.z * e.x);
+    }
+
+    constexpr bool contains(const Vec3<T> &point) const {
+        return point.x >= min.x && point.x <= max.x
+            && point.y >= min.y && point.y <= max.y
+            && point.z >= min.z && point.z <= max.z;
+    }
+
+    constexpr bool overlaps(const AABB<T> &box) const {
+        return min.x <= box.max.x && max.x >= box.min.x
+            && min.y <= box.max.y && max.y >= box.min.y
+            && min.z <= box.max.z && max.z >= box.min.z;
+    }
+
+    // Returns the squared distance from point to the box, zero when inside
+    constexpr T distance_squared(const Vec3<T> &point) const {
+        T sum = (T)0;
+        for (std::size_t i = 0; i < 3; i++) {
+            T p = point.get(i);
+            T d = p < min.get(i) ? min.get(i) - p : (p > max.get(i) ? p - max.get(i) : (T)0);
+            sum += d * d;
+        }
+        return sum;
+    }
+
+    inline friend std::ostream& operator<<(std::ostream& os, const AABB<T>& box)
+    {
+        os << box.min << " - " << box.max;
+        return os;
+    }
+};
+
+/**
+ * @brief A ray with a precomputed reciprocal direction for slab tests
+ *
+ * @tparam T Type of the coordinates
+ */
+template<typename T>
+struct Ray {
+    Vec3<T> origin;
+    Vec3<T> direction;
+    Vec3<T> inv_direction;
+    T tmin = (T)0;
+    T tmax = std::numeric_limits<T>::infinity();
+
+    constexpr Ray() = default;
+
+    constexpr Ray(const Vec3<T> &origin, const Vec3<T> &direction, T tmin = (T)0, T tmax = std::numeric_limits<T>::infinity())
+        : origin(origin), direction(direction), inv_direction((T)1 / direction.x, (T)1 / direction.y, (T)1 / direction.z), tmin(tmin), tmax(tmax) {}
+
+    // Returns the point at distance t along the ray
+    constexpr Vec3<T> at(T t) const {
+        return origin + direction * t;
+    }
+};
+
+/**
+ * @brief A triangle given by its three corners, counter clockwise winding faces the normal
+ *
+ * @tparam T Type of the coordinates
+ */
+template<typename T>
+struct Triangle {
+    Vec3<T> v0;
+    Vec3<T> v1;
+    Vec3<T> v2;
+
+    constexpr Triangle() = default;
+
+    constexpr Triangle(const Vec3<T> &v0, const Vec3<T> &v1, const Vec3<T> &v2) : v0(v0), v1(v1), v2(v2) {}
+
+    // Returns the unnormalized normal, its length is twice the area
+    constexpr Vec3<T> normal() const {
+        return (v1 - v0).cross(v2 - v0);
+    }
+
+    inline T area() const {
+        return normal().length() / (T)2;
+    }
+
+    constexpr Vec3<T> centroid() const {
+        return (v0 + v1 + v2) / (T)3;
+    }
+
+    constexpr AABB<T> bounds() const {
+        return AABB<T>(v0).expand(v1).expand(v2);
+    }
+
+    // Returns the point at barycentric coordinates u, v
+    constexpr Vec3<T> at(T u, T v) const {
+        return v0 * ((T)1 - u - v) + v1 * u + v2 * v;
+    }
+
+    inline friend std::ostream& operator<<(std::ostream& os, const Triangle<T>& tri)
+    {
+        os << tri.v0 << " - " << tri.v1 << " - " << tri.v2;
+        return os;
+    }
+};
+
+using aabbf = AABB<float>;
+using aabbd = AABB<double>;
+using rayf = Ray<float>;
+using rayd = Ray<double>;
+using trianglef = Triangle<float>;
+using triangled = Triangle<double>;
+
+namespace geometry {
+
+    // Slab test, returns whether the ray hits the box within [ray.tmin, ray.tmax] and stores the entry distance in t
+    template<typename T>
+    constexpr bool intersect(const Ray<T> &ray, const AABB<T> &box, T &t) {
+        T t0 = ray.tmin;
+        T t1 = ray.tmax;
+        for (std::size_t i = 0; i < 3; i++) {
+            T inv = ray.inv_direction.get(i);
+            T t_near = (box.min.get(i) - ray.origin.get(i)) * inv;
+            T t_far = (box.max.get(i) - ray.origin.get(i)) * inv;
+            if (t_near > t_far) {
+                T tmp = t_near;
+                t_near = t_far;
+                t_far = tmp;
+            }
+            // Written so a NaN from 0 * inf keeps the previous bound
+            t0 = t_near > t0 ? t_near : t0;
+            t1 = t_far < t1 ? t_far : t1;
+        }
+        t = t0;
+        return t0 <= t1;
+    }
+
+    // Moller-Trumbore, returns whether the ray hits either side of the triangle within [ray.tmin, ray.tmax]
+    // Stores the distance in t and the barycentric coordinates of the hit in u and v
+    template<typename T>
+    constexpr bool intersect(const Ray<T> &ray, const Triangle<T> &tri, T &t, T &u, T &v) {
+        Vec3<T> e1 = tri.v1 - tri.v0;
+        Vec3<T> e2 = tri.v2 - tri.v0;
+        Vec3<T> p = ray.direction.cross(e2);
+        T det = e1.dot(p);
+        // Parallel rays give det == 0, it is tested last so the arithmetic stays branch free
+        T inv = (T)1 / det;
+        Vec3<T> s = ray.origin - tri.v0;
+        u = s.dot(p) * inv;
+        Vec3<T> q = s.cross(e1);
+        v = ray.direction.dot(q) * inv;
+        t = e2.dot(q) * inv;
+        return det != (T)0 && u >= (T)0 && u <= (T)1 && v >= (T)0 && u + v <= (T)1 && t >= ray.tmin && t <= ray.tmax;
+    }
+}
+
+#endif
@@ -0,0 +1,384 @@
+#ifndef HASHGRIDHPP
+#define HASHGRIDHPP
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "vector.hpp"
+
+/**
+ * @brief A uniform grid stored as a spatial hash, for broadphase collision of moving points
+ *
+ * Cells are keyed on Vec<int, N> in an open addressing table with linear probing. Every cell holds
+ * the head of an intrusive list through the objects, so insert, move and remove never allocate once
+ * the table is large enough. The cell size should be at least the diameter of the largest object.
+ *
+ * @tparam T Type of the positions
+ * @tparam N Number of dimensions, 2 or 3
+ */
+template<typename T, std::size_t N>
+struct HashGrid {
+    static_assert(N == 2 || N == 3, "HashGrid supports 2 and 3 dimensions");
+
+    using handle = std::uint32_t;
+    static constexpr handle null = std::numeric_limits<handle>::max();
+
+    struct Object {
+        Vec<T, N> position;
+        Vec<int, N> cell;
+        handle next = null;
+        handle prev = null;
+        bool alive = false;
+    };
+
+    struct Cell {
+        Vec<int, N> key;
+        handle head = null;
+        std::uint32_t count = 0;
+    };
+
+    T cell_size;
+    std::vector<Object> objects;
+    std::vector<Cell> cells;
+
+    inline HashGrid(T cell_size, std::size_t capacity = 64) : cell_size(cell_size) {
+        if (!(cell_size > (T)0)) {
+            throw std::invalid_argument("Cell size must be positive");
+        }
+        std::size_t size = 16;
+        while (size < capacity * 2) {
+            size *= 2;
+        }
+        cells.resize(size);
+    }
+
+    // Number of live objects
+    inline std::size_t size() const { return live; };
+    // Number of occupied cells
+    inline std::size_t cell_count() const { return occupied; };
+
+    // Returns the cell containing position
+    inline Vec<int, N> cell_of(const Vec<T, N> &position) const {
+        Vec<int, N> out;
+        for (std::size_t i = 0; i < N; i++) {
+            out.get(i) = (int)std::floor(position.get(i) / cell_size);
+        }
+        return out;
+    }
+
+    // Adds an object, the returned handle stays valid until it is removed
+    inline handle insert(const Vec<T, N> &position) {
+        handle h;
+        if (free_list != null) {
+            h = free_list;
+            free_list = objects[h].next;
+        } else {
+            h = (handle)objects.size();
+            objects.emplace_back();
+        }
+        Object &o = objects[h];
+        o.position = position;
+        o.cell = cell_of(position);
+        o.alive = true;
+        link(h);
+        live++;
+        return h;
+    }
+
+    // Moves an object, only relinks it when it changes cell
+    inline void move(handle h, const Vec<T, N> &position) {
+        Object &o = at(h);
+        o.position = position;
+        Vec<int, N> cell = cell_of(position);
+        if (cell == o.cell) {
+            return;
+        }
+        unlink(h);
+        objects[h].cell = cell;
+        link(h);
+    }
+
+    inline void remove(handle h) {
+        at(h);
+        unlink(h);
+        Object &o = objects[h];
+        o.alive = false;
+        o.prev = null;
+        o.next = free_list;
+        free_list = h;
+        live--;
+    }
+
+    inline void clear() {
+        objects.clear();
+        for (Cell &c : cells) {
+            c = Cell();
+        }
+        free_list = null;
+        live = 0;
+        occupied = 0;
+    }
+
+    inline const Vec<T, N>& position(handle h) const {
+        return at(h).position;
+    }
+
+    // Calls f(handle) for every object in cell
+    template<typename F>
+    inline void query_cell(const Vec<int, N> &cell, F &&f) const {
+        std::size_t slot = find(cell);
+        if (slot == npos) {
+            return;
+        }
+        for (handle h = cells[slot].head; h != null; h = objects[h].next) {
+            f(h);
+        }
+    }
+
+    // Calls f(handle) for every object within radius of position
+    template<typename F>
+    inline void query_radius(const Vec<T, N> &position, T radius, F &&f) const {
+        Vec<T, N> offset;
+        for (std::size_t i = 0; i < N; i++) {
+            offset.get(i) = radius;
+        }
+        Vec<int, N> lo = cell_of(position - offset);
+        Vec<int, N> hi = cell_of(position + offset);
+        T r2 = radius * radius;
+        Vec<int, N> c = lo;
+        for (;;) {
+            query_cell(c, [&](handle h) {
+                if ((objects[h].position - position).length_squared() <= r2) {
+                    f(h);
+                }
+            });
+            // Odometer style increment over the cell range
+            std::size_t i = 0;
+            for (; i < N; i++) {
+                if (++c.get(i) <= hi.get(i)) {
+                    break;
+                }
+                c.get(i) = lo.get(i);
+            }
+            if (i == N) {
+                break;
+            }
+        }
+    }
+
+    // Calls f(a, b) once for every pair of objects in the same or neighbouring cells, the broadphase candidate set
+    template<typename F>
+    inline void for_each_pair(F &&f) const {
+        for_each_pair_within(1, f);
+    }
+
+    // Calls f(a, b) for every pair whose distance is at most radius
+    // A radius above cell_size widens the neighbourhood to ceil(radius / cell_size) cells, the cost grows with its power N
+    template<typename F>
+    inline void for_each_pair(T radius, F &&f) const {
+        const int reach = radius > cell_size ? (int)std::ceil(radius / cell_size) : 1;
+        T r2 = radius * radius;
+        for_each_pair_within(reach, [&](handle a, handle b) {
+            if ((objects[a].position - objects[b].position).length_squared() <= r2) {
+                f(a, b);
+            }
+        });
+    }
+
+private:
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    handle free_list = null;
+    std::size_t live = 0;
+    std::size_t occupied = 0;
+
+    inline const Object& at(handle h) const {
+        if (h >= objects.size() || !objects[h].alive) {
+            throw std::out_of_range("Invalid handle");
+        }
+        return objects[h];
+    }
+
+    inline Object& at(handle h) {
+        if (h >= objects.size() || !objects[h].alive) {
+            throw std::out_of_range("Invalid handle");
+        }
+        return objects[h];
+    }
+
+    static inline std::size_t hash(const Vec<int, N> &key) {
+        std::uint64_t h = (std::uint32_t)key.x * 0x9E3779B1u;
+        h ^= (std::uint64_t)((std::uint32_t)key.y * 0x85EBCA77u) << 16;
+        if constexpr (N == 3) {
+            h ^= (std::uint64_t)((std::uint32_t)key.z * 0xC2B2AE3Du) << 32;
+        }
+        h *= 0x9E3779B97F4A7C15ull;
+        return (std::size_t)(h >> 32);
+    }
+
+    inline std::size_t mask() const {
+        return cells.size() - 1;
+    }
+
+    inline std::size_t find(const Vec<int, N> &key) const {
+        std::size_t slot = hash(key) & mask();
+        while (cells[slot].count != 0) {
+            if (cells[slot].key == key) {
+                return slot;
+            }
+            slot = (slot + 1) & mask();
+        }
+        return npos;
+    }
+
+    // Returns the slot of key, claiming an empty one when it is not in the table
+    inline std::size_t acquire(const Vec<int, N> &key) {
+        if ((occupied + 1) * 2 > cells.size()) {
+            grow();
+        }
+        std::size_t slot = hash(key) & mask();
+        while (cells[slot].count != 0) {
+            if (cells[slot].key == key) {
+                return slot;
+            }
+            slot = (slot + 1) & mask();
+        }
+        cells[slot].key = key;
+        cells[slot].head = null;
+        occupied++;
+        return slot;
+    }
+
+    // Empties a slot with backward shift deletion, so lookups never need tombstones
+    inline void release(std::size_t slot) {
+        occupied--;
+        std::size_t hole = slot;
+        std::size_t next = (hole + 1) & mask();
+        while (cells[next].count != 0) {
+            std::size_t home = hash(cells[next].key) & mask();
+            // Move the entry back when the hole lies between its home slot and its current slot
+            if (((next - home) & mask()) >= ((next - hole) & mask())) {
+                cells[hole] = cells[next];
+                hole = next;
+            }
+            next = (next + 1) & mask();
+        }
+        cells[hole] = Cell();
+    }
+
+    inline void grow() {
+        std::vector<Cell> old = std::move(cells);
+        cells.assign(old.size() * 2, Cell());
+        for (const Cell &c : old) {
+            if (c.count == 0) {
+                continue;
+            }
+            std::size_t slot = hash(c.key) & mask();
+            while (cells[slot].count != 0) {
+                slot = (slot + 1) & mask();
+            }
+            cells[slot] = c;
+        }
+    }
+
+    inline void link(handle h) {
+        Object &o = objects[h];
+        std::size_t slot = acquire(o.cell);
+        Cell &c = cells[slot];
+        o.prev = null;
+        o.next = c.head;
+        if (c.head != null) {
+            objects[c.head].prev = h;
+        }
+        c.head = h;
+        c.count++;
+    }
+
+    inline void unlink(handle h) {
+        Object &o = objects[h];
+        std::size_t slot = find(o.cell);
+        Cell &c = cells[slot];
+        if (o.prev != null) {
+            objects[o.prev].next = o.next;
+        } else {
+            c.head = o.next;
+        }
+        if (o.next != null) {
+            objects[o.next].prev = o.prev;
+        }
+        o.next = null;
+        o.prev = null;
+        if (--c.count == 0) {
+            release(slot);
+        }
+    }
+
+    // Calls f(a, b) once for every pair of objects in the same cell or in cells at most reach apart on every axis
+    template<typename F>
+    inline void for_each_pair_within(int reach, F &&f) const {
+        for (const Cell &cell : cells) {
+            if (cell.count == 0) {
+                continue;
+            }
+            for (handle a = cell.head; a != null; a = objects[a].next) {
+                for (handle b = objects[a].next; b != null; b = objects[b].next) {
+                    f(a, b);
+                }
+            }
+            // Only the forward half of the neighbourhood, so every pair of cells is visited once
+            for_each_forward_neighbor(cell.key, reach, [&](const Vec<int, N> &key) {
+                std::size_t slot = find(key);
+                if (slot == npos) {
+                    return;
+                }
+                for (handle a = cell.head; a != null; a = objects[a].next) {
+                    for (handle b = cells[slot].head; b != null; b = objects[b].next) {
+                        f(a, b);
+                    }
+                }
+            });
+        }
+    }
+
+    // Calls f(key) for the cells at most reach from key on every axis that come after it in lexicographic order
+    template<typename F>
+    static inline void for_each_forward_neighbor(const Vec<int, N> &key, int reach, F &&f) {
+        if constexpr (N == 2) {
+            for (int dy = 0; dy <= reach; dy++) {
+                for (int dx = -reach; dx <= reach; dx++) {
+                    // Skips the cell itself and the backward half
+                    if (dy == 0 && dx <= 0) {
+                        continue;
+                    }
+                    f(Vec<int, N>(key.x + dx, key.y + dy));
+                }
+            }
+        } else {
+            for (int dz = 0; dz <= reach; dz++) {
+                for (int dy = -reach; dy <= reach; dy++) {
+                    for (int dx = -reach; dx <= reach; dx++) {
+                        // Skips the cell itself and the backward half
+                        if (dz == 0 && (dy < 0 || (dy == 0 && dx <= 0))) {
+                            continue;
+                        }
+                        f(Vec<int, N>(key.x + dx, key.y + dy, key.z + dz));
+                    }
+                }
+            }
+        }
+    }
+};
+
+template<typename T> using HashGrid2 = HashGrid<T, 2>;
+template<typename T> using HashGrid3 = HashGrid<T, 3>;
+
+using hashgrid2f = HashGrid2<float>;
+using hashgrid2d = HashGrid2<double>;
+using hashgrid3f = HashGrid3<float>;
+using hashgrid3d = HashGrid3<double>;
+
+#endif
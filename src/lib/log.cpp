@@ -0,0 +1,214 @@
+#include "./log.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "./ansi.hpp"
+#include "./terminal.hpp"
+
+namespace logging {
+
+    namespace {
+        inline std::string_view color_of(Level level) {
+            switch (level) {
+                case Level::trace: return ansi::sgr<ansi::code::fg_bright>;
+                case Level::debug: return ansi::sgr<ansi::code::fg_black + 6>;
+                case Level::info: return ansi::sgr<ansi::code::fg_black + 2>;
+                case Level::warning: return ansi::sgr<ansi::code::fg_black + 3>;
+                case Level::error: return ansi::sgr<ansi::code::fg_black + 1>;
+                case Level::fatal: return ansi::sgr<ansi::code::bold, ansi::code::fg_black + 1>;
+            }
+            return {};
+        }
+    }
+
+    Sink::Sink(Options options) : options(std::move(options)) {
+        std::size_t size = 2;
+        while (size < this->options.capacity) {
+            size <<= 1;
+        }
+        mask = size - 1;
+        slots = std::make_unique<Slot[]>(size);
+        for (std::size_t i = 0; i < size; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        if (!this->options.output) {
+            this->options.output = [](std::string_view data) { terminal::write(data); };
+        }
+        // The writer takes records while the batch is below this, 0 would never take one
+        this->options.batch = std::max<std::size_t>(this->options.batch, 1);
+        buffer.reserve(this->options.batch + max_length + 32);
+        writer = std::thread([this]() { run(); });
+    }
+
+    Sink::~Sink() {
+        stopping.store(true, std::memory_order_seq_cst);
+        signal.fetch_add(1, std::memory_order_release);
+        signal.notify_one();
+        writer.join();
+    }
+
+    // Bounded queue after Vyukov, every slot carries the position it is free for and the one it is readable at
+    Sink::Slot* Sink::claim(std::uint64_t &position) {
+        position = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot &slot = slots[position & mask];
+            const std::uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const std::int64_t diff = (std::int64_t)(sequence - position);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    return &slot;
+                }
+            } else if (diff < 0) {
+                return nullptr;
+            } else {
+                position = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Takes with a compare and swap rather than a plain store so producers can discard under the overwrite policy
+    Sink::Slot* Sink::take(std::uint64_t &position) {
+        position = head.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot &slot = slots[position & mask];
+            const std::uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const std::int64_t diff = (std::int64_t)(sequence - (position + 1));
+            if (diff == 0) {
+                if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    return &slot;
+                }
+            } else if (diff < 0) {
+                return nullptr;
+            } else {
+                position = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void Sink::release(Slot* slot, std::uint64_t position) {
+        slot->sequence.store(position + mask + 1, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (blocked.load(std::memory_order_relaxed) > 0) {
+            freed.fetch_add(1, std::memory_order_release);
+            freed.notify_all();
+        }
+    }
+
+    void Sink::wake() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load(std::memory_order_relaxed)) {
+            signal.fetch_add(1, std::memory_order_release);
+            signal.notify_one();
+        }
+    }
+
+    bool Sink::push(Level level, std::string_view text) {
+        std::uint64_t position;
+        Slot* slot = claim(position);
+        while (slot == nullptr) {
+            if (options.policy == Policy::drop) {
+                dropped_count.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            if (options.policy == Policy::overwrite) {
+                std::uint64_t oldest;
+                Slot* old = take(oldest);
+                if (old != nullptr) {
+                    release(old, oldest);
+                    overwritten_count.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    // The oldest slot is still being written by its producer
+                    std::this_thread::yield();
+                }
+            } else {
+                blocked.fetch_add(1, std::memory_order_seq_cst);
+                const std::uint32_t seen = freed.load(std::memory_order_seq_cst);
+                slot = claim(position);
+                if (slot == nullptr) {
+                    wake();
+                    freed.wait(seen, std::memory_order_acquire);
+                }
+                blocked.fetch_sub(1, std::memory_order_relaxed);
+                if (slot != nullptr) {
+                    break;
+                }
+            }
+            slot = claim(position);
+        }
+        const std::size_t size = std::min(text.size(), max_length);
+        std::memcpy(slot->text, text.data(), size);
+        slot->size = (std::uint16_t)size;
+        slot->level = level;
+        slot->sequence.store(position + 1, std::memory_order_release);
+        wake();
+        return true;
+    }
+
+    void Sink::flush() {
+        const std::uint64_t target = tail.load(std::memory_order_acquire);
+        std::uint64_t done = completed.load(std::memory_order_acquire);
+        while (done < target) {
+            wake();
+            completed.wait(done, std::memory_order_acquire);
+            done = completed.load(std::memory_order_acquire);
+        }
+    }
+
+    void Sink::run() {
+        for (;;) {
+            const bool stop = stopping.load(std::memory_order_acquire);
+            bool empty = false;
+            while (buffer.size() < options.batch) {
+                std::uint64_t position;
+                Slot* slot = take(position);
+                if (slot == nullptr) {
+                    empty = true;
+                    break;
+                }
+                const std::string_view color = ansi::style(color_of(slot->level), options.color);
+                buffer += color;
+                buffer.append(slot->text, slot->size);
+                if (!color.empty()) {
+                    buffer += ansi::sgr<ansi::code::reset>;
+                }
+                buffer += '\n';
+                release(slot, position);
+            }
+            // Everything below head was either taken above or discarded by a producer
+            const std::uint64_t done = head.load(std::memory_order_acquire);
+            if (!buffer.empty()) {
+                options.output(buffer);
+                buffer.clear();
+            }
+            completed.store(done, std::memory_order_release);
+            completed.notify_all();
+
+            if (!empty) {
+                continue;
+            }
+            if (stop) {
+                return;
+            }
+            // A short grace period keeps bursts from paying a wake up per record
+            bool ready = false;
+            for (int spin = 0; spin < 64 && !ready; spin++) {
+                std::this_thread::yield();
+                const std::uint64_t next = head.load(std::memory_order_relaxed);
+                ready = slots[next & mask].sequence.load(std::memory_order_acquire) == next + 1;
+            }
+            if (ready) {
+                continue;
+            }
+            const std::uint32_t seen = signal.load(std::memory_order_acquire);
+            sleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const std::uint64_t next = head.load(std::memory_order_relaxed);
+            ready = slots[next & mask].sequence.load(std::memory_order_acquire) == next + 1;
+            if (!ready && !stopping.load(std::memory_order_relaxed)) {
+                signal.wait(seen, std::memory_order_acquire);
+            }
+            sleeping.store(false, std::memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,134 @@
+#ifndef LOGHPP
+#define LOGHPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "terminal.hpp"
+
+// Asynchronous log sink
+//
+// Producer threads copy pre-formatted records into a bounded lock-free ring and return, a writer thread drains the
+// ring, colours every record by its level and hands the lines to the output in large batches. A producer only pays
+// for a copy and a compare and swap, the terminal and the stream locks are off the calling path.
+namespace logging {
+
+    enum class Level : std::uint8_t {
+        trace,
+        debug,
+        info,
+        warning,
+        error,
+        fatal,
+    };
+
+    // What push does when the ring is full
+    enum class Policy : std::uint8_t {
+        block,      // Wait for the writer to free a slot
+        drop,       // Discard the new record
+        overwrite,  // Discard the oldest record
+    };
+
+    struct Options {
+        // Number of records the ring holds, rounded up to a power of two
+        std::size_t capacity = 4096;
+        Policy policy = Policy::block;
+        // Wrap every record in the ansi colour of its level, on when stdout shows colours
+        bool color = terminal::capabilities().color != terminal::ColorSupport::none;
+        // Bytes gathered before the writer calls output, it also calls it whenever the ring runs empty
+        // 0 counts as 1, every record is handed to output on its own
+        std::size_t batch = 1 << 16;
+        // Receives the batches, writes to stdout when empty
+        std::function<void(std::string_view)> output;
+    };
+
+    /**
+     * @brief Multi producer log sink writing from its own thread
+     *
+     * Records are single lines, the sink appends the newline. Longer records than max_length are cut. Destroying the
+     * sink writes every record pushed before and joins the writer.
+     */
+    class Sink {
+    public:
+        // Longest record, a slot is a few cache lines
+        static constexpr std::size_t max_length = 240;
+
+        explicit Sink(Options options = Options());
+        ~Sink();
+
+        Sink(const Sink &) = delete;
+        Sink& operator = (const Sink &) = delete;
+
+        // Queues a record, returns false when the drop policy discarded it
+        bool push(Level level, std::string_view text);
+
+        inline bool trace(std::string_view text) { return push(Level::trace, text); };
+        inline bool debug(std::string_view text) { return push(Level::debug, text); };
+        inline bool info(std::string_view text) { return push(Level::info, text); };
+        inline bool warning(std::string_view text) { return push(Level::warning, text); };
+        inline bool error(std::string_view text) { return push(Level::error, text); };
+        inline bool fatal(std::string_view text) { return push(Level::fatal, text); };
+
+        // Waits until every record pushed before the call has been handed to the output or discarded
+        void flush();
+
+        // Records discarded by the drop policy
+        inline std::size_t dropped() const { return dropped_count.load(std::memory_order_relaxed); };
+
+        // Records discarded by the overwrite policy
+        inline std::size_t overwritten() const { return overwritten_count.load(std::memory_order_relaxed); };
+
+        inline std::size_t capacity() const { return mask + 1; };
+
+    private:
+        struct alignas(64) Slot {
+            std::atomic<std::uint64_t> sequence;
+            std::uint16_t size;
+            Level level;
+            char text[max_length];
+        };
+
+        // Claims the next free slot, returns nullptr when the ring is full
+        Slot* claim(std::uint64_t &position);
+
+        // Takes the oldest record, returns nullptr when the ring is empty
+        Slot* take(std::uint64_t &position);
+
+        // Hands a taken slot back to producers
+        void release(Slot* slot, std::uint64_t position);
+
+        void wake();
+        void run();
+
+        Options options;
+        std::size_t mask;
+        std::unique_ptr<Slot[]> slots;
+
+        alignas(64) std::atomic<std::uint64_t> tail = 0;
+        alignas(64) std::atomic<std::uint64_t> head = 0;
+
+        // Writer side, every position below completed has been written or discarded
+        alignas(64) std::atomic<std::uint64_t> completed = 0;
+        std::atomic<std::uint32_t> signal = 0;
+        std::atomic<bool> sleeping = false;
+        std::atomic<bool> stopping = false;
+
+        // Producers blocked on a full ring wait for freed to change
+        std::atomic<std::uint32_t> freed = 0;
+        std::atomic<std::uint32_t> blocked = 0;
+
+        std::atomic<std::size_t> dropped_count = 0;
+        std::atomic<std::size_t> overwritten_count = 0;
+
+        std::string buffer;
+        std::thread writer;
+    };
+}
+
+#endif
@@ -1,20 +1,179 @@
 #include "./math.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <stdexcept>
+
+#include "./simd.hpp"
+
 namespace math {
     // Fast inverse square root
     // See: http://en.wikipedia.org/wiki/Fast_inverse_square_root
-    double fast_inverse_sqrt(double x) {
-        double xhalf = 0.5f * x;
-        int i = *(int*)&x;
-        i = 0x5f3759df - (i >> 1);
-        x = *(double*)&i;
-        x = x * (1.5f - xhalf * x * x);
-        return x;
+    float fast_inverse_sqrt(float x, int steps) {
+        float y = simd::rsqrt_estimate(x);
+        for (int i = 0; i < steps; i++) {
+            y = simd::rsqrt_step(x, y);
+        }
+        return y;
+    };
+
+    // Fast inverse square root, with the 64 bit magic constant
+    double fast_inverse_sqrt(double x, int steps) {
+        double y = simd::rsqrt_estimate(x);
+        for (int i = 0; i < steps; i++) {
+            y = simd::rsqrt_step(x, y);
+        }
+        return y;
+    };
+
+    void fast_inverse_sqrt(std::span<const float> in, std::span<float> out, int steps) {
+        if (out.size() < in.size()) {
+            throw std::invalid_argument("Output span too small");
+        }
+        for (std::size_t i = 0; i < in.size(); i++) {
+            out[i] = fast_inverse_sqrt(in[i], steps);
+        }
+    };
+
+    void fast_inverse_sqrt(std::span<const double> in, std::span<double> out, int steps) {
+        if (out.size() < in.size()) {
+            throw std::invalid_argument("Output span too small");
+        }
+        for (std::size_t i = 0; i < in.size(); i++) {
+            out[i] = fast_inverse_sqrt(in[i], steps);
+        }
     };
 
     // Floating point comparison
     // See: http://realtimecollisiondetection.net/blog/?p=89
-    bool fequal(float a, float b) {
-        return std::abs(a - b) < 0.00001f;
+    bool fequal(float a, float b, float epsilon) {
+        return relative_equal(a, b, epsilon, epsilon);
+    };
+
+    bool fequal(double a, double b, double epsilon) {
+        return relative_equal(a, b, epsilon, epsilon);
+    };
+
+    namespace {
+        // Pairs per block, a fixed trip count so the loop vectorizes at -O2 as well
+        constexpr std::size_t compare_block = 512;
+
+        template<typename T>
+        struct BlockStats {
+            std::size_t mismatches;
+            T max_error;
+            std::uint64_t max_ulps;
+        };
+
+        template<typename T>
+        struct Pair {
+            using U = std::conditional_t<std::is_same_v<T, float>, std::uint32_t, std::uint64_t>;
+
+            bool match;
+            // |a - b|, NaN when either is
+            T error;
+            // Distance in representable values, 0 when either is NaN
+            U ulps;
+
+            // Works on the bits, a float ternary or max keeps gcc from vectorizing the loops calling it
+            // Magnitudes that are not NaN order like their bits, so max and <= are integer operations
+            static inline Pair of(T a, T b, T absolute, T relative, U max_ulps) {
+                constexpr U magnitude = std::numeric_limits<U>::max() >> 1;
+                constexpr U infinity = std::bit_cast<U>(std::numeric_limits<T>::infinity());
+                U d = std::bit_cast<U>(a - b) & magnitude;
+                U fa = std::bit_cast<U>(a) & magnitude;
+                U fb = std::bit_cast<U>(b) & magnitude;
+                U scaled = std::bit_cast<U>(relative * std::bit_cast<T>(fa > fb ? fa : fb));
+                U absolute_bits = std::bit_cast<U>(absolute);
+                U limit = absolute_bits > scaled ? absolute_bits : scaled;
+                auto x = detail::ordered(a);
+                auto y = detail::ordered(b);
+                U u = x > y ? (U)x - (U)y : (U)y - (U)x;
+                bool nan_a = fa > infinity;
+                bool nan_b = fb > infinity;
+                bool any_nan = nan_a | nan_b;
+                u &= (U)0 - (U)!any_nan;
+                // Infinite differences and NaN fail the tolerance, whatever the limit is
+                bool match = (a == b) | (nan_a & nan_b) | ((d < infinity) & (d <= limit)) | (!any_nan & (u <= max_ulps));
+                return { match, std::bit_cast<T>(d), u };
+            }
+        };
+
+        template<typename T>
+        inline BlockStats<T> compare_stats(const T* EXTLIB_RESTRICT a, const T* EXTLIB_RESTRICT b, T absolute, T relative, typename Pair<T>::U max_ulps) {
+            using U = typename Pair<T>::U;
+            constexpr U infinity = std::bit_cast<U>(std::numeric_limits<T>::infinity());
+            // Same width as the lanes, a block never has more than compare_block mismatches
+            U mismatches = 0;
+            U error = 0;
+            U ulps = 0;
+            for (std::size_t i = 0; i < compare_block; i++) {
+                Pair<T> p = Pair<T>::of(a[i], b[i], absolute, relative, max_ulps);
+                mismatches += (U)!p.match;
+                // NaN errors have larger bits than infinity and are masked out
+                U e = std::bit_cast<U>(p.error);
+                e &= (U)0 - (U)(e <= infinity);
+                error = e > error ? e : error;
+                ulps = p.ulps > ulps ? p.ulps : ulps;
+            }
+            return { (std::size_t)mismatches, std::bit_cast<T>(error), ulps };
+        }
+
+        template<typename T>
+        inline Comparison<T> compare_arrays(std::span<const T> a, std::span<const T> b, const Tolerance<T> &tolerance) {
+            using U = typename Pair<T>::U;
+            if (a.size() != b.size()) {
+                throw std::invalid_argument("Array sizes do not match");
+            }
+            const std::size_t n = a.size();
+            const U max_ulps = (U)std::min<std::uint64_t>(tolerance.ulps, std::numeric_limits<U>::max());
+            Comparison<T> out;
+            out.first = n;
+            // The last partial block is compared from zero padded copies, equal zeros never change the result
+            alignas(64) T tail_a[compare_block];
+            alignas(64) T tail_b[compare_block];
+            for (std::size_t base = 0; base < n; base += compare_block) {
+                const std::size_t size = std::min(compare_block, n - base);
+                const T* x = a.data() + base;
+                const T* y = b.data() + base;
+                if (size < compare_block) {
+                    std::fill(std::copy(x, x + size, tail_a), tail_a + compare_block, (T)0);
+                    std::fill(std::copy(y, y + size, tail_b), tail_b + compare_block, (T)0);
+                    x = tail_a;
+                    y = tail_b;
+                }
+                BlockStats<T> stats = compare_stats(x, y, tolerance.absolute, tolerance.relative, max_ulps);
+                // The rare blocks with news are scanned again for the indices
+                if (stats.mismatches > 0 && out.mismatches == 0) {
+                    for (std::size_t i = 0; i < size; i++) {
+                        if (!Pair<T>::of(x[i], y[i], tolerance.absolute, tolerance.relative, max_ulps).match) {
+                            out.first = base + i;
+                            break;
+                        }
+                    }
+                }
+                if (stats.max_error > out.max_error) {
+                    for (std::size_t i = 0; i < size; i++) {
+                        if (Pair<T>::of(x[i], y[i], tolerance.absolute, tolerance.relative, max_ulps).error == stats.max_error) {
+                            out.max_index = base + i;
+                            break;
+                        }
+                    }
+                    out.max_error = stats.max_error;
+                }
+                out.mismatches += stats.mismatches;
+                out.max_ulps = std::max(out.max_ulps, stats.max_ulps);
+            }
+            return out;
+        }
+    }
+
+    Comparison<float> compare(std::span<const float> a, std::span<const float> b, const Tolerance<float> &tolerance) {
+        return compare_arrays(a, b, tolerance);
+    };
+
+    Comparison<double> compare(std::span<const double> a, std::span<const double> b, const Tolerance<double> &tolerance) {
+        return compare_arrays(a, b, tolerance);
     };
 }
\ No newline at end of file
@@ -1,13 +1,121 @@
+#ifndef MATHHPP
+#define MATHHPP
+
 #include <math.h>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
 #include <string>
+#include <type_traits>
 
 namespace math
 {
-    // Fast inverse square root
+    // Fast inverse square root, steps is the number of Newton-Raphson refinements
+    // One step is within 0.18% of the exact result, every further step roughly doubles the correct bits
     // See: http://en.wikipedia.org/wiki/Fast_inverse_square_root
-    double fast_inverse_sqrt(double x);
+    float fast_inverse_sqrt(float x, int steps = 1);
+    double fast_inverse_sqrt(double x, int steps = 1);
+
+    // Fast inverse square root of every element, out may be in
+    void fast_inverse_sqrt(std::span<const float> in, std::span<float> out, int steps = 1);
+    void fast_inverse_sqrt(std::span<const double> in, std::span<double> out, int steps = 1);
 
-    // Floating point comparison
+    // Tolerance used by fequal and Vec::approx_equal when none is given
+    template<std::floating_point T>
+    constexpr T default_epsilon = std::is_same_v<T, float> ? (T)1e-5 : (T)1e-12;
+
+    // Floating point comparison, |a - b| <= epsilon * max(1, |a|, |b|)
+    // Absolute near zero and relative for larger magnitudes
     // See: http://realtimecollisiondetection.net/blog/?p=89
-    bool fequal(float a, float b);
-}
\ No newline at end of file
+    bool fequal(float a, float b, float epsilon = default_epsilon<float>);
+    bool fequal(double a, double b, double epsilon = default_epsilon<double>);
+
+    // Returns whether |a - b| <= max(absolute, relative * max(|a|, |b|)), equal infinities compare equal and NaN never does
+    template<std::floating_point T>
+    constexpr bool relative_equal(T a, T b, T relative, T absolute = (T)0) {
+        if (a == b) {
+            return true;
+        }
+        T fa = a < (T)0 ? -a : a;
+        T fb = b < (T)0 ? -b : b;
+        T d = a > b ? a - b : b - a;
+        T scaled = relative * (fa > fb ? fa : fb);
+        // An infinity against anything else gives an infinite difference, which no tolerance covers
+        return d < std::numeric_limits<T>::infinity() && d <= (absolute > scaled ? absolute : scaled);
+    }
+
+    namespace detail {
+        template<typename T>
+        concept ieee = std::same_as<T, float> || std::same_as<T, double>;
+
+        // Maps the bits of x to a signed integer that is ordered like x and counts one per representable value
+        // -0 and +0 both map to 0, negatives are negated through the sign mask so loops over it vectorize
+        template<ieee T>
+        constexpr auto ordered(T x) {
+            using I = std::conditional_t<std::is_same_v<T, float>, std::int32_t, std::int64_t>;
+            I i = std::bit_cast<I>(x);
+            I sign = i >> std::numeric_limits<I>::digits;
+            return (I)(((i & std::numeric_limits<I>::max()) ^ sign) - sign);
+        }
+    }
+
+    // Returns the number of representable values between a and b, the maximum when either is NaN
+    template<detail::ieee T>
+    constexpr std::uint64_t ulp_distance(T a, T b) {
+        if (a != a || b != b) {
+            return std::numeric_limits<std::uint64_t>::max();
+        }
+        auto x = detail::ordered(a);
+        auto y = detail::ordered(b);
+        // Unsigned so the distance between the most negative and most positive double does not overflow
+        return x > y ? (std::uint64_t)x - (std::uint64_t)y : (std::uint64_t)y - (std::uint64_t)x;
+    }
+
+    // Returns whether a and b are at most max_ulps representable values apart
+    // Scales with the magnitude by construction, but values near zero are many ulps apart, combine with an absolute tolerance there
+    template<detail::ieee T>
+    constexpr bool ulp_equal(T a, T b, std::uint64_t max_ulps = 4) {
+        return ulp_distance(a, b) <= max_ulps;
+    }
+
+    /**
+     * @brief When two values count as equal in compare, a pair matches when it is within any of the tolerances
+     *
+     * @tparam T Type of the values
+     */
+    template<typename T>
+    struct Tolerance {
+        T absolute = (T)0;
+        T relative = (T)0;
+        std::uint64_t ulps = 0;
+    };
+
+    /**
+     * @brief Result of compare
+     *
+     * @tparam T Type of the values
+     */
+    template<typename T>
+    struct Comparison {
+        // Index of the first mismatch, the array size when every pair matched
+        std::size_t first = 0;
+        std::size_t mismatches = 0;
+        // Largest |a - b| and its index, pairs with a NaN are left out
+        T max_error = (T)0;
+        std::size_t max_index = 0;
+        // Largest distance in representable values, pairs with a NaN are left out
+        std::uint64_t max_ulps = 0;
+
+        inline bool equal() const { return mismatches == 0; };
+    };
+
+    // Compares a and b element by element, pairs of equal values, equal infinities and two NaNs always match
+    // Runs at memory speed, use it instead of a loop over fequal for large arrays
+    Comparison<float> compare(std::span<const float> a, std::span<const float> b, const Tolerance<float> &tolerance = {});
+    Comparison<double> compare(std::span<const double> a, std::span<const double> b, const Tolerance<double> &tolerance = {});
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,342 @@
+#ifndef MATRIXHPP
+#define MATRIXHPP
+
+#include <cstddef>
+#include <iosfwd>
+#include <span>
+#include <stdexcept>
+
+#include "simd.hpp"
+#include "vector.hpp"
+#include "vectorarray.hpp"
+
+/**
+ * @brief A column major NxN matrix, Mat3 and Mat4 are aliases of it
+ *
+ * @tparam T Type of the elements
+ * @tparam N Number of rows and columns
+ */
+template<typename T, std::size_t N>
+struct Mat {
+    Vec<T, N> columns[N];
+
+    // Zero matrix
+    constexpr Mat() = default;
+
+    // Diagonal matrix
+    constexpr Mat(T diagonal) {
+        for (std::size_t i = 0; i < N; i++) {
+            columns[i].get(i) = diagonal;
+        }
+    }
+
+    // Matrix from its columns
+    template<typename... Cols>
+    requires (sizeof...(Cols) == N && (std::is_convertible_v<Cols, Vec<T, N>> && ...))
+    constexpr Mat(const Cols&... cols) : columns{ Vec<T, N>(cols)... } {}
+
+    static constexpr Mat<T, N> identity() {
+        return Mat<T, N>((T)1);
+    }
+
+    // Returns the element at row, col
+    constexpr T& operator () (std::size_t row, std::size_t col) {
+        if (row >= N || col >= N) {
+            throw std::out_of_range("Out of range item");
+        }
+        return columns[col].get(row);
+    }
+
+    constexpr const T& operator () (std::size_t row, std::size_t col) const {
+        if (row >= N || col >= N) {
+            throw std::out_of_range("Out of range item");
+        }
+        return columns[col].get(row);
+    }
+
+    constexpr Vec<T, N>& operator [] (std::size_t col) { return columns[col]; };
+    constexpr const Vec<T, N>& operator [] (std::size_t col) const { return columns[col]; };
+
+    constexpr Vec<T, N> column(std::size_t col) const {
+        return columns[col];
+    }
+
+    constexpr Vec<T, N> row(std::size_t row) const {
+        Vec<T, N> out;
+        for (std::size_t i = 0; i < N; i++) {
+            out.get(i) = columns[i].get(row);
+        }
+        return out;
+    }
+
+    constexpr bool operator == (const Mat<T, N> &other) const {
+        for (std::size_t i = 0; i < N; i++) {
+            if (!(columns[i] == other.columns[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    constexpr Mat<T, N> operator + (const Mat<T, N> &other) const {
+        Mat<T, N> out;
+        for (std::size_t i = 0; i < N; i++) out.columns[i] = columns[i] + other.columns[i];
+        return out;
+    }
+
+    constexpr Mat<T, N> operator - (const Mat<T, N> &other) const {
+        Mat<T, N> out;
+        for (std::size_t i = 0; i < N; i++) out.columns[i] = columns[i] - other.columns[i];
+        return out;
+    }
+
+    constexpr Mat<T, N> operator * (T scalar) const {
+        Mat<T, N> out;
+        for (std::size_t i = 0; i < N; i++) out.columns[i] = columns[i] * scalar;
+        return out;
+    }
+
+    // Transforms a vector, every column is scaled by one component and summed
+    constexpr Vec<T, N> operator * (const Vec<T, N> &vec) const {
+        Vec<T, N> out = columns[0] * vec.get(0);
+        for (std::size_t i = 1; i < N; i++) {
+            out += columns[i] * vec.get(i);
+        }
+        return out;
+    }
+
+    // Matrix product
+    constexpr Mat<T, N> operator * (const Mat<T, N> &other) const {
+        Mat<T, N> out;
+        if constexpr (N == 4) {
+            if (!std::is_constant_evaluated()) {
+                simd::mat4<T>::mul(&columns[0].x, &other.columns[0].x, &out.columns[0].x);
+                return out;
+            }
+        }
+        for (std::size_t i = 0; i < N; i++) {
+            out.columns[i] = *this * other.columns[i];
+        }
+        return out;
+    }
+
+    constexpr Mat<T, N>& operator *= (const Mat<T, N> &other) { return *this = *this * other; };
+
+    // Returns the transposed matrix
+    constexpr Mat<T, N> transpose() const {
+        Mat<T, N> out;
+        if constexpr (N == 4) {
+            if (!std::is_constant_evaluated()) {
+                simd::mat4<T>::transpose(&columns[0].x, &out.columns[0].x);
+                return out;
+            }
+        }
+        for (std::size_t c = 0; c < N; c++) {
+            for (std::size_t r = 0; r < N; r++) {
+                out.columns[r].get(c) = columns[c].get(r);
+            }
+        }
+        return out;
+    }
+
+    // Returns the determinant, computed with gaussian elimination
+    constexpr T determinant() const {
+        Mat<T, N> m = *this;
+        T det = (T)1;
+        for (std::size_t c = 0; c < N; c++) {
+            std::size_t pivot = c;
+            for (std::size_t r = c + 1; r < N; r++) {
+                if (abs(m.columns[c].get(r)) > abs(m.columns[c].get(pivot))) {
+                    pivot = r;
+                }
+            }
+            if (m.columns[c].get(pivot) == (T)0) {
+                return (T)0;
+            }
+            if (pivot != c) {
+                m.swap_rows(pivot, c);
+                det = -det;
+            }
+            T p = m.columns[c].get(c);
+            det *= p;
+            for (std::size_t r = c + 1; r < N; r++) {
+                T f = m.columns[c].get(r) / p;
+                for (std::size_t k = c; k < N; k++) {
+                    m.columns[k].get(r) -= f * m.columns[k].get(c);
+                }
+            }
+        }
+        return det;
+    }
+
+    // Returns the inverse, computed with gauss-jordan elimination, throws when the matrix is singular
+    constexpr Mat<T, N> inverse() const {
+        Mat<T, N> m = *this;
+        Mat<T, N> inv = identity();
+        for (std::size_t c = 0; c < N; c++) {
+            std::size_t pivot = c;
+            for (std::size_t r = c + 1; r < N; r++) {
+                if (abs(m.columns[c].get(r)) > abs(m.columns[c].get(pivot))) {
+                    pivot = r;
+                }
+            }
+            if (m.columns[c].get(pivot) == (T)0) {
+                throw std::domain_error("Matrix is singular");
+            }
+            m.swap_rows(pivot, c);
+            inv.swap_rows(pivot, c);
+            T p = (T)1 / m.columns[c].get(c);
+            for (std::size_t k = 0; k < N; k++) {
+                m.columns[k].get(c) *= p;
+                inv.columns[k].get(c) *= p;
+            }
+            for (std::size_t r = 0; r < N; r++) {
+                if (r == c) {
+                    continue;
+                }
+                T f = m.columns[c].get(r);
+                for (std::size_t k = 0; k < N; k++) {
+                    m.columns[k].get(r) -= f * m.columns[k].get(c);
+                    inv.columns[k].get(r) -= f * inv.columns[k].get(c);
+                }
+            }
+        }
+        return inv;
+    }
+
+    inline friend std::ostream& operator<<(std::ostream& os, const Mat<T, N>& mat)
+    {
+        for (std::size_t r = 0; r < N; r++) {
+            os << mat.row(r) << (r + 1 < N ? "\n" : "");
+        }
+        return os;
+    }
+
+private:
+    static constexpr T abs(T value) {
+        return value < (T)0 ? -value : value;
+    }
+
+    constexpr void swap_rows(std::size_t a, std::size_t b) {
+        if (a == b) {
+            return;
+        }
+        for (std::size_t k = 0; k < N; k++) {
+            T tmp = columns[k].get(a);
+            columns[k].get(a) = columns[k].get(b);
+            columns[k].get(b) = tmp;
+        }
+    }
+};
+
+template<typename T> using Mat2 = Mat<T, 2>;
+template<typename T> using Mat3 = Mat<T, 3>;
+template<typename T> using Mat4 = Mat<T, 4>;
+
+using mat2f = Mat2<float>;
+using mat2d = Mat2<double>;
+using mat3f = Mat3<float>;
+using mat3d = Mat3<double>;
+using mat4f = Mat4<float>;
+using mat4d = Mat4<double>;
+
+using float2x2 = Mat2<float>;
+using double2x2 = Mat2<double>;
+using float3x3 = Mat3<float>;
+using double3x3 = Mat3<double>;
+using float4x4 = Mat4<float>;
+using double4x4 = Mat4<double>;
+
+// Batch transforms of vector buffers
+namespace matrix {
+
+    // out[i] = m * in[i]
+    template<typename T>
+    inline void transform(const Mat4<T> &m, std::span<const Vec4<T>> in, std::span<Vec4<T>> out) {
+        if (out.size() < in.size()) {
+            throw std::invalid_argument("Output span too small");
+        }
+        simd::mat4<T>::transform(&m.columns[0].x, &in.data()->x, &out.data()->x, in.size());
+    }
+
+    // out[i] = m * in[i]
+    template<typename T, std::size_t N>
+    inline void transform(const Mat<T, N> &m, std::span<const Vec<T, N>> in, std::span<Vec<T, N>> out) {
+        if (out.size() < in.size()) {
+            throw std::invalid_argument("Output span too small");
+        }
+        for (std::size_t i = 0; i < in.size(); i++) {
+            out[i] = m * in[i];
+        }
+    }
+
+    // out[i] = m * in[i], every output lane is a sum of scaled input lanes so the loops run at full SIMD width
+    template<typename T, std::size_t N>
+    inline void transform(const Mat<T, N> &m, const VecArray<T, N> &in, VecArray<T, N> &out) {
+        const std::size_t n = in.size();
+        if (&in == &out) {
+            VecArray<T, N> tmp;
+            transform(m, in, tmp);
+            out = std::move(tmp);
+            return;
+        }
+        out.resize(n);
+        for (std::size_t r = 0; r < N; r++) {
+            T* EXTLIB_RESTRICT o = out.lane(r);
+            const T m0 = m.columns[0].get(r);
+            const T* EXTLIB_RESTRICT i0 = in.lane(0);
+            for (std::size_t i = 0; i < n; i++) {
+                o[i] = m0 * i0[i];
+            }
+            for (std::size_t c = 1; c < N; c++) {
+                const T mc = m.columns[c].get(r);
+                const T* EXTLIB_RESTRICT ic = in.lane(c);
+                for (std::size_t i = 0; i < n; i++) {
+                    o[i] += mc * ic[i];
+                }
+            }
+        }
+    }
+
+    // Transforms points (w = 1) by an affine or projective matrix, the result is divided by w
+    template<typename T>
+    inline void transform_points(const Mat4<T> &m, const Vec3Array<T> &in, Vec3Array<T> &out) {
+        const std::size_t n = in.size();
+        if (&in == &out) {
+            Vec3Array<T> tmp;
+            transform_points(m, in, tmp);
+            out = std::move(tmp);
+            return;
+        }
+        out.resize(n);
+        const T* EXTLIB_RESTRICT x = in.x();
+        const T* EXTLIB_RESTRICT y = in.y();
+        const T* EXTLIB_RESTRICT z = in.z();
+        T* EXTLIB_RESTRICT ox = out.x();
+        T* EXTLIB_RESTRICT oy = out.y();
+        T* EXTLIB_RESTRICT oz = out.z();
+        const Mat4<T> &a = m;
+        for (std::size_t i = 0; i < n; i++) {
+            T tx = a.columns[0].x * x[i] + a.columns[1].x * y[i] + a.columns[2].x * z[i] + a.columns[3].x;
+            T ty = a.columns[0].y * x[i] + a.columns[1].y * y[i] + a.columns[2].y * z[i] + a.columns[3].y;
+            T tz = a.columns[0].z * x[i] + a.columns[1].z * y[i] + a.columns[2].z * z[i] + a.columns[3].z;
+            T tw = a.columns[0].w * x[i] + a.columns[1].w * y[i] + a.columns[2].w * z[i] + a.columns[3].w;
+            T inv = (T)1 / tw;
+            ox[i] = tx * inv;
+            oy[i] = ty * inv;
+            oz[i] = tz * inv;
+        }
+    }
+
+    // Transforms directions (w = 0), translation is ignored
+    template<typename T>
+    inline void transform_directions(const Mat4<T> &m, const Vec3Array<T> &in, Vec3Array<T> &out) {
+        Mat3<T> upper;
+        for (std::size_t c = 0; c < 3; c++) {
+            upper.columns[c] = m.columns[c].xyz();
+        }
+        transform(upper, in, out);
+    }
+}
+
+#endif
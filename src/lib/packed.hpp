@@ -0,0 +1,405 @@
+#ifndef PACKEDHPP
+#define PACKEDHPP
+
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+
+#include "simd.hpp"
+#include "vector.hpp"
+
+namespace packed {
+
+    namespace detail {
+        // Rounds to the nearest integer, ties to even like cvtps2dq, exact for |v| < 2^22
+        constexpr float round(float v) {
+            return (v + 12582912.0f) - 12582912.0f;
+        }
+
+        // Clamps to [lo, hi], NaN becomes lo like maxps followed by minps
+        constexpr float clamp(float v, float lo, float hi) {
+            v = v > lo ? v : lo;
+            return v < hi ? v : hi;
+        }
+    }
+}
+
+/**
+ * @brief IEEE 754 binary16 storage, converts to and from float and rounds to nearest even
+ *
+ * Only meant for storage, arithmetic happens after the implicit conversion to float.
+ * Values above 65504 become infinity and NaN stays NaN.
+ */
+struct half {
+    std::uint16_t bits = 0;
+
+    constexpr half() = default;
+    constexpr half(float value) : bits(encode(value)) {}
+
+    static constexpr half from_bits(std::uint16_t bits) {
+        half out;
+        out.bits = bits;
+        return out;
+    }
+
+    constexpr operator float() const { return decode(bits); };
+
+    constexpr bool operator == (const half &other) const = default;
+
+    static constexpr std::uint16_t encode(float value) {
+        std::uint32_t f = std::bit_cast<std::uint32_t>(value);
+        std::uint32_t sign = f & 0x80000000u;
+        f ^= sign;
+        std::uint32_t out;
+        if (f >= (127u + 16u) << 23) {
+            // Infinity or NaN, NaN keeps a quiet bit
+            out = f > 255u << 23 ? 0x7e00 : 0x7c00;
+        } else if (f < 113u << 23) {
+            // Subnormal or zero, the float addition rounds the mantissa into place
+            const std::uint32_t magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+            out = std::bit_cast<std::uint32_t>(std::bit_cast<float>(f) + std::bit_cast<float>(magic)) - magic;
+        } else {
+            std::uint32_t odd = (f >> 13) & 1;
+            f += ((std::uint32_t)(15 - 127) << 23) + 0xfff + odd;
+            out = f >> 13;
+        }
+        return (std::uint16_t)(out | (sign >> 16));
+    }
+
+    static constexpr float decode(std::uint16_t bits) {
+        const std::uint32_t exponent = 0x7c00u << 13;
+        std::uint32_t f = ((std::uint32_t)bits & 0x7fff) << 13;
+        std::uint32_t e = f & exponent;
+        f += (127u - 15u) << 23;
+        if (e == exponent) {
+            f += (128u - 16u) << 23;
+        } else if (e == 0) {
+            f += 1u << 23;
+            f = std::bit_cast<std::uint32_t>(std::bit_cast<float>(f) - std::bit_cast<float>(113u << 23));
+        }
+        return std::bit_cast<float>(f | ((std::uint32_t)bits & 0x8000) << 16);
+    }
+};
+
+/**
+ * @brief A float in [-1, 1] stored in 16 bits, like the GPU snorm16 format
+ *
+ * Encoding clamps and rounds to nearest even, -32768 decodes to -1 like -32767.
+ */
+struct snorm16 {
+    std::int16_t value = 0;
+
+    constexpr snorm16() = default;
+    constexpr snorm16(float f) : value((std::int16_t)packed::detail::round(packed::detail::clamp(f * 32767.0f, -32767.0f, 32767.0f))) {}
+
+    static constexpr snorm16 from_raw(std::int16_t value) {
+        snorm16 out;
+        out.value = value;
+        return out;
+    }
+
+    constexpr operator float() const {
+        float f = (float)value / 32767.0f;
+        return f > -1.0f ? f : -1.0f;
+    }
+
+    constexpr bool operator == (const snorm16 &other) const = default;
+};
+
+/**
+ * @brief A float in [0, 1] stored in 8 bits, like the GPU unorm8 format
+ *
+ * Encoding clamps and rounds to nearest even.
+ */
+struct unorm8 {
+    std::uint8_t value = 0;
+
+    constexpr unorm8() = default;
+    constexpr unorm8(float f) : value((std::uint8_t)packed::detail::round(packed::detail::clamp(f * 255.0f, 0.0f, 255.0f))) {}
+
+    static constexpr unorm8 from_raw(std::uint8_t value) {
+        unorm8 out;
+        out.value = value;
+        return out;
+    }
+
+    constexpr operator float() const { return (float)value / 255.0f; };
+
+    constexpr bool operator == (const unorm8 &other) const = default;
+};
+
+/**
+ * @brief A unit vector in 4 bytes, octahedral encoded into two snorm16
+ *
+ * The sphere is projected onto the octahedron |x| + |y| + |z| = 1 whose lower half is folded over the upper one,
+ * worst case error is about 0.04 degrees. A zero vector decodes to (0, 0, 1).
+ */
+struct OctNormal {
+    snorm16 x;
+    snorm16 y;
+
+    constexpr OctNormal() = default;
+    OctNormal(const Vec3<float> &normal) {
+        float s = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+        float inv = s > 0.0f ? 1.0f / s : 0.0f;
+        float px = normal.x * inv;
+        float py = normal.y * inv;
+        if (normal.z < 0.0f) {
+            float fx = (1.0f - std::fabs(py));
+            float fy = (1.0f - std::fabs(px));
+            px = std::copysign(fx, px);
+            py = std::copysign(fy, py);
+        }
+        x = px;
+        y = py;
+    }
+
+    // Returns the decoded unit vector
+    Vec3<float> decode() const {
+        float px = x;
+        float py = y;
+        float pz = 1.0f - std::fabs(px) - std::fabs(py);
+        float t = -pz > 0.0f ? -pz : 0.0f;
+        px -= std::copysign(t, px);
+        py -= std::copysign(t, py);
+        float inv = 1.0f / std::sqrt(px * px + py * py + pz * pz);
+        return Vec3<float>(px * inv, py * inv, pz * inv);
+    };
+
+    operator Vec3<float>() const { return decode(); };
+
+    constexpr bool operator == (const OctNormal &other) const = default;
+};
+
+using vec2h   = Vec2<half>;
+using vec3h   = Vec3<half>;
+using vec4h   = Vec4<half>;
+using vec2sn  = Vec2<snorm16>;
+using vec3sn  = Vec3<snorm16>;
+using vec4sn  = Vec4<snorm16>;
+using vec4un  = Vec4<unorm8>;
+
+namespace packed {
+
+    namespace detail {
+        inline void check(std::size_t in, std::size_t out) {
+            if (out < in) {
+                throw std::invalid_argument("Output span too small");
+            }
+        }
+
+#if defined(EXTLIB_SSE2)
+        inline __m128i half_encode(__m128 f) {
+#if defined(EXTLIB_F16C)
+            return _mm_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT);
+#else
+            // Same steps as half::encode, all paths computed and selected with masks
+            const __m128i infinity = _mm_set1_epi32(0x7c00);
+            const __m128i nan_bit = _mm_set1_epi32(0x200);
+            const __m128i max = _mm_set1_epi32((127 + 16) << 23);
+            const __m128i min_normal = _mm_set1_epi32(113 << 23);
+            const __m128i magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+            const __m128i bias = _mm_set1_epi32(0xfff - ((127 - 15) << 23));
+
+            __m128 sign = _mm_and_ps(f, _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000u)));
+            __m128 abs = _mm_xor_ps(f, sign);
+            __m128i bits = _mm_castps_si128(abs);
+            __m128i is_nan = _mm_castps_si128(_mm_cmpunord_ps(abs, abs));
+            __m128i is_regular = _mm_cmpgt_epi32(max, bits);
+            __m128i is_subnormal = _mm_cmpgt_epi32(min_normal, bits);
+            __m128i special = _mm_or_si128(_mm_and_si128(is_nan, nan_bit), infinity);
+            __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(abs, _mm_castsi128_ps(magic))), magic);
+            __m128i odd = _mm_srai_epi32(_mm_slli_epi32(bits, 31 - 13), 31);
+            __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(bits, bias), odd), 13);
+            __m128i out = _mm_or_si128(_mm_and_si128(is_subnormal, subnormal), _mm_andnot_si128(is_subnormal, normal));
+            out = _mm_or_si128(_mm_and_si128(is_regular, out), _mm_andnot_si128(is_regular, special));
+            out = _mm_or_si128(out, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+            return _mm_packs_epi32(out, out);
+#endif
+        }
+
+        // Decodes the 4 halfs in the low 64 bits
+        inline __m128 half_decode(__m128i h) {
+#if defined(EXTLIB_F16C)
+            return _mm_cvtph_ps(h);
+#else
+            // Scaling by 2^112 moves the exponent and handles subnormals, infinity and NaN get their exponent or'ed in
+            h = _mm_unpacklo_epi16(h, _mm_setzero_si128());
+            __m128i abs = _mm_and_si128(h, _mm_set1_epi32(0x7fff));
+            __m128i sign = _mm_slli_epi32(_mm_xor_si128(h, abs), 16);
+            __m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(abs, 13)), _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23)));
+            __m128i special = _mm_and_si128(_mm_cmpgt_epi32(abs, _mm_set1_epi32(0x7bff)), _mm_set1_epi32(255 << 23));
+            return _mm_or_ps(scaled, _mm_castsi128_ps(_mm_or_si128(sign, special)));
+#endif
+        }
+
+        // Returns the magnitude of a with the sign of b
+        inline __m128 copysign(__m128 a, __m128 b) {
+            const __m128 mask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000u));
+            return _mm_or_ps(_mm_andnot_ps(mask, a), _mm_and_ps(mask, b));
+        }
+
+        inline __m128 abs(__m128 a) {
+            return _mm_andnot_ps(_mm_castsi128_ps(_mm_set1_epi32((int)0x80000000u)), a);
+        }
+
+        // Encodes 4 floats to snorm16 in the low 64 bits
+        inline __m128i snorm16_encode(__m128 f) {
+            __m128 v = _mm_min_ps(_mm_max_ps(_mm_mul_ps(f, _mm_set1_ps(32767.0f)), _mm_set1_ps(-32767.0f)), _mm_set1_ps(32767.0f));
+            __m128i i = _mm_cvtps_epi32(v);
+            return _mm_packs_epi32(i, i);
+        }
+
+        // Decodes the 4 snorm16 in the low 64 bits
+        inline __m128 snorm16_decode(__m128i s) {
+            __m128i i = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+            return _mm_max_ps(_mm_div_ps(_mm_cvtepi32_ps(i), _mm_set1_ps(32767.0f)), _mm_set1_ps(-1.0f));
+        }
+#endif
+
+        // Converts count floats to P, one lane at a time where there is no SIMD kernel
+        template<typename P>
+        inline void encode(const float* EXTLIB_RESTRICT in, P* EXTLIB_RESTRICT out, std::size_t count) {
+            std::size_t i = 0;
+#if defined(EXTLIB_SSE2)
+            if constexpr (std::is_same_v<P, half>) {
+#if defined(EXTLIB_F16C) && defined(EXTLIB_AVX)
+                for (; i + 8 <= count; i += 8) {
+                    _mm_storeu_si128((__m128i*)(out + i), _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT));
+                }
+#endif
+                for (; i + 4 <= count; i += 4) {
+                    _mm_storel_epi64((__m128i*)(out + i), half_encode(_mm_loadu_ps(in + i)));
+                }
+            } else if constexpr (std::is_same_v<P, snorm16>) {
+                for (; i + 4 <= count; i += 4) {
+                    _mm_storel_epi64((__m128i*)(out + i), snorm16_encode(_mm_loadu_ps(in + i)));
+                }
+            } else if constexpr (std::is_same_v<P, unorm8>) {
+                const __m128 scale = _mm_set1_ps(255.0f);
+                const __m128 max = _mm_set1_ps(255.0f);
+                for (; i + 16 <= count; i += 16) {
+                    __m128i a = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), scale), _mm_setzero_ps()), max));
+                    __m128i b = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 4), scale), _mm_setzero_ps()), max));
+                    __m128i c = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 8), scale), _mm_setzero_ps()), max));
+                    __m128i d = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 12), scale), _mm_setzero_ps()), max));
+                    _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+                }
+            }
+#endif
+            for (; i < count; i++) {
+                out[i] = P(in[i]);
+            }
+        }
+
+        // Converts count P back to floats
+        template<typename P>
+        inline void decode(const P* EXTLIB_RESTRICT in, float* EXTLIB_RESTRICT out, std::size_t count) {
+            std::size_t i = 0;
+#if defined(EXTLIB_SSE2)
+            if constexpr (std::is_same_v<P, half>) {
+#if defined(EXTLIB_F16C) && defined(EXTLIB_AVX)
+                for (; i + 8 <= count; i += 8) {
+                    _mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(in + i))));
+                }
+#endif
+                for (; i + 4 <= count; i += 4) {
+                    _mm_storeu_ps(out + i, half_decode(_mm_loadl_epi64((const __m128i*)(in + i))));
+                }
+            } else if constexpr (std::is_same_v<P, snorm16>) {
+                for (; i + 4 <= count; i += 4) {
+                    _mm_storeu_ps(out + i, snorm16_decode(_mm_loadl_epi64((const __m128i*)(in + i))));
+                }
+            } else if constexpr (std::is_same_v<P, unorm8>) {
+                const __m128 scale = _mm_set1_ps(255.0f);
+                for (; i + 4 <= count; i += 4) {
+                    std::int32_t word;
+                    std::memcpy(&word, in + i, sizeof(word));
+                    __m128i b = _mm_unpacklo_epi8(_mm_cvtsi32_si128(word), _mm_setzero_si128());
+                    __m128i v = _mm_unpacklo_epi16(b, _mm_setzero_si128());
+                    _mm_storeu_ps(out + i, _mm_div_ps(_mm_cvtepi32_ps(v), scale));
+                }
+            }
+#endif
+            for (; i < count; i++) {
+                out[i] = (float)in[i];
+            }
+        }
+    }
+
+    // out[i] = in[i] converted to the packed component type P, P is half, snorm16 or unorm8
+    template<typename P, std::size_t N>
+    inline void encode(std::span<const Vec<float, N>> in, std::span<Vec<P, N>> out) {
+        static_assert(sizeof(Vec<float, N>) == N * sizeof(float) && sizeof(Vec<P, N>) == N * sizeof(P), "Vec has to be tightly packed");
+        detail::check(in.size(), out.size());
+        detail::encode(&in.data()->get(0), &out.data()->get(0), in.size() * N);
+    }
+
+    // out[i] = in[i] converted back to float
+    template<typename P, std::size_t N>
+    inline void decode(std::span<const Vec<P, N>> in, std::span<Vec<float, N>> out) {
+        static_assert(sizeof(Vec<float, N>) == N * sizeof(float) && sizeof(Vec<P, N>) == N * sizeof(P), "Vec has to be tightly packed");
+        detail::check(in.size(), out.size());
+        detail::decode(&in.data()->get(0), &out.data()->get(0), in.size() * N);
+    }
+
+    // out[i] = OctNormal(in[i]), in should hold unit vectors
+    inline void encode(std::span<const Vec3<float>> in, std::span<OctNormal> out) {
+        detail::check(in.size(), out.size());
+        std::size_t i = 0;
+#if defined(EXTLIB_SSE2)
+        const float* src = &in.data()->x;
+        for (; i + 4 <= in.size(); i += 4) {
+            __m128 x, y, z;
+            simd::deinterleave3(src + i * 3, x, y, z);
+            __m128 s = _mm_add_ps(_mm_add_ps(detail::abs(x), detail::abs(y)), detail::abs(z));
+            __m128 inv = _mm_and_ps(_mm_div_ps(_mm_set1_ps(1.0f), s), _mm_cmpgt_ps(s, _mm_setzero_ps()));
+            __m128 px = _mm_mul_ps(x, inv);
+            __m128 py = _mm_mul_ps(y, inv);
+            __m128 folded = _mm_cmplt_ps(z, _mm_setzero_ps());
+            __m128 fx = detail::copysign(_mm_sub_ps(_mm_set1_ps(1.0f), detail::abs(py)), px);
+            __m128 fy = detail::copysign(_mm_sub_ps(_mm_set1_ps(1.0f), detail::abs(px)), py);
+            px = _mm_or_ps(_mm_and_ps(folded, fx), _mm_andnot_ps(folded, px));
+            py = _mm_or_ps(_mm_and_ps(folded, fy), _mm_andnot_ps(folded, py));
+            // snorm16_encode leaves 4 values in the low half, interleaving gives x0 y0 x1 y1 ...
+            __m128i ex = detail::snorm16_encode(px);
+            __m128i ey = detail::snorm16_encode(py);
+            _mm_storeu_si128((__m128i*)(out.data() + i), _mm_unpacklo_epi16(ex, ey));
+        }
+#endif
+        for (; i < in.size(); i++) {
+            out[i] = OctNormal(in[i]);
+        }
+    }
+
+    // out[i] = in[i].decode()
+    inline void decode(std::span<const OctNormal> in, std::span<Vec3<float>> out) {
+        detail::check(in.size(), out.size());
+        std::size_t i = 0;
+#if defined(EXTLIB_SSE2)
+        float* dst = &out.data()->x;
+        for (; i + 4 <= in.size(); i += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(in.data() + i));
+            // x sits in the low 16 bits of every 32 bit lane, y in the high ones
+            __m128 px = _mm_max_ps(_mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(v, 16), 16)), _mm_set1_ps(32767.0f)), _mm_set1_ps(-1.0f));
+            __m128 py = _mm_max_ps(_mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(v, 16)), _mm_set1_ps(32767.0f)), _mm_set1_ps(-1.0f));
+            __m128 pz = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.0f), detail::abs(px)), detail::abs(py));
+            __m128 t = _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), pz), _mm_setzero_ps());
+            px = _mm_sub_ps(px, detail::copysign(t, px));
+            py = _mm_sub_ps(py, detail::copysign(t, py));
+            __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, px), _mm_mul_ps(py, py)), _mm_mul_ps(pz, pz)));
+            __m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), length);
+            simd::interleave3(_mm_mul_ps(px, inv), _mm_mul_ps(py, inv), _mm_mul_ps(pz, inv), dst + i * 3);
+        }
+#endif
+        for (; i < in.size(); i++) {
+            out[i] = in[i].decode();
+        }
+    }
+}
+
+#endif
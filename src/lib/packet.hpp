@@ -0,0 +1,437 @@
+#ifndef PACKETHPP
+#define PACKETHPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+
+#include "geometry.hpp"
+#include "simd.hpp"
+#include "vector.hpp"
+
+// Ray packets, W rays stored as structure of arrays and intersected with one box or triangle at a time
+// Every lane runs the same instructions, so a packet costs about as much as a single scalar ray
+namespace packet {
+
+    // Rays per packet by default, one SIMD register of T
+    template<typename T>
+    constexpr std::size_t width = 4;
+
+#if defined(EXTLIB_AVX)
+    template<>
+    constexpr std::size_t width<float> = 8;
+#endif
+
+    namespace detail {
+        /**
+         * @brief W lanes of T with the handful of operations the intersection tests need
+         *
+         * The generic version loops over the lanes, specializations map to SSE and AVX registers.
+         * min and max return b when either operand is NaN, like minps and maxps.
+         */
+        template<typename T, std::size_t W>
+        struct wide {
+            std::array<T, W> v;
+
+            struct mask {
+                std::uint32_t bits;
+            };
+
+            static inline wide load(const T* p) {
+                wide out;
+                for (std::size_t i = 0; i < W; i++) {
+                    out.v[i] = p[i];
+                }
+                return out;
+            }
+
+            static inline wide set(T x) {
+                wide out;
+                out.v.fill(x);
+                return out;
+            }
+
+            inline void store(T* p) const {
+                for (std::size_t i = 0; i < W; i++) {
+                    p[i] = v[i];
+                }
+            }
+
+            template<typename F>
+            static inline wide map(const wide &a, const wide &b, F f) {
+                wide out;
+                for (std::size_t i = 0; i < W; i++) {
+                    out.v[i] = f(a.v[i], b.v[i]);
+                }
+                return out;
+            }
+
+            template<typename F>
+            static inline mask compare(const wide &a, const wide &b, F f) {
+                mask out = { 0 };
+                for (std::size_t i = 0; i < W; i++) {
+                    out.bits |= (std::uint32_t)f(a.v[i], b.v[i]) << i;
+                }
+                return out;
+            }
+
+            friend inline wide operator + (const wide &a, const wide &b) { return map(a, b, [](T x, T y) { return x + y; }); };
+            friend inline wide operator - (const wide &a, const wide &b) { return map(a, b, [](T x, T y) { return x - y; }); };
+            friend inline wide operator * (const wide &a, const wide &b) { return map(a, b, [](T x, T y) { return x * y; }); };
+            friend inline wide operator / (const wide &a, const wide &b) { return map(a, b, [](T x, T y) { return x / y; }); };
+            friend inline wide min(const wide &a, const wide &b) { return map(a, b, [](T x, T y) { return x < y ? x : y; }); };
+            friend inline wide max(const wide &a, const wide &b) { return map(a, b, [](T x, T y) { return x > y ? x : y; }); };
+            friend inline mask operator < (const wide &a, const wide &b) { return compare(a, b, [](T x, T y) { return x < y; }); };
+            friend inline mask operator <= (const wide &a, const wide &b) { return compare(a, b, [](T x, T y) { return x <= y; }); };
+            friend inline mask operator >= (const wide &a, const wide &b) { return compare(a, b, [](T x, T y) { return x >= y; }); };
+            friend inline mask operator != (const wide &a, const wide &b) { return compare(a, b, [](T x, T y) { return x != y; }); };
+            friend inline mask operator & (mask a, mask b) { return { a.bits & b.bits }; };
+            friend inline std::uint32_t bits(mask m) { return m.bits; };
+
+            // Returns a where m is set, b elsewhere
+            friend inline wide select(mask m, const wide &a, const wide &b) {
+                wide out;
+                for (std::size_t i = 0; i < W; i++) {
+                    out.v[i] = (m.bits >> i) & 1 ? a.v[i] : b.v[i];
+                }
+                return out;
+            }
+        };
+
+#if defined(EXTLIB_SSE)
+        template<>
+        struct wide<float, 4> {
+            __m128 v;
+
+            struct mask {
+                __m128 m;
+            };
+
+            static inline wide load(const float* p) { return { _mm_loadu_ps(p) }; };
+            static inline wide set(float x) { return { _mm_set1_ps(x) }; };
+            inline void store(float* p) const { _mm_storeu_ps(p, v); };
+
+            friend inline wide operator + (wide a, wide b) { return { _mm_add_ps(a.v, b.v) }; };
+            friend inline wide operator - (wide a, wide b) { return { _mm_sub_ps(a.v, b.v) }; };
+            friend inline wide operator * (wide a, wide b) { return { _mm_mul_ps(a.v, b.v) }; };
+            friend inline wide operator / (wide a, wide b) { return { _mm_div_ps(a.v, b.v) }; };
+            friend inline wide min(wide a, wide b) { return { _mm_min_ps(a.v, b.v) }; };
+            friend inline wide max(wide a, wide b) { return { _mm_max_ps(a.v, b.v) }; };
+            friend inline mask operator < (wide a, wide b) { return { _mm_cmplt_ps(a.v, b.v) }; };
+            friend inline mask operator <= (wide a, wide b) { return { _mm_cmple_ps(a.v, b.v) }; };
+            friend inline mask operator >= (wide a, wide b) { return { _mm_cmpge_ps(a.v, b.v) }; };
+            friend inline mask operator != (wide a, wide b) { return { _mm_cmpneq_ps(a.v, b.v) }; };
+            friend inline mask operator & (mask a, mask b) { return { _mm_and_ps(a.m, b.m) }; };
+            friend inline std::uint32_t bits(mask m) { return (std::uint32_t)_mm_movemask_ps(m.m); };
+            friend inline wide select(mask m, wide a, wide b) { return { _mm_or_ps(_mm_and_ps(m.m, a.v), _mm_andnot_ps(m.m, b.v)) }; };
+        };
+#endif
+
+#if defined(EXTLIB_SSE2)
+        template<>
+        struct wide<double, 2> {
+            __m128d v;
+
+            struct mask {
+                __m128d m;
+            };
+
+            static inline wide load(const double* p) { return { _mm_loadu_pd(p) }; };
+            static inline wide set(double x) { return { _mm_set1_pd(x) }; };
+            inline void store(double* p) const { _mm_storeu_pd(p, v); };
+
+            friend inline wide operator + (wide a, wide b) { return { _mm_add_pd(a.v, b.v) }; };
+            friend inline wide operator - (wide a, wide b) { return { _mm_sub_pd(a.v, b.v) }; };
+            friend inline wide operator * (wide a, wide b) { return { _mm_mul_pd(a.v, b.v) }; };
+            friend inline wide operator / (wide a, wide b) { return { _mm_div_pd(a.v, b.v) }; };
+            friend inline wide min(wide a, wide b) { return { _mm_min_pd(a.v, b.v) }; };
+            friend inline wide max(wide a, wide b) { return { _mm_max_pd(a.v, b.v) }; };
+            friend inline mask operator < (wide a, wide b) { return { _mm_cmplt_pd(a.v, b.v) }; };
+            friend inline mask operator <= (wide a, wide b) { return { _mm_cmple_pd(a.v, b.v) }; };
+            friend inline mask operator >= (wide a, wide b) { return { _mm_cmpge_pd(a.v, b.v) }; };
+            friend inline mask operator != (wide a, wide b) { return { _mm_cmpneq_pd(a.v, b.v) }; };
+            friend inline mask operator & (mask a, mask b) { return { _mm_and_pd(a.m, b.m) }; };
+            friend inline std::uint32_t bits(mask m) { return (std::uint32_t)_mm_movemask_pd(m.m); };
+            friend inline wide select(mask m, wide a, wide b) { return { _mm_or_pd(_mm_and_pd(m.m, a.v), _mm_andnot_pd(m.m, b.v)) }; };
+        };
+#endif
+
+#if defined(EXTLIB_AVX)
+        template<>
+        struct wide<float, 8> {
+            __m256 v;
+
+            struct mask {
+                __m256 m;
+            };
+
+            static inline wide load(const float* p) { return { _mm256_loadu_ps(p) }; };
+            static inline wide set(float x) { return { _mm256_set1_ps(x) }; };
+            inline void store(float* p) const { _mm256_storeu_ps(p, v); };
+
+            friend inline wide operator + (wide a, wide b) { return { _mm256_add_ps(a.v, b.v) }; };
+            friend inline wide operator - (wide a, wide b) { return { _mm256_sub_ps(a.v, b.v) }; };
+            friend inline wide operator * (wide a, wide b) { return { _mm256_mul_ps(a.v, b.v) }; };
+            friend inline wide operator / (wide a, wide b) { return { _mm256_div_ps(a.v, b.v) }; };
+            friend inline wide min(wide a, wide b) { return { _mm256_min_ps(a.v, b.v) }; };
+            friend inline wide max(wide a, wide b) { return { _mm256_max_ps(a.v, b.v) }; };
+            friend inline mask operator < (wide a, wide b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; };
+            friend inline mask operator <= (wide a, wide b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; };
+            friend inline mask operator >= (wide a, wide b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) }; };
+            friend inline mask operator != (wide a, wide b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_NEQ_UQ) }; };
+            friend inline mask operator & (mask a, mask b) { return { _mm256_and_ps(a.m, b.m) }; };
+            friend inline std::uint32_t bits(mask m) { return (std::uint32_t)_mm256_movemask_ps(m.m); };
+            friend inline wide select(mask m, wide a, wide b) { return { _mm256_blendv_ps(b.v, a.v, m.m) }; };
+        };
+
+        template<>
+        struct wide<double, 4> {
+            __m256d v;
+
+            struct mask {
+                __m256d m;
+            };
+
+            static inline wide load(const double* p) { return { _mm256_loadu_pd(p) }; };
+            static inline wide set(double x) { return { _mm256_set1_pd(x) }; };
+            inline void store(double* p) const { _mm256_storeu_pd(p, v); };
+
+            friend inline wide operator + (wide a, wide b) { return { _mm256_add_pd(a.v, b.v) }; };
+            friend inline wide operator - (wide a, wide b) { return { _mm256_sub_pd(a.v, b.v) }; };
+            friend inline wide operator * (wide a, wide b) { return { _mm256_mul_pd(a.v, b.v) }; };
+            friend inline wide operator / (wide a, wide b) { return { _mm256_div_pd(a.v, b.v) }; };
+            friend inline wide min(wide a, wide b) { return { _mm256_min_pd(a.v, b.v) }; };
+            friend inline wide max(wide a, wide b) { return { _mm256_max_pd(a.v, b.v) }; };
+            friend inline mask operator < (wide a, wide b) { return { _mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ) }; };
+            friend inline mask operator <= (wide a, wide b) { return { _mm256_cmp_pd(a.v, b.v, _CMP_LE_OQ) }; };
+            friend inline mask operator >= (wide a, wide b) { return { _mm256_cmp_pd(a.v, b.v, _CMP_GE_OQ) }; };
+            friend inline mask operator != (wide a, wide b) { return { _mm256_cmp_pd(a.v, b.v, _CMP_NEQ_UQ) }; };
+            friend inline mask operator & (mask a, mask b) { return { _mm256_and_pd(a.m, b.m) }; };
+            friend inline std::uint32_t bits(mask m) { return (std::uint32_t)_mm256_movemask_pd(m.m); };
+            friend inline wide select(mask m, wide a, wide b) { return { _mm256_blendv_pd(b.v, a.v, m.m) }; };
+        };
+#endif
+    }
+}
+
+/**
+ * @brief W rays as structure of arrays, lanes without a ray are inactive and never hit
+ *
+ * @tparam T Type of the coordinates
+ * @tparam W Number of rays
+ */
+template<typename T, std::size_t W = packet::width<T>>
+struct RayPacket {
+    static_assert(W > 0 && W <= 32, "A packet holds 1 to 32 rays");
+
+    static constexpr std::size_t width = W;
+
+    alignas(64) T origin[3][W];
+    alignas(64) T direction[3][W];
+    alignas(64) T inv_direction[3][W];
+    alignas(64) T tmin[W];
+    alignas(64) T tmax[W];
+
+    inline RayPacket() {
+        for (std::size_t i = 0; i < W; i++) {
+            clear(i);
+        }
+    }
+
+    // Takes up to W rays, the remaining lanes are inactive
+    inline explicit RayPacket(std::span<const Ray<T>> rays) : RayPacket() {
+        if (rays.size() > W) {
+            throw std::invalid_argument("Too many rays for the packet");
+        }
+        for (std::size_t i = 0; i < rays.size(); i++) {
+            set(i, rays[i]);
+        }
+    }
+
+    inline void set(std::size_t lane, const Ray<T> &ray) {
+        for (std::size_t k = 0; k < 3; k++) {
+            origin[k][lane] = ray.origin.get(k);
+            direction[k][lane] = ray.direction.get(k);
+            inv_direction[k][lane] = ray.inv_direction.get(k);
+        }
+        tmin[lane] = ray.tmin;
+        tmax[lane] = ray.tmax;
+    }
+
+    inline Ray<T> get(std::size_t lane) const {
+        Ray<T> out(Vec3<T>(origin[0][lane], origin[1][lane], origin[2][lane]), Vec3<T>(direction[0][lane], direction[1][lane], direction[2][lane]), tmin[lane], tmax[lane]);
+        return out;
+    }
+
+    // Deactivates a lane, its empty interval fails every test
+    inline void clear(std::size_t lane) {
+        for (std::size_t k = 0; k < 3; k++) {
+            origin[k][lane] = (T)0;
+            direction[k][lane] = (T)0;
+            inv_direction[k][lane] = (T)0;
+        }
+        tmin[lane] = std::numeric_limits<T>::infinity();
+        tmax[lane] = -std::numeric_limits<T>::infinity();
+    }
+
+    // Returns a bit per lane whose interval is not empty
+    inline std::uint32_t active() const {
+        std::uint32_t out = 0;
+        for (std::size_t i = 0; i < W; i++) {
+            out |= (std::uint32_t)(tmin[i] <= tmax[i]) << i;
+        }
+        return out;
+    }
+};
+
+/**
+ * @brief Closest hits of a ray packet, lanes that hit nothing keep an invalid index and an infinite t
+ *
+ * @tparam T Type of the coordinates
+ * @tparam W Number of rays
+ */
+template<typename T, std::size_t W = packet::width<T>>
+struct PacketHit {
+    alignas(64) T t[W];
+    alignas(64) T u[W];
+    alignas(64) T v[W];
+    std::uint32_t index[W];
+
+    inline PacketHit() {
+        for (std::size_t i = 0; i < W; i++) {
+            t[i] = std::numeric_limits<T>::infinity();
+            u[i] = (T)0;
+            v[i] = (T)0;
+            index[i] = std::numeric_limits<std::uint32_t>::max();
+        }
+    }
+
+    inline bool valid(std::size_t lane) const { return index[lane] != std::numeric_limits<std::uint32_t>::max(); };
+};
+
+using raypacketf = RayPacket<float>;
+using raypacketd = RayPacket<double>;
+
+namespace geometry {
+
+    namespace detail {
+        template<typename T, std::size_t W>
+        using wide = packet::detail::wide<T, W>;
+
+        // Moller-Trumbore for every lane against one triangle, returns the hit mask and t, u, v
+        template<typename T, std::size_t W>
+        inline typename wide<T, W>::mask triangle(const RayPacket<T, W> &rays, const Triangle<T> &tri, wide<T, W> &t, wide<T, W> &u, wide<T, W> &v) {
+            using V = wide<T, W>;
+            const Vec3<T> e1s = tri.v1 - tri.v0;
+            const Vec3<T> e2s = tri.v2 - tri.v0;
+            const V e1x = V::set(e1s.x), e1y = V::set(e1s.y), e1z = V::set(e1s.z);
+            const V e2x = V::set(e2s.x), e2y = V::set(e2s.y), e2z = V::set(e2s.z);
+            const V dx = V::load(rays.direction[0]), dy = V::load(rays.direction[1]), dz = V::load(rays.direction[2]);
+
+            // p = d x e2
+            V px = dy * e2z - dz * e2y;
+            V py = dz * e2x - dx * e2z;
+            V pz = dx * e2y - dy * e2x;
+            V det = e1x * px + e1y * py + e1z * pz;
+            V inv = V::set((T)1) / det;
+
+            V sx = V::load(rays.origin[0]) - V::set(tri.v0.x);
+            V sy = V::load(rays.origin[1]) - V::set(tri.v0.y);
+            V sz = V::load(rays.origin[2]) - V::set(tri.v0.z);
+            u = (sx * px + sy * py + sz * pz) * inv;
+
+            // q = s x e1
+            V qx = sy * e1z - sz * e1y;
+            V qy = sz * e1x - sx * e1z;
+            V qz = sx * e1y - sy * e1x;
+            v = (dx * qx + dy * qy + dz * qz) * inv;
+            t = (e2x * qx + e2y * qy + e2z * qz) * inv;
+
+            const V zero = V::set((T)0);
+            const V one = V::set((T)1);
+            return (det != zero) & (u >= zero) & (u <= one) & (v >= zero) & ((u + v) <= one)
+                & (t >= V::load(rays.tmin)) & (t <= V::load(rays.tmax));
+        }
+    }
+
+    // Slab test for every lane, returns a bit per lane that hits the box within its [tmin, tmax] and stores the entry distances in t
+    template<typename T, std::size_t W>
+    inline std::uint32_t intersect(const RayPacket<T, W> &rays, const AABB<T> &box, std::array<T, W> &t) {
+        using V = detail::wide<T, W>;
+        V t0 = V::load(rays.tmin);
+        V t1 = V::load(rays.tmax);
+        for (std::size_t k = 0; k < 3; k++) {
+            V o = V::load(rays.origin[k]);
+            V inv = V::load(rays.inv_direction[k]);
+            V t_near = (V::set(box.min.get(k)) - o) * inv;
+            V t_far = (V::set(box.max.get(k)) - o) * inv;
+            // Operands ordered so a NaN from 0 * inf keeps the previous bound, like the scalar test
+            t0 = max(min(t_far, t_near), t0);
+            t1 = min(max(t_near, t_far), t1);
+        }
+        t0.store(t.data());
+        return bits(t0 <= t1);
+    }
+
+    // Moller-Trumbore for every lane, returns a bit per lane that hits the triangle within its [tmin, tmax]
+    // Stores the distances in t and the barycentric coordinates in u and v, lanes that miss hold garbage
+    template<typename T, std::size_t W>
+    inline std::uint32_t intersect(const RayPacket<T, W> &rays, const Triangle<T> &tri, std::array<T, W> &t, std::array<T, W> &u, std::array<T, W> &v) {
+        detail::wide<T, W> wt, wu, wv;
+        std::uint32_t hit = bits(detail::triangle(rays, tri, wt, wu, wv));
+        wt.store(t.data());
+        wu.store(u.data());
+        wv.store(v.data());
+        return hit;
+    }
+
+    // Finds the closest triangle for every lane, shrinking rays.tmax to every hit so later triangles are culled
+    // Returns a bit per lane that hit anything, hit.index is the index into tris
+    template<typename T, std::size_t W>
+    inline std::uint32_t closest(RayPacket<T, W> &rays, std::span<const Triangle<T>> tris, PacketHit<T, W> &hit) {
+        using V = detail::wide<T, W>;
+        std::uint32_t any = 0;
+        V best_t = V::load(hit.t);
+        V best_u = V::load(hit.u);
+        V best_v = V::load(hit.v);
+        for (std::size_t i = 0; i < tris.size(); i++) {
+            V t, u, v;
+            auto mask = detail::triangle(rays, tris[i], t, u, v);
+            std::uint32_t lanes = bits(mask);
+            if (lanes == 0) {
+                continue;
+            }
+            any |= lanes;
+            best_t = select(mask, t, best_t);
+            best_u = select(mask, u, best_u);
+            best_v = select(mask, v, best_v);
+            select(mask, t, V::load(rays.tmax)).store(rays.tmax);
+            for (std::size_t lane = 0; lane < W; lane++) {
+                if ((lanes >> lane) & 1) {
+                    hit.index[lane] = (std::uint32_t)i;
+                }
+            }
+        }
+        best_t.store(hit.t);
+        best_u.store(hit.u);
+        best_v.store(hit.v);
+        return any;
+    }
+
+    // Returns a bit per active lane blocked by any triangle, for shadow rays, stops once every lane is blocked
+    template<typename T, std::size_t W>
+    inline std::uint32_t occluded(const RayPacket<T, W> &rays, std::span<const Triangle<T>> tris) {
+        const std::uint32_t active = rays.active();
+        std::uint32_t out = 0;
+        for (std::size_t i = 0; i < tris.size() && out != active; i++) {
+            detail::wide<T, W> t, u, v;
+            out |= bits(detail::triangle(rays, tris[i], t, u, v));
+        }
+        return out;
+    }
+}
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef PAIRWISEHPP
+#define PAIRWISEHPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "parallel.hpp"
+#include "simd.hpp"
+#include "spatial.hpp"
+#include "vector.hpp"
+#include "vectorarray.hpp"
+
+// All pairs squared distances between two point sets, |a - b|^2 = |a|^2 + |b|^2 - 2 a.b
+//
+// The columns are processed in blocks of b that stay in L1 while a block of rows streams past them, every row of a
+// block is a fixed length loop over the lanes of b the compiler vectorizes. The expansion cancels for points that are
+// close compared to their distance from the origin, results are clamped to 0 and lose absolute precision around
+// (|a|^2 + |b|^2) * epsilon, center the points first when that matters.
+namespace pairwise {
+
+    namespace detail {
+        // Columns per block, a multiple of every SIMD width
+        constexpr std::size_t block_cols = 256;
+        // Rows per block, their lanes stay in L2 while every column block passes
+        constexpr std::size_t block_rows = 1024;
+
+        // The lanes of b padded to a multiple of block_cols, with their squared lengths
+        template<typename T, std::size_t N>
+        struct Packed {
+            std::array<soa::lane<T>, N> lanes;
+            soa::lane<T> norms;
+            std::size_t size = 0;
+        };
+
+        template<typename T, std::size_t N>
+        inline Packed<T, N> pack(const VecArray<T, N> &b) {
+            Packed<T, N> out;
+            out.size = b.size();
+            const std::size_t padded = (b.size() + block_cols - 1) / block_cols * block_cols;
+            for (std::size_t k = 0; k < N; k++) {
+                out.lanes[k].assign(padded, T());
+                std::copy(b.lane(k), b.lane(k) + b.size(), out.lanes[k].begin());
+            }
+            out.norms.assign(padded, T());
+            soa::length_squared(b, std::span<T>(out.norms.data(), b.size()));
+            return out;
+        }
+
+        // out[j] = max(norm + b.norms[j] - 2 a.b[j], 0) for the block_cols columns starting at col
+        template<typename T, std::size_t N>
+        inline void row(const Vec<T, N> &a, T norm, const Packed<T, N> &b, std::size_t col, T* EXTLIB_RESTRICT out) {
+            // -2a is folded into the broadcast factors
+            const Vec<T, N> c = a * (T)-2;
+            const T* EXTLIB_RESTRICT nb = b.norms.data() + col;
+            std::array<const T*, N> lanes;
+            for (std::size_t k = 0; k < N; k++) {
+                lanes[k] = b.lanes[k].data() + col;
+            }
+            for (std::size_t j = 0; j < block_cols; j++) {
+                T d = norm + nb[j];
+                Vec<T, N>::template unroll<0, N>([&](std::size_t k) { d += c.get(k) * lanes[k][j]; });
+                out[j] = d < T() ? T() : d;
+            }
+        }
+
+        // Calls f(begin, end) for ranges of rows, split across threads so every thread gets about the same number of pairs
+        template<typename F>
+        inline void for_rows(std::size_t rows, std::size_t cols, F &&f, std::size_t threads) {
+            if (rows == 0 || cols == 0) {
+                return;
+            }
+            // Row r belongs to the chunk that holds pair r * cols
+            parallel::for_chunks(rows * cols, [&](std::size_t begin, std::size_t end, std::size_t) {
+                std::size_t first = (begin + cols - 1) / cols;
+                std::size_t last = std::min(rows, (end + cols - 1) / cols);
+                for (std::size_t r = first; r < last; r += block_rows) {
+                    f(r, std::min(last, r + block_rows));
+                }
+            }, threads);
+        }
+
+        inline void check_pairs(std::size_t rows, std::size_t cols) {
+            if (rows > 0 && cols > std::numeric_limits<std::size_t>::max() / rows) {
+                throw std::invalid_argument("Too many pairs");
+            }
+        }
+    }
+
+    // out[i * b.size() + j] = squared distance between a[i] and b[j]
+    template<typename T, std::size_t N>
+    inline void distances_squared(const VecArray<T, N> &a, const VecArray<T, N> &b, std::span<T> out, std::size_t threads = 0) {
+        const std::size_t rows = a.size();
+        const std::size_t cols = b.size();
+        detail::check_pairs(rows, cols);
+        if (out.size() < rows * cols) {
+            throw std::invalid_argument("Output span too small");
+        }
+        const detail::Packed<T, N> packed = detail::pack(b);
+        soa::lane<T> norms(rows);
+        soa::length_squared(a, std::span<T>(norms));
+        detail::for_rows(rows, cols, [&](std::size_t begin, std::size_t end) {
+            alignas(64) T scratch[detail::block_cols];
+            for (std::size_t col = 0; col < cols; col += detail::block_cols) {
+                const std::size_t width = std::min(detail::block_cols, cols - col);
+                for (std::size_t i = begin; i < end; i++) {
+                    T* dst = out.data() + i * cols + col;
+                    // The last block is computed in full and copied, the padding columns would run past the row
+                    if (width == detail::block_cols) {
+                        detail::row(a.get(i), norms[i], packed, col, dst);
+                    } else {
+                        detail::row(a.get(i), norms[i], packed, col, scratch);
+                        std::copy(scratch, scratch + width, dst);
+                    }
+                }
+            }
+        }, threads);
+    }
+
+    template<typename T, std::size_t N>
+    inline void distances_squared(std::span<const Vec<T, N>> a, std::span<const Vec<T, N>> b, std::span<T> out, std::size_t threads = 0) {
+        distances_squared(VecArray<T, N>(a), VecArray<T, N>(b), out, threads);
+    }
+
+    // Returns the a.size() * b.size() squared distances, row major
+    template<typename T, std::size_t N>
+    inline std::vector<T> distances_squared(const VecArray<T, N> &a, const VecArray<T, N> &b, std::size_t threads = 0) {
+        detail::check_pairs(a.size(), b.size());
+        std::vector<T> out(a.size() * b.size());
+        distances_squared(a, b, std::span<T>(out), threads);
+        return out;
+    }
+
+    // out[i * k .. i * k + k) = the k points of b nearest to a[i], sorted by distance
+    // The distances are filtered as every block is computed, the full matrix is never stored
+    // Rows get padded with an invalid index and an infinite distance when b has fewer than k points
+    template<typename T, std::size_t N>
+    inline void nearest(const VecArray<T, N> &a, const VecArray<T, N> &b, std::size_t k, std::span<spatial::Neighbor<T>> out, std::size_t threads = 0) {
+        const std::size_t rows = a.size();
+        const std::size_t cols = b.size();
+        detail::check_pairs(rows, k);
+        if (cols > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::invalid_argument("Too many points");
+        }
+        if (out.size() < rows * k) {
+            throw std::invalid_argument("Output span too small");
+        }
+        if (k == 0) {
+            return;
+        }
+        const detail::Packed<T, N> packed = detail::pack(b);
+        soa::lane<T> norms(rows);
+        soa::length_squared(a, std::span<T>(norms));
+        const spatial::Neighbor<T> none = { std::numeric_limits<std::uint32_t>::max(), std::numeric_limits<T>::infinity() };
+        auto run = [&](std::size_t begin, std::size_t end) {
+            alignas(64) T scratch[detail::block_cols];
+            // Every row of the block keeps a max heap in its slice of out
+            std::vector<std::size_t> filled(end - begin, 0);
+            std::vector<T> worst(end - begin, std::numeric_limits<T>::infinity());
+            for (std::size_t col = 0; col < cols; col += detail::block_cols) {
+                const std::size_t width = std::min(detail::block_cols, cols - col);
+                for (std::size_t i = begin; i < end; i++) {
+                    detail::row(a.get(i), norms[i], packed, col, scratch);
+                    spatial::Neighbor<T>* heap = out.data() + i * k;
+                    std::size_t &n = filled[i - begin];
+                    T &limit = worst[i - begin];
+                    std::size_t j = 0;
+                    for (; j < width && n < k; j++) {
+                        heap[n++] = { (std::uint32_t)(col + j), scratch[j] };
+                        std::push_heap(heap, heap + n);
+                        if (n == k) {
+                            limit = heap[0].distance_squared;
+                        }
+                    }
+                    // Once the heap is full almost every column fails this test
+                    for (; j < width; j++) {
+                        if (scratch[j] < limit) {
+                            std::pop_heap(heap, heap + k);
+                            heap[k - 1] = { (std::uint32_t)(col + j), scratch[j] };
+                            std::push_heap(heap, heap + k);
+                            limit = heap[0].distance_squared;
+                        }
+                    }
+                }
+            }
+            for (std::size_t i = begin; i < end; i++) {
+                spatial::Neighbor<T>* heap = out.data() + i * k;
+                std::size_t n = filled[i - begin];
+                std::sort_heap(heap, heap + n);
+                std::fill(heap + n, heap + k, none);
+            }
+        };
+        if (cols == 0) {
+            std::fill(out.begin(), out.begin() + rows * k, none);
+            return;
+        }
+        detail::for_rows(rows, cols, run, threads);
+    }
+
+    template<typename T, std::size_t N>
+    inline void nearest(std::span<const Vec<T, N>> a, std::span<const Vec<T, N>> b, std::size_t k, std::span<spatial::Neighbor<T>> out, std::size_t threads = 0) {
+        nearest(VecArray<T, N>(a), VecArray<T, N>(b), k, out, threads);
+    }
+}
+
+#endif
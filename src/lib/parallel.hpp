@@ -0,0 +1,349 @@
+#ifndef PARALLELHPP
+#define PARALLELHPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <exception>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "matrix.hpp"
+#include "vector.hpp"
+
+// Parallel algorithms, work is split into one contiguous chunk per thread and every chunk keeps its own partial result
+namespace parallel {
+
+    namespace detail {
+        inline std::atomic<std::size_t>& configured_threads() {
+            static std::atomic<std::size_t> threads{ 0 };
+            return threads;
+        }
+    }
+
+    // Smallest number of elements worth handing to a thread
+    constexpr std::size_t grain = 16384;
+
+    // Sets the number of threads used by default, 0 uses every hardware thread
+    inline void set_threads(std::size_t threads) {
+        detail::configured_threads().store(threads);
+    }
+
+    // Returns the number of threads used by default
+    inline std::size_t threads() {
+        std::size_t threads = detail::configured_threads().load();
+        if (threads == 0) {
+            threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+        }
+        return threads;
+    }
+
+    // Returns the number of chunks n elements are split into
+    inline std::size_t chunks(std::size_t n, std::size_t threads = 0) {
+        if (threads == 0) {
+            threads = parallel::threads();
+        }
+        std::size_t by_size = (n + grain - 1) / grain;
+        return std::max<std::size_t>(1, std::min(threads, by_size));
+    }
+
+    // Calls f(begin, end, chunk) for every chunk of [0, n), the last chunk runs on the calling thread
+    template<typename F>
+    inline void for_chunks(std::size_t n, F &&f, std::size_t threads = 0) {
+        if (n == 0) {
+            return;
+        }
+        const std::size_t count = chunks(n, threads);
+        if (count == 1) {
+            f((std::size_t)0, n, (std::size_t)0);
+            return;
+        }
+        std::vector<std::thread> workers;
+        std::vector<std::exception_ptr> errors(count);
+        workers.reserve(count - 1);
+        auto run = [&](std::size_t chunk) {
+            std::size_t begin = n * chunk / count;
+            std::size_t end = n * (chunk + 1) / count;
+            try {
+                f(begin, end, chunk);
+            } catch (...) {
+                errors[chunk] = std::current_exception();
+            }
+        };
+        for (std::size_t chunk = 0; chunk + 1 < count; chunk++) {
+            workers.emplace_back(run, chunk);
+        }
+        run(count - 1);
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+        for (std::exception_ptr &error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+
+    // Calls f(element) for every element
+    template<typename T, typename F>
+    inline void for_each(std::span<T> data, F &&f, std::size_t threads = 0) {
+        for_chunks(data.size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t i = begin; i < end; i++) {
+                f(data[i]);
+            }
+        }, threads);
+    }
+
+    // out[i] = f(in[i]), out may be in
+    template<typename In, typename Out, typename F>
+    inline void transform(std::span<const In> in, std::span<Out> out, F &&f, std::size_t threads = 0) {
+        if (out.size() < in.size()) {
+            throw std::invalid_argument("Output span too small");
+        }
+        for_chunks(in.size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t i = begin; i < end; i++) {
+                out[i] = f(in[i]);
+            }
+        }, threads);
+    }
+
+    // Folds map(element) with reduce, reduce has to be associative, partial results are combined in order
+    template<typename T, typename R, typename Reduce, typename Map>
+    inline R transform_reduce(std::span<const T> data, R init, Reduce &&reduce, Map &&map, std::size_t threads = 0) {
+        const std::size_t count = chunks(data.size(), threads);
+        std::vector<R> partials(count, init);
+        std::vector<char> used(count, 0);
+        for_chunks(data.size(), [&](std::size_t begin, std::size_t end, std::size_t chunk) {
+            R acc = map(data[begin]);
+            for (std::size_t i = begin + 1; i < end; i++) {
+                acc = reduce(acc, map(data[i]));
+            }
+            partials[chunk] = acc;
+            used[chunk] = 1;
+        }, count);
+        R out = init;
+        for (std::size_t i = 0; i < count; i++) {
+            if (used[i]) {
+                out = reduce(out, partials[i]);
+            }
+        }
+        return out;
+    }
+
+    // Folds every element with reduce, reduce has to be associative
+    template<typename T, typename R, typename Reduce>
+    inline R reduce(std::span<const T> data, R init, Reduce &&reduce, std::size_t threads = 0) {
+        return transform_reduce(data, init, reduce, [](const T &v) -> R { return v; }, threads);
+    }
+
+    // Sum of every element
+    template<typename T>
+    inline T sum(std::span<const T> data, std::size_t threads = 0) {
+        return reduce(data, T(), [](const T &a, const T &b) { return a + b; }, threads);
+    }
+
+    /**
+     * @brief Component wise minimum and maximum of a set of vectors
+     *
+     * @tparam T Type of the components
+     * @tparam N Number of components
+     */
+    template<typename T, std::size_t N>
+    struct Bounds {
+        Vec<T, N> min;
+        Vec<T, N> max;
+    };
+
+    namespace detail {
+        template<typename T, std::size_t N, typename Op>
+        constexpr Vec<T, N> componentwise(const Vec<T, N> &a, const Vec<T, N> &b, Op op) {
+            Vec<T, N> out;
+            for (std::size_t i = 0; i < N; i++) {
+                out.get(i) = op(a.get(i), b.get(i));
+            }
+            return out;
+        }
+    }
+
+    // Component wise minimum, data must not be empty
+    template<typename T, std::size_t N>
+    inline Vec<T, N> min(std::span<const Vec<T, N>> data, std::size_t threads = 0) {
+        if (data.empty()) {
+            throw std::invalid_argument("Empty input");
+        }
+        return reduce(data, data[0], [](const Vec<T, N> &a, const Vec<T, N> &b) {
+            return detail::componentwise(a, b, [](T x, T y) { return y < x ? y : x; });
+        }, threads);
+    }
+
+    // Component wise maximum, data must not be empty
+    template<typename T, std::size_t N>
+    inline Vec<T, N> max(std::span<const Vec<T, N>> data, std::size_t threads = 0) {
+        if (data.empty()) {
+            throw std::invalid_argument("Empty input");
+        }
+        return reduce(data, data[0], [](const Vec<T, N> &a, const Vec<T, N> &b) {
+            return detail::componentwise(a, b, [](T x, T y) { return y > x ? y : x; });
+        }, threads);
+    }
+
+    // Component wise minimum and maximum in a single pass, data must not be empty
+    template<typename T, std::size_t N>
+    inline Bounds<T, N> bounds(std::span<const Vec<T, N>> data, std::size_t threads = 0) {
+        if (data.empty()) {
+            throw std::invalid_argument("Empty input");
+        }
+        Bounds<T, N> init{ data[0], data[0] };
+        return transform_reduce(data, init, [](const Bounds<T, N> &a, const Bounds<T, N> &b) {
+            return Bounds<T, N>{
+                detail::componentwise(a.min, b.min, [](T x, T y) { return y < x ? y : x; }),
+                detail::componentwise(a.max, b.max, [](T x, T y) { return y > x ? y : x; })
+            };
+        }, [](const Vec<T, N> &v) { return Bounds<T, N>{ v, v }; }, threads);
+    }
+
+    // Mean of every vector, data must not be empty
+    template<typename T, std::size_t N>
+    inline Vec<T, N> centroid(std::span<const Vec<T, N>> data, std::size_t threads = 0) {
+        if (data.empty()) {
+            throw std::invalid_argument("Empty input");
+        }
+        return sum(data, threads) / (T)data.size();
+    }
+
+    // Population covariance matrix of the vectors, data must not be empty
+    template<typename T, std::size_t N>
+    inline Mat<T, N> covariance(std::span<const Vec<T, N>> data, std::size_t threads = 0) {
+        Vec<T, N> mean = centroid(data, threads);
+        const std::size_t count = chunks(data.size(), threads);
+        std::vector<Mat<T, N>> partials(count);
+        for_chunks(data.size(), [&](std::size_t begin, std::size_t end, std::size_t chunk) {
+            Mat<T, N> acc;
+            for (std::size_t i = begin; i < end; i++) {
+                Vec<T, N> d = data[i] - mean;
+                // Outer product d * d^T, column c is d scaled by d[c]
+                for (std::size_t c = 0; c < N; c++) {
+                    acc.columns[c] += d * d.get(c);
+                }
+            }
+            partials[chunk] = acc;
+        }, count);
+        Mat<T, N> out;
+        for (const Mat<T, N> &partial : partials) {
+            out = out + partial;
+        }
+        return out * ((T)1 / (T)data.size());
+    }
+
+    // out[i] = in[indices[i]], every index must be smaller than in.size()
+    template<typename T, typename I>
+    inline void gather(std::span<const T> in, std::span<const I> indices, std::span<T> out, std::size_t threads = 0) {
+        if (out.size() < indices.size()) {
+            throw std::invalid_argument("Output span too small");
+        }
+        for_chunks(indices.size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t i = begin; i < end; i++) {
+                out[i] = in[(std::size_t)indices[i]];
+            }
+        }, threads);
+    }
+
+    // Stable LSD radix sort of keys, values[i] moves along with keys[i]
+    // Every pass sorts 8 bits, passes above the highest set bit and passes where all keys share the digit are skipped
+    template<typename K, typename V>
+    inline void radix_sort(std::span<K> keys, std::span<V> values, std::size_t threads = 0) {
+        static_assert(std::is_unsigned_v<K>, "Keys must be unsigned integers");
+        if (keys.size() != values.size()) {
+            throw std::invalid_argument("Array sizes do not match");
+        }
+        const std::size_t n = keys.size();
+        if (n < 2) {
+            return;
+        }
+        constexpr std::size_t radix = 256;
+        constexpr std::size_t line = 64 / sizeof(K);
+        const std::size_t count = chunks(n, threads);
+        const K high = reduce(std::span<const K>(keys), (K)0, [](K a, K b) { return (K)(a | b); }, count);
+        const std::size_t bits = (std::size_t)std::bit_width(high);
+
+        std::vector<K> key_buffer(n);
+        std::vector<V> value_buffer(n);
+        std::span<K> src_keys = keys;
+        std::span<V> src_values = values;
+        std::span<K> dst_keys(key_buffer);
+        std::span<V> dst_values(value_buffer);
+        // One histogram per chunk, turned into the chunk's output position for every digit
+        std::vector<std::array<std::size_t, radix>> offsets(count);
+
+        for (std::size_t shift = 0; shift < bits; shift += 8) {
+            for_chunks(n, [&](std::size_t begin, std::size_t end, std::size_t chunk) {
+                // Local copies, keys of type size_t could otherwise alias the counters
+                const K* in = src_keys.data();
+                std::size_t histogram[radix] = {};
+                for (std::size_t i = begin; i < end; i++) {
+                    histogram[(in[i] >> shift) & (radix - 1)]++;
+                }
+                std::copy(histogram, histogram + radix, offsets[chunk].begin());
+            }, count);
+            // Digits in order and chunks in order within a digit keeps the sort stable
+            std::size_t position = 0;
+            bool skip = false;
+            for (std::size_t digit = 0; digit < radix; digit++) {
+                std::size_t start = position;
+                for (std::size_t chunk = 0; chunk < count; chunk++) {
+                    std::size_t size = offsets[chunk][digit];
+                    offsets[chunk][digit] = position;
+                    position += size;
+                }
+                skip = skip || position - start == n;
+            }
+            if (skip) {
+                continue;
+            }
+            for_chunks(n, [&](std::size_t begin, std::size_t end, std::size_t chunk) {
+                const K* in_keys = src_keys.data();
+                V* in_values = src_values.data();
+                K* out_keys = dst_keys.data();
+                V* out_values = dst_values.data();
+                std::size_t offset[radix];
+                std::copy(offsets[chunk].begin(), offsets[chunk].end(), offset);
+                // Every digit collects a cache line of keys before writing them out, the scattered stores would
+                // otherwise touch a different page each
+                std::vector<K> key_lines(radix * line);
+                std::vector<V> value_lines(radix * line);
+                K* keys_line = key_lines.data();
+                V* values_line = value_lines.data();
+                std::size_t fill[radix] = {};
+                for (std::size_t i = begin; i < end; i++) {
+                    const std::size_t digit = (in_keys[i] >> shift) & (radix - 1);
+                    const std::size_t at = digit * line + fill[digit]++;
+                    keys_line[at] = in_keys[i];
+                    values_line[at] = std::move(in_values[i]);
+                    if (fill[digit] == line) {
+                        std::copy(keys_line + digit * line, keys_line + at + 1, out_keys + offset[digit]);
+                        std::move(values_line + digit * line, values_line + at + 1, out_values + offset[digit]);
+                        offset[digit] += line;
+                        fill[digit] = 0;
+                    }
+                }
+                for (std::size_t digit = 0; digit < radix; digit++) {
+                    std::copy(keys_line + digit * line, keys_line + digit * line + fill[digit], out_keys + offset[digit]);
+                    std::move(values_line + digit * line, values_line + digit * line + fill[digit], out_values + offset[digit]);
+                }
+            }, count);
+            std::swap(src_keys, dst_keys);
+            std::swap(src_values, dst_values);
+        }
+        if (src_keys.data() != keys.data()) {
+            std::copy(src_keys.begin(), src_keys.end(), keys.begin());
+            std::move(src_values.begin(), src_values.end(), values.begin());
+        }
+    }
+}
+
+#endif
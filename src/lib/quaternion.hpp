@@ -0,0 +1,411 @@
+#ifndef QUATERNIONHPP
+#define QUATERNIONHPP
+
+#include <cstddef>
+#include <iosfwd>
+#include <span>
+#include <stdexcept>
+
+#include "fastmath.hpp"
+#include "matrix.hpp"
+#include "simd.hpp"
+#include "vector.hpp"
+#include "vectorarray.hpp"
+
+/**
+ * @brief A quaternion, xyz is the vector part and w the scalar part
+ *
+ * @tparam T Type of the quaternion
+ */
+template<typename T>
+struct alignas(simd::vec4_alignment<T>) Quat {
+    T x{};
+    T y{};
+    T z{};
+    T w{};
+
+    // Identity rotation
+    constexpr Quat() : w((T)1) {}
+
+    constexpr Quat(T x, T y, T z, T w) : x(x), y(y), z(z), w(w) {}
+
+    constexpr Quat(const Vec3<T> &vector, T scalar) : x(vector.x), y(vector.y), z(vector.z), w(scalar) {}
+
+    // Reinterprets the components of a Vec4
+    constexpr explicit Quat(const Vec4<T> &vec) : x(vec.x), y(vec.y), z(vec.z), w(vec.w) {}
+
+    static constexpr Quat<T> identity() {
+        return Quat<T>();
+    }
+
+    // Rotation of angle radians around a unit axis
+    static inline Quat<T> from_axis_angle(const Vec3<T> &axis, T angle) {
+        T half = angle / (T)2;
+        T s = std::sin(half);
+        return Quat<T>(axis.x * s, axis.y * s, axis.z * s, std::cos(half));
+    }
+
+    // Rotation from a proper rotation matrix
+    static inline Quat<T> from_mat3(const Mat3<T> &m) {
+        T trace = m(0, 0) + m(1, 1) + m(2, 2);
+        Quat<T> q;
+        if (trace > (T)0) {
+            T s = std::sqrt(trace + (T)1) * (T)2;
+            q = Quat<T>((m(2, 1) - m(1, 2)) / s, (m(0, 2) - m(2, 0)) / s, (m(1, 0) - m(0, 1)) / s, s / (T)4);
+        } else if (m(0, 0) > m(1, 1) && m(0, 0) > m(2, 2)) {
+            T s = std::sqrt((T)1 + m(0, 0) - m(1, 1) - m(2, 2)) * (T)2;
+            q = Quat<T>(s / (T)4, (m(0, 1) + m(1, 0)) / s, (m(0, 2) + m(2, 0)) / s, (m(2, 1) - m(1, 2)) / s);
+        } else if (m(1, 1) > m(2, 2)) {
+            T s = std::sqrt((T)1 + m(1, 1) - m(0, 0) - m(2, 2)) * (T)2;
+            q = Quat<T>((m(0, 1) + m(1, 0)) / s, s / (T)4, (m(1, 2) + m(2, 1)) / s, (m(0, 2) - m(2, 0)) / s);
+        } else {
+            T s = std::sqrt((T)1 + m(2, 2) - m(0, 0) - m(1, 1)) * (T)2;
+            q = Quat<T>((m(0, 2) + m(2, 0)) / s, (m(1, 2) + m(2, 1)) / s, s / (T)4, (m(1, 0) - m(0, 1)) / s);
+        }
+        return q.normalize();
+    }
+
+    // Returns the components as a Vec4
+    constexpr Vec4<T> vec4() const {
+        return Vec4<T>(x, y, z, w);
+    }
+
+    // Returns the vector part
+    constexpr Vec3<T> vector() const {
+        return Vec3<T>(x, y, z);
+    }
+
+    constexpr bool operator == (const Quat<T> &other) const {
+        return x == other.x && y == other.y && z == other.z && w == other.w;
+    }
+
+    constexpr Quat<T> operator + (const Quat<T> &other) const { return {x + other.x, y + other.y, z + other.z, w + other.w}; };
+    constexpr Quat<T> operator - (const Quat<T> &other) const { return {x - other.x, y - other.y, z - other.z, w - other.w}; };
+    constexpr Quat<T> operator * (T scalar) const { return {x * scalar, y * scalar, z * scalar, w * scalar}; };
+    constexpr Quat<T> operator - () const { return {-x, -y, -z, -w}; };
+
+    // Hamilton product, applies other first and then this
+    constexpr Quat<T> operator * (const Quat<T> &other) const {
+        return {
+            w * other.x + x * other.w + y * other.z - z * other.y,
+            w * other.y - x * other.z + y * other.w + z * other.x,
+            w * other.z + x * other.y - y * other.x + z * other.w,
+            w * other.w - x * other.x - y * other.y - z * other.z
+        };
+    }
+
+    constexpr Quat<T>& operator *= (const Quat<T> &other) { return *this = *this * other; };
+
+    // Rotates a vector
+    constexpr Vec3<T> operator * (const Vec3<T> &vec) const {
+        return rotate(vec);
+    }
+
+    inline friend std::ostream& operator<<(std::ostream& os, const Quat<T>& quat)
+    {
+        os << quat.x << ", " << quat.y << ", " << quat.z << ", " << quat.w;
+        return os;
+    }
+
+    // Returns the dot product of two quaternions
+    constexpr T dot(const Quat<T> &other) const {
+        return x * other.x + y * other.y + z * other.z + w * other.w;
+    }
+
+    // Returns the length of the quaternion
+    constexpr T length() const {
+        return vecexpr::sqrt(dot(*this));
+    }
+
+    // Returns the normalized quaternion
+    constexpr Quat<T> normalize() const {
+        return *this * ((T)1 / length());
+    }
+
+    // Returns the conjugate, the inverse rotation of a unit quaternion
+    constexpr Quat<T> conjugate() const {
+        return {-x, -y, -z, w};
+    }
+
+    // Returns the inverse
+    constexpr Quat<T> inverse() const {
+        return conjugate() * ((T)1 / dot(*this));
+    }
+
+    // Rotates a vector, the quaternion has to be normalized
+    constexpr Vec3<T> rotate(const Vec3<T> &vec) const {
+        // v + 2w(q x v) + 2q x (q x v)
+        Vec3<T> q = vector();
+        Vec3<T> t = q.cross(vec) * (T)2;
+        return vec + t * w + q.cross(t);
+    }
+
+    // Returns the rotation matrix
+    constexpr Mat3<T> to_mat3() const {
+        T xx = x * x, yy = y * y, zz = z * z;
+        T xy = x * y, xz = x * z, yz = y * z;
+        T wx = w * x, wy = w * y, wz = w * z;
+        return Mat3<T>(
+            Vec3<T>((T)1 - (T)2 * (yy + zz), (T)2 * (xy + wz), (T)2 * (xz - wy)),
+            Vec3<T>((T)2 * (xy - wz), (T)1 - (T)2 * (xx + zz), (T)2 * (yz + wx)),
+            Vec3<T>((T)2 * (xz + wy), (T)2 * (yz - wx), (T)1 - (T)2 * (xx + yy))
+        );
+    }
+
+    // Returns the rotation matrix as an affine transform
+    constexpr Mat4<T> to_mat4() const {
+        Mat3<T> r = to_mat3();
+        return Mat4<T>(Vec4<T>(r[0]), Vec4<T>(r[1]), Vec4<T>(r[2]), Vec4<T>((T)0, (T)0, (T)0, (T)1));
+    }
+
+    // Normalized linear interpolation along the shortest path
+    static constexpr Quat<T> nlerp(const Quat<T> &a, const Quat<T> &b, T t) {
+        Quat<T> end = a.dot(b) < (T)0 ? -b : b;
+        return (a * ((T)1 - t) + end * t).normalize();
+    }
+
+    // Spherical linear interpolation along the shortest path
+    static inline Quat<T> slerp(const Quat<T> &a, const Quat<T> &b, T t) {
+        T d = a.dot(b);
+        Quat<T> end = b;
+        if (d < (T)0) {
+            d = -d;
+            end = -b;
+        }
+        if (d > (T)0.9995) {
+            return nlerp(a, end, t);
+        }
+        T theta = std::acos(d);
+        T s = (T)1 / std::sin(theta);
+        return a * (std::sin(((T)1 - t) * theta) * s) + end * (std::sin(t * theta) * s);
+    }
+};
+
+using quatf = Quat<float>;
+using quatd = Quat<double>;
+
+// Batch quaternion kernels, quaternions are stored in a Vec4Array with x, y, z, w lanes
+namespace quaternion {
+
+    namespace detail {
+        template<typename T>
+        inline void check_size(std::size_t a, std::size_t b) {
+            if (a != b) {
+                throw std::invalid_argument("Array sizes do not match");
+            }
+        }
+
+        // Replaces the nlerp weights wa = 1 - t and wb = t of n elements by the slerp weights sin(wa theta) / sin(theta)
+        // and sin(wb theta) / sin(theta), theta = acos(d), where d >= 0.9995 the nlerp weights are kept
+        // The sines and arc cosines come from the fastmath kernels, so every pass vectorizes
+        template<typename T>
+        inline void spherical_weights(const T* d, T* wa, T* wb, std::size_t n) {
+            T theta[math::detail::block];
+            T sines[math::detail::block];
+            T sa[math::detail::block];
+            T sb[math::detail::block];
+            math::acos(std::span<const T>(d, n), std::span<T>(theta, n));
+            for (std::size_t i = 0; i < n; i++) {
+                sa[i] = wa[i] * theta[i];
+                sb[i] = wb[i] * theta[i];
+            }
+            math::sin(std::span<const T>(theta, n), std::span<T>(sines, n));
+            math::sin(std::span<const T>(sa, n), std::span<T>(sa, n));
+            math::sin(std::span<const T>(sb, n), std::span<T>(sb, n));
+            for (std::size_t i = 0; i < n; i++) {
+                // Near d = 1 sin(theta) goes to 0, the unused quotient may be NaN and is masked out
+                const bool linear = !(d[i] < (T)0.9995);
+                const T s = (T)1 / sines[i];
+                wa[i] = math::detail::select(linear, wa[i], sa[i] * s);
+                wb[i] = math::detail::select(linear, wb[i], sb[i] * s);
+            }
+        }
+
+        // Shared body of the interpolation kernels, t(i) returns the interpolation factor of element i
+        // Elements are done a block at a time, the dot products and weights of a block first, then the blend
+        template<bool Spherical, typename T, typename Factor>
+        inline void interpolate(const Vec4Array<T> &a, const Vec4Array<T> &b, Factor t, Vec4Array<T> &out) {
+            const std::size_t n = a.size();
+            check_size<T>(b.size(), n);
+            if (&out == &a || &out == &b) {
+                Vec4Array<T> tmp;
+                interpolate<Spherical, T>(a, b, t, tmp);
+                out = std::move(tmp);
+                return;
+            }
+            out.resize(n);
+            const T* EXTLIB_RESTRICT ax = a.x();
+            const T* EXTLIB_RESTRICT ay = a.y();
+            const T* EXTLIB_RESTRICT az = a.z();
+            const T* EXTLIB_RESTRICT aw = a.w();
+            const T* EXTLIB_RESTRICT bx = b.x();
+            const T* EXTLIB_RESTRICT by = b.y();
+            const T* EXTLIB_RESTRICT bz = b.z();
+            const T* EXTLIB_RESTRICT bw = b.w();
+            T* EXTLIB_RESTRICT ox = out.x();
+            T* EXTLIB_RESTRICT oy = out.y();
+            T* EXTLIB_RESTRICT oz = out.z();
+            T* EXTLIB_RESTRICT ow = out.w();
+            T dots[math::detail::block];
+            T signs[math::detail::block];
+            T wa[math::detail::block];
+            T wb[math::detail::block];
+            T rx[math::detail::block];
+            T ry[math::detail::block];
+            T rz[math::detail::block];
+            T rw[math::detail::block];
+            T lengths[math::detail::block];
+            for (std::size_t begin = 0; begin < n; begin += math::detail::block) {
+                const std::size_t m = n - begin < math::detail::block ? n - begin : math::detail::block;
+                for (std::size_t k = 0; k < m; k++) {
+                    const std::size_t i = begin + k;
+                    T d = ax[i] * bx[i] + ay[i] * by[i] + az[i] * bz[i] + aw[i] * bw[i];
+                    // Take the shortest path
+                    const T sign = math::detail::select(d < (T)0, (T)-1, (T)1);
+                    const T ti = t(i);
+                    dots[k] = d * sign;
+                    signs[k] = sign;
+                    wa[k] = (T)1 - ti;
+                    wb[k] = ti;
+                }
+                if constexpr (Spherical) {
+                    spherical_weights(dots, wa, wb, m);
+                }
+                // The results go to the stack first, gcc gives up on the alias checks between the input and output lanes
+                for (std::size_t k = 0; k < m; k++) {
+                    const std::size_t i = begin + k;
+                    const T wbs = wb[k] * signs[k];
+                    rx[k] = ax[i] * wa[k] + bx[i] * wbs;
+                    ry[k] = ay[i] * wa[k] + by[i] * wbs;
+                    rz[k] = az[i] * wa[k] + bz[i] * wbs;
+                    rw[k] = aw[i] * wa[k] + bw[i] * wbs;
+                    lengths[k] = rx[k] * rx[k] + ry[k] * ry[k] + rz[k] * rz[k] + rw[k] * rw[k];
+                }
+                simd::sqrt(lengths, m);
+                for (std::size_t k = 0; k < m; k++) {
+                    const std::size_t i = begin + k;
+                    const T inv = (T)1 / lengths[k];
+                    ox[i] = rx[k] * inv;
+                    oy[i] = ry[k] * inv;
+                    oz[i] = rz[k] * inv;
+                    ow[i] = rw[k] * inv;
+                }
+            }
+        }
+    }
+
+    // out[i] = nlerp(a[i], b[i], t)
+    template<typename T>
+    inline void nlerp(const Vec4Array<T> &a, const Vec4Array<T> &b, T t, Vec4Array<T> &out) {
+        detail::interpolate<false, T>(a, b, [t](std::size_t) { return t; }, out);
+    }
+
+    // out[i] = nlerp(a[i], b[i], t[i])
+    template<typename T>
+    inline void nlerp(const Vec4Array<T> &a, const Vec4Array<T> &b, std::span<const T> t, Vec4Array<T> &out) {
+        detail::check_size<T>(t.size(), a.size());
+        const T* factors = t.data();
+        detail::interpolate<false, T>(a, b, [factors](std::size_t i) { return factors[i]; }, out);
+    }
+
+    // out[i] = slerp(a[i], b[i], t), the result is normalized
+    template<typename T>
+    inline void slerp(const Vec4Array<T> &a, const Vec4Array<T> &b, T t, Vec4Array<T> &out) {
+        detail::interpolate<true, T>(a, b, [t](std::size_t) { return t; }, out);
+    }
+
+    // out[i] = slerp(a[i], b[i], t[i]), the result is normalized
+    template<typename T>
+    inline void slerp(const Vec4Array<T> &a, const Vec4Array<T> &b, std::span<const T> t, Vec4Array<T> &out) {
+        detail::check_size<T>(t.size(), a.size());
+        const T* factors = t.data();
+        detail::interpolate<true, T>(a, b, [factors](std::size_t i) { return factors[i]; }, out);
+    }
+
+    // out[i] = q rotating in[i]
+    template<typename T>
+    inline void rotate(const Quat<T> &q, const Vec3Array<T> &in, Vec3Array<T> &out) {
+        const std::size_t n = in.size();
+        out.resize(n);
+        const T* x = in.x();
+        const T* y = in.y();
+        const T* z = in.z();
+        T* ox = out.x();
+        T* oy = out.y();
+        T* oz = out.z();
+        const T qx = q.x, qy = q.y, qz = q.z, qw = q.w;
+        for (std::size_t i = 0; i < n; i++) {
+            // t = 2 (q x v), v' = v + w t + q x t
+            T tx = (T)2 * (qy * z[i] - qz * y[i]);
+            T ty = (T)2 * (qz * x[i] - qx * z[i]);
+            T tz = (T)2 * (qx * y[i] - qy * x[i]);
+            T rx = x[i] + qw * tx + (qy * tz - qz * ty);
+            T ry = y[i] + qw * ty + (qz * tx - qx * tz);
+            T rz = z[i] + qw * tz + (qx * ty - qy * tx);
+            ox[i] = rx;
+            oy[i] = ry;
+            oz[i] = rz;
+        }
+    }
+
+    // out[i] = quats[i] rotating in[i]
+    template<typename T>
+    inline void rotate(const Vec4Array<T> &quats, const Vec3Array<T> &in, Vec3Array<T> &out) {
+        const std::size_t n = in.size();
+        detail::check_size<T>(quats.size(), n);
+        out.resize(n);
+        const T* x = in.x();
+        const T* y = in.y();
+        const T* z = in.z();
+        const T* qx = quats.x();
+        const T* qy = quats.y();
+        const T* qz = quats.z();
+        const T* qw = quats.w();
+        T* ox = out.x();
+        T* oy = out.y();
+        T* oz = out.z();
+        for (std::size_t i = 0; i < n; i++) {
+            T tx = (T)2 * (qy[i] * z[i] - qz[i] * y[i]);
+            T ty = (T)2 * (qz[i] * x[i] - qx[i] * z[i]);
+            T tz = (T)2 * (qx[i] * y[i] - qy[i] * x[i]);
+            T rx = x[i] + qw[i] * tx + (qy[i] * tz - qz[i] * ty);
+            T ry = y[i] + qw[i] * ty + (qz[i] * tx - qx[i] * tz);
+            T rz = z[i] + qw[i] * tz + (qx[i] * ty - qy[i] * tx);
+            ox[i] = rx;
+            oy[i] = ry;
+            oz[i] = rz;
+        }
+    }
+
+    // out[i] = a[i] * b[i], composes two sets of rotations
+    template<typename T>
+    inline void multiply(const Vec4Array<T> &a, const Vec4Array<T> &b, Vec4Array<T> &out) {
+        const std::size_t n = a.size();
+        detail::check_size<T>(b.size(), n);
+        out.resize(n);
+        const T* ax = a.x();
+        const T* ay = a.y();
+        const T* az = a.z();
+        const T* aw = a.w();
+        const T* bx = b.x();
+        const T* by = b.y();
+        const T* bz = b.z();
+        const T* bw = b.w();
+        T* ox = out.x();
+        T* oy = out.y();
+        T* oz = out.z();
+        T* ow = out.w();
+        for (std::size_t i = 0; i < n; i++) {
+            T rx = aw[i] * bx[i] + ax[i] * bw[i] + ay[i] * bz[i] - az[i] * by[i];
+            T ry = aw[i] * by[i] - ax[i] * bz[i] + ay[i] * bw[i] + az[i] * bx[i];
+            T rz = aw[i] * bz[i] + ax[i] * by[i] - ay[i] * bx[i] + az[i] * bw[i];
+            T rw = aw[i] * bw[i] - ax[i] * bx[i] - ay[i] * by[i] - az[i] * bz[i];
+            ox[i] = rx;
+            oy[i] = ry;
+            oz[i] = rz;
+            ow[i] = rw;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,287 @@
+#include "./screen.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <iostream>
+
+#include "./ansi.hpp"
+#include "./terminal.hpp"
+
+namespace ansi {
+
+    namespace {
+        constexpr std::size_t unknown = (std::size_t)-1;
+
+        inline void append_number(std::string &out, std::size_t value) {
+            char buffer[24];
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            out.append(buffer, result.ptr);
+        }
+
+        inline std::size_t number_length(std::size_t value) {
+            std::size_t n = 1;
+            for (; value >= 10; value /= 10) {
+                n++;
+            }
+            return n;
+        }
+
+        // Control characters would move the cursor behind our back, they are drawn as ?
+        inline char32_t printable(char32_t c) {
+            if (c < 0x20 || c == 0x7F || (c >= 0x80 && c < 0xA0) || (c >= 0xD800 && c < 0xE000) || c > 0x10FFFF) {
+                return U'?';
+            }
+            return c;
+        }
+
+        inline std::size_t utf8_length(char32_t c) {
+            c = printable(c);
+            return c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+        }
+
+        inline void append_utf8(std::string &out, char32_t c) {
+            c = printable(c);
+            if (c < 0x80) {
+                out += (char)c;
+            } else if (c < 0x800) {
+                out += (char)(0xC0 | (c >> 6));
+                out += (char)(0x80 | (c & 0x3F));
+            } else if (c < 0x10000) {
+                out += (char)(0xE0 | (c >> 12));
+                out += (char)(0x80 | ((c >> 6) & 0x3F));
+                out += (char)(0x80 | (c & 0x3F));
+            } else {
+                out += (char)(0xF0 | (c >> 18));
+                out += (char)(0x80 | ((c >> 12) & 0x3F));
+                out += (char)(0x80 | ((c >> 6) & 0x3F));
+                out += (char)(0x80 | (c & 0x3F));
+            }
+        }
+
+        // Decodes the code point at text[i] and advances i, malformed sequences decode to U+FFFD one byte at a time
+        inline char32_t next_utf8(std::string_view text, std::size_t &i) {
+            const unsigned char lead = (unsigned char)text[i++];
+            if (lead < 0x80) {
+                return lead;
+            }
+            std::size_t extra = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : 0;
+            if (extra == 0 || lead > 0xF4 || i + extra > text.size()) {
+                return 0xFFFD;
+            }
+            char32_t c = lead & (0x3F >> extra);
+            for (std::size_t k = 0; k < extra; k++) {
+                const unsigned char byte = (unsigned char)text[i + k];
+                if ((byte & 0xC0) != 0x80) {
+                    return 0xFFFD;
+                }
+                c = (c << 6) | (byte & 0x3F);
+            }
+            // Overlong encodings
+            constexpr char32_t smallest[4] = { 0, 0x80, 0x800, 0x10000 };
+            if (c < smallest[extra]) {
+                return 0xFFFD;
+            }
+            i += extra;
+            return c;
+        }
+
+        // Appends the parameters of color downsampled to support, nothing for ColorSupport::none
+        inline void append_color(std::string &out, const Color &color, bool background, terminal::ColorSupport support) {
+            if (support == terminal::ColorSupport::none) {
+                return;
+            }
+            Color shown = color;
+            if (shown.kind == Color::Kind::rgb && support != terminal::ColorSupport::truecolor) {
+                shown = Color::indexed(to_256(color.r, color.g, color.b));
+            }
+            if (shown.kind == Color::Kind::indexed && support == terminal::ColorSupport::basic) {
+                const std::uint8_t index = to_16(shown.r);
+                if (index < 8) {
+                    out += background ? '4' : '3';
+                } else {
+                    out += background ? "10" : "9";
+                }
+                out += (char)('0' + (index & 7));
+                out += ';';
+                return;
+            }
+            switch (shown.kind) {
+                case Color::Kind::none:
+                    out += background ? "49" : "39";
+                    break;
+                case Color::Kind::indexed:
+                    out += background ? "48;5;" : "38;5;";
+                    append_number(out, shown.r);
+                    break;
+                case Color::Kind::rgb:
+                    out += background ? "48;2;" : "38;2;";
+                    append_number(out, shown.r);
+                    out += ';';
+                    append_number(out, shown.g);
+                    out += ';';
+                    append_number(out, shown.b);
+                    break;
+            }
+            out += ';';
+        }
+
+        inline void append_attributes(std::string &out, std::uint8_t attributes) {
+            constexpr const char* codes[8] = { "1;", "2;", "3;", "4;", "5;", "7;", "9;", "53;" };
+            for (std::size_t k = 0; k < 8; k++) {
+                if (attributes & (1 << k)) {
+                    out += codes[k];
+                }
+            }
+        }
+    }
+
+    Screen::Screen(std::size_t width, std::size_t height) {
+        resize(width, height);
+    }
+
+    void Screen::resize(std::size_t width, std::size_t height) {
+        if (height > 0 && width > (std::size_t)-1 / sizeof(Cell) / height) {
+            throw std::invalid_argument("Screen too large");
+        }
+        columns = width;
+        rows = height;
+        back.assign(width * height, Cell());
+        front.assign(width * height, Cell());
+        invalidate();
+    }
+
+    std::size_t Screen::put(std::size_t x, std::size_t y, std::string_view text, Color fg, Color bg, std::uint8_t attributes) {
+        if (y >= rows) {
+            return 0;
+        }
+        Cell* row = back.data() + y * columns;
+        std::size_t written = 0;
+        for (std::size_t i = 0; i < text.size() && x + written < columns;) {
+            row[x + written] = { next_utf8(text, i), fg, bg, attributes };
+            written++;
+        }
+        return written;
+    }
+
+    void Screen::fill(const Cell &cell) {
+        std::fill(back.begin(), back.end(), cell);
+    }
+
+    void Screen::invalidate() {
+        full = true;
+    }
+
+    const std::string& Screen::render() {
+        frame.clear();
+        // Cursor position and pen are unknown at the start of a frame, other output may have changed them
+        std::size_t cx = unknown;
+        std::size_t cy = unknown;
+        Cell pen;
+        bool pen_known = false;
+        // Without colours the attributes are dropped as well, the output is likely a file or a pipe
+        const bool styled = support != terminal::ColorSupport::none;
+        if (full) {
+            // A cleared terminal shows blank default cells, only the others are drawn
+            frame += style(sgr<code::reset>, styled);
+            frame += "\033[2J";
+            pen_known = true;
+            std::fill(front.begin(), front.end(), Cell());
+            full = false;
+        }
+        std::string sequence;
+        for (std::size_t y = 0; y < rows; y++) {
+            const Cell* row = back.data() + y * columns;
+            const Cell* shown = front.data() + y * columns;
+            for (std::size_t x = 0; x < columns; x++) {
+                const Cell &cell = row[x];
+                if (cell == shown[x]) {
+                    continue;
+                }
+
+                if (cy != y || cx != x) {
+                    if (cy == y && cx < x) {
+                        // Short gaps of unchanged cells in the current pen are cheaper to draw again than to skip
+                        const std::size_t skip = 3 + number_length(x - cx);
+                        std::size_t redraw = 0;
+                        for (std::size_t k = cx; k < x && redraw <= skip; k++) {
+                            redraw += pen_known && row[k].same_style(pen) ? utf8_length(row[k].glyph) : skip + 1;
+                        }
+                        if (redraw <= skip) {
+                            for (std::size_t k = cx; k < x; k++) {
+                                append_utf8(frame, row[k].glyph);
+                            }
+                        } else {
+                            frame += "\033[";
+                            append_number(frame, x - cx);
+                            frame += 'C';
+                        }
+                    } else if (x == 0 && cy != unknown && y == cy + 1) {
+                        frame += "\r\n";
+                    } else {
+                        frame += "\033[";
+                        append_number(frame, y + 1);
+                        frame += ';';
+                        append_number(frame, x + 1);
+                        frame += 'H';
+                    }
+                }
+
+                if (!pen_known || !cell.same_style(pen)) {
+                    sequence.assign("\033[");
+                    // Attributes have no common off code, dropping any of them starts from a reset
+                    if (!pen_known || (pen.attributes & ~cell.attributes) != 0) {
+                        sequence += "0;";
+                        append_attributes(sequence, cell.attributes);
+                        if (cell.fg != Color::none()) {
+                            append_color(sequence, cell.fg, false, support);
+                        }
+                        if (cell.bg != Color::none()) {
+                            append_color(sequence, cell.bg, true, support);
+                        }
+                    } else {
+                        append_attributes(sequence, cell.attributes & ~pen.attributes);
+                        if (cell.fg != pen.fg) {
+                            append_color(sequence, cell.fg, false, support);
+                        }
+                        if (cell.bg != pen.bg) {
+                            append_color(sequence, cell.bg, true, support);
+                        }
+                    }
+                    // Colour changes alone add nothing when the terminal has no colours
+                    if (sequence.size() > 2) {
+                        sequence.back() = 'm';
+                        frame += style(sequence, styled);
+                    }
+                    pen = cell;
+                    pen_known = true;
+                }
+
+                append_utf8(frame, cell.glyph);
+                cx = x + 1;
+                cy = y;
+                // Past the last column the cursor waits to wrap, terminals disagree on where it is
+                if (cx == columns) {
+                    cx = unknown;
+                    cy = unknown;
+                }
+            }
+        }
+        if (!frame.empty() && !(pen_known && pen.same_style(Cell()))) {
+            frame += style(sgr<code::reset>, styled);
+        }
+        front = back;
+        return frame;
+    }
+
+    void Screen::present() {
+        render();
+        if (frame.empty()) {
+            return;
+        }
+        // Anything still buffered was meant to come before the frame
+        std::cout.flush();
+        std::fflush(stdout);
+        terminal::write(frame);
+    }
+}
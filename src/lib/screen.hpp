@@ -0,0 +1,152 @@
+#ifndef SCREENHPP
+#define SCREENHPP
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "terminal.hpp"
+
+// Double buffered terminal screen
+//
+// Drawing goes to a back grid of cells, render diffs it against the front grid holding what the terminal shows and
+// emits only the cursor moves, SGR changes and glyphs of the cells that changed. present writes the whole frame with
+// a single call, a mostly static dashboard costs a few bytes per frame instead of a full redraw.
+namespace ansi {
+
+    /**
+     * @brief A terminal colour, either the default colour, an entry of the 256 colour palette or a 24 bit colour
+     */
+    struct Color {
+        enum class Kind : std::uint8_t { none, indexed, rgb };
+
+        Kind kind = Kind::none;
+        std::uint8_t r = 0;
+        std::uint8_t g = 0;
+        std::uint8_t b = 0;
+
+        // The terminal's default colour
+        static constexpr Color none() { return Color(); };
+
+        // Entry of the 256 colour palette, 0 - 15 are the 16 basic colours
+        static constexpr Color indexed(std::uint8_t index) { return Color{ Kind::indexed, index, 0, 0 }; };
+
+        static constexpr Color rgb(std::uint8_t r, std::uint8_t g, std::uint8_t b) { return Color{ Kind::rgb, r, g, b }; };
+
+        constexpr bool operator == (const Color &other) const = default;
+    };
+
+    // Cell attributes, combined with |
+    namespace attribute {
+        enum : std::uint8_t {
+            none      = 0,
+            bold      = 1 << 0,
+            dim       = 1 << 1,
+            italic    = 1 << 2,
+            underline = 1 << 3,
+            blink     = 1 << 4,
+            inverse   = 1 << 5,
+            crossed   = 1 << 6,
+            overline  = 1 << 7,
+        };
+    }
+
+    /**
+     * @brief One character cell of the screen, every glyph takes a single column
+     */
+    struct Cell {
+        char32_t glyph = U' ';
+        Color fg;
+        Color bg;
+        std::uint8_t attributes = attribute::none;
+
+        constexpr bool operator == (const Cell &other) const = default;
+
+        // Returns whether both cells draw with the same colours and attributes
+        constexpr bool same_style(const Cell &other) const {
+            return fg == other.fg && bg == other.bg && attributes == other.attributes;
+        }
+    };
+
+    /**
+     * @brief A width * height grid of cells drawn to the terminal by diffing against the previous frame
+     *
+     * The screen owns the whole terminal, row 0 column 0 is its top left corner. Anything else written to the
+     * terminal is not tracked, call invalidate to have the next frame redraw everything.
+     */
+    class Screen {
+    public:
+        Screen(std::size_t width, std::size_t height);
+
+        inline std::size_t width() const { return columns; };
+        inline std::size_t height() const { return rows; };
+
+        // Changes the size, the next frame clears the terminal and redraws everything
+        void resize(std::size_t width, std::size_t height);
+
+        inline Cell& get(std::size_t x, std::size_t y) {
+            if (x >= columns || y >= rows) {
+                throw std::out_of_range("Out of range item");
+            }
+            return back[y * columns + x];
+        }
+
+        inline const Cell& get(std::size_t x, std::size_t y) const {
+            if (x >= columns || y >= rows) {
+                throw std::out_of_range("Out of range item");
+            }
+            return back[y * columns + x];
+        }
+
+        // Sets a cell, positions outside the screen are ignored
+        inline void set(std::size_t x, std::size_t y, const Cell &cell) {
+            if (x < columns && y < rows) {
+                back[y * columns + x] = cell;
+            }
+        }
+
+        // Writes UTF-8 text starting at x, y with the given style, clipped at the right edge
+        // Returns the number of columns written
+        std::size_t put(std::size_t x, std::size_t y, std::string_view text, Color fg = Color::none(), Color bg = Color::none(), std::uint8_t attributes = attribute::none);
+
+        // Sets every cell of the back grid
+        void fill(const Cell &cell);
+
+        // Sets every cell of the back grid to a blank default cell
+        inline void clear() { fill(Cell()); };
+
+        // Forgets what the terminal shows, the next frame clears it and redraws everything
+        void invalidate();
+
+        // Returns the escape sequences and text turning the previous frame into the current one
+        // The back grid becomes the front grid, it is kept as is so the next frame can draw over it
+        const std::string& render();
+
+        // Renders the frame and writes it to stdout with a single write
+        void present();
+
+        // Colours are downsampled to support, it starts as what stdout supports
+        // With ColorSupport::none no SGR sequences are written at all, attributes included
+        inline terminal::ColorSupport color_support() const { return support; };
+
+        // Changes the colours the next frames use, the next frame redraws everything
+        inline void set_color_support(terminal::ColorSupport color) {
+            support = color;
+            invalidate();
+        }
+
+    private:
+        std::size_t columns;
+        std::size_t rows;
+        std::vector<Cell> back;
+        std::vector<Cell> front;
+        bool full = true;
+        terminal::ColorSupport support = terminal::capabilities().color;
+        std::string frame;
+    };
+}
+
+#endif
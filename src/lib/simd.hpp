@@ -0,0 +1,681 @@
+#ifndef SIMDHPP
+#define SIMDHPP
+
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <type_traits>
+
+// SIMD feature detection
+// Define EXTLIB_NO_SIMD to force the portable code paths
+#ifndef EXTLIB_NO_SIMD
+#if defined(__AVX2__)
+#define EXTLIB_AVX2 1
+#endif
+#if defined(__AVX__)
+#define EXTLIB_AVX 1
+#endif
+#if defined(__SSE4_1__) || defined(EXTLIB_AVX)
+#define EXTLIB_SSE41 1
+#endif
+#if defined(__SSE4_2__) || defined(EXTLIB_AVX)
+#define EXTLIB_SSE42 1
+#endif
+#if defined(__F16C__)
+#define EXTLIB_F16C 1
+#endif
+#if defined(__BMI2__)
+#define EXTLIB_BMI2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EXTLIB_SSE2 1
+#endif
+#if defined(__SSE__) || defined(EXTLIB_SSE2)
+#define EXTLIB_SSE 1
+#endif
+#endif
+
+#if defined(EXTLIB_SSE) || defined(EXTLIB_AVX) || defined(EXTLIB_BMI2)
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#define EXTLIB_RESTRICT __restrict
+#else
+#define EXTLIB_RESTRICT __restrict__
+#endif
+
+namespace simd {
+
+    // Alignment used for SIMD lanes, one cache line
+    constexpr std::size_t alignment = 64;
+
+    /**
+     * @brief Allocator returning memory aligned to Align bytes
+     *
+     * @tparam T Type to allocate
+     * @tparam Align Alignment in bytes
+     */
+    template<typename T, std::size_t Align = alignment>
+    struct aligned_allocator {
+        using value_type = T;
+
+        template<typename T2>
+        struct rebind {
+            using other = aligned_allocator<T2, Align>;
+        };
+
+        inline aligned_allocator() noexcept = default;
+
+        template<typename T2>
+        inline aligned_allocator(const aligned_allocator<T2, Align> &) noexcept {};
+
+        inline T* allocate(std::size_t n) {
+            if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+                throw std::bad_array_new_length();
+            }
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Align)));
+        }
+
+        inline void deallocate(T* p, std::size_t) noexcept {
+            ::operator delete(p, std::align_val_t(Align));
+        }
+
+        template<typename T2>
+        inline bool operator == (const aligned_allocator<T2, Align> &) const noexcept { return true; };
+        template<typename T2>
+        inline bool operator != (const aligned_allocator<T2, Align> &) const noexcept { return false; };
+    };
+
+    // Replaces every element of data with its square root
+    template<typename T>
+    inline void sqrt(T* data, std::size_t n) {
+        for (std::size_t i = 0; i < n; i++) {
+            data[i] = (T)std::sqrt(data[i]);
+        }
+    }
+
+    // Replaces every element of data with its square root
+    template<>
+    inline void sqrt<float>(float* data, std::size_t n) {
+        std::size_t i = 0;
+#if defined(EXTLIB_AVX)
+        for (; i + 8 <= n; i += 8) {
+            _mm256_storeu_ps(data + i, _mm256_sqrt_ps(_mm256_loadu_ps(data + i)));
+        }
+#endif
+#if defined(EXTLIB_SSE)
+        for (; i + 4 <= n; i += 4) {
+            _mm_storeu_ps(data + i, _mm_sqrt_ps(_mm_loadu_ps(data + i)));
+        }
+#endif
+        for (; i < n; i++) {
+            data[i] = std::sqrt(data[i]);
+        }
+    }
+
+    // Replaces every element of data with its square root
+    template<>
+    inline void sqrt<double>(double* data, std::size_t n) {
+        std::size_t i = 0;
+#if defined(EXTLIB_AVX)
+        for (; i + 4 <= n; i += 4) {
+            _mm256_storeu_pd(data + i, _mm256_sqrt_pd(_mm256_loadu_pd(data + i)));
+        }
+#endif
+#if defined(EXTLIB_SSE2)
+        for (; i + 2 <= n; i += 2) {
+            _mm_storeu_pd(data + i, _mm_sqrt_pd(_mm_loadu_pd(data + i)));
+        }
+#endif
+        for (; i < n; i++) {
+            data[i] = std::sqrt(data[i]);
+        }
+    }
+
+    // Newton-Raphson steps rsqrt uses by default, enough for about 23 bits for float and 46 bits for double
+    template<typename T>
+    constexpr int rsqrt_steps = 2;
+    template<>
+    constexpr int rsqrt_steps<float> = 1;
+
+    // Reciprocal square root estimate from the exponent bits, within 3.5% of the exact result
+    constexpr float rsqrt_estimate(float x) {
+        std::uint32_t i = std::bit_cast<std::uint32_t>(x);
+        return std::bit_cast<float>(0x5f3759dfu - (i >> 1));
+    }
+
+    // Reciprocal square root estimate from the exponent bits, within 3.5% of the exact result
+    constexpr double rsqrt_estimate(double x) {
+        std::uint64_t i = std::bit_cast<std::uint64_t>(x);
+        return std::bit_cast<double>(0x5FE6EB50C7B537A9ull - (i >> 1));
+    }
+
+    // One Newton-Raphson step refining y towards 1 / sqrt(x), roughly doubles the number of correct bits
+    template<typename T>
+    constexpr T rsqrt_step(T x, T y) {
+        return y * ((T)1.5 - (T)0.5 * x * y * y);
+    }
+
+    // Fast 1 / sqrt(x) for positive finite x, a 12 bit rsqrtss estimate refined with Steps Newton-Raphson steps
+    // Steps = 0 is within 0.04%, 1 within a few float ulp, double needs 2 for about 46 bits and 3 for full precision
+    template<typename T, int Steps = rsqrt_steps<T>>
+    inline T rsqrt(T x) {
+        static_assert(std::is_same_v<T, float> || std::is_same_v<T, double>, "rsqrt supports float and double");
+        T y;
+#if defined(EXTLIB_SSE)
+        if constexpr (std::is_same_v<T, float>) {
+            y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+        } else {
+            // Only values inside the normal float range survive the round trip through rsqrtss, others are scaled by an even power of two
+            if (x >= (double)std::numeric_limits<float>::min() && x <= (double)std::numeric_limits<float>::max()) {
+                y = (double)_mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss((float)x)));
+            } else {
+                int e;
+                double m = std::frexp(x, &e);
+                if (e & 1) {
+                    m *= 2.0;
+                    e--;
+                }
+                y = std::ldexp((double)_mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss((float)m))), -e / 2);
+            }
+        }
+#else
+        // Two extra steps bring the bit trick estimate to the accuracy of rsqrtss
+        y = rsqrt_step(x, rsqrt_step(x, rsqrt_estimate(x)));
+#endif
+        for (int i = 0; i < Steps; i++) {
+            y = rsqrt_step(x, y);
+        }
+        return y;
+    }
+
+    // out[i] = rsqrt(in[i]) with rsqrtps, doubles are narrowed to float for the estimate, out may be in
+    template<typename T, int Steps = rsqrt_steps<T>>
+    inline void rsqrt(const T* in, T* out, std::size_t n) {
+        static_assert(std::is_same_v<T, float> || std::is_same_v<T, double>, "rsqrt supports float and double");
+        if constexpr (std::is_same_v<T, float>) {
+            std::size_t i = 0;
+#if defined(EXTLIB_AVX)
+            const __m256 half8 = _mm256_set1_ps(0.5f);
+            const __m256 three_halves8 = _mm256_set1_ps(1.5f);
+            for (; i + 8 <= n; i += 8) {
+                __m256 x = _mm256_loadu_ps(in + i);
+                __m256 y = _mm256_rsqrt_ps(x);
+                __m256 xhalf = _mm256_mul_ps(half8, x);
+                for (int s = 0; s < Steps; s++) {
+                    y = _mm256_mul_ps(y, _mm256_sub_ps(three_halves8, _mm256_mul_ps(xhalf, _mm256_mul_ps(y, y))));
+                }
+                _mm256_storeu_ps(out + i, y);
+            }
+#endif
+#if defined(EXTLIB_SSE)
+            const __m128 half = _mm_set1_ps(0.5f);
+            const __m128 three_halves = _mm_set1_ps(1.5f);
+            for (; i + 4 <= n; i += 4) {
+                __m128 x = _mm_loadu_ps(in + i);
+                __m128 y = _mm_rsqrt_ps(x);
+                __m128 xhalf = _mm_mul_ps(half, x);
+                for (int s = 0; s < Steps; s++) {
+                    y = _mm_mul_ps(y, _mm_sub_ps(three_halves, _mm_mul_ps(xhalf, _mm_mul_ps(y, y))));
+                }
+                _mm_storeu_ps(out + i, y);
+            }
+#endif
+            for (; i < n; i++) {
+                out[i] = rsqrt<float, Steps>(in[i]);
+            }
+        } else {
+            std::size_t i = 0;
+#if defined(EXTLIB_AVX)
+            const __m256d lo4 = _mm256_set1_pd((double)std::numeric_limits<float>::min());
+            const __m256d hi4 = _mm256_set1_pd((double)std::numeric_limits<float>::max());
+            const __m256d half4 = _mm256_set1_pd(0.5);
+            const __m256d three_halves4 = _mm256_set1_pd(1.5);
+            for (; i + 4 <= n; i += 4) {
+                __m256d x = _mm256_loadu_pd(in + i);
+                __m256d range = _mm256_and_pd(_mm256_cmp_pd(x, lo4, _CMP_GE_OQ), _mm256_cmp_pd(x, hi4, _CMP_LE_OQ));
+                if (_mm256_movemask_pd(range) != 0xF) {
+                    for (std::size_t j = i; j < i + 4; j++) {
+                        out[j] = rsqrt<double, Steps>(in[j]);
+                    }
+                    continue;
+                }
+                __m256d y = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(x)));
+                __m256d xhalf = _mm256_mul_pd(half4, x);
+                for (int s = 0; s < Steps; s++) {
+                    y = _mm256_mul_pd(y, _mm256_sub_pd(three_halves4, _mm256_mul_pd(xhalf, _mm256_mul_pd(y, y))));
+                }
+                _mm256_storeu_pd(out + i, y);
+            }
+#endif
+#if defined(EXTLIB_SSE2)
+            const __m128d lo = _mm_set1_pd((double)std::numeric_limits<float>::min());
+            const __m128d hi = _mm_set1_pd((double)std::numeric_limits<float>::max());
+            const __m128d half = _mm_set1_pd(0.5);
+            const __m128d three_halves = _mm_set1_pd(1.5);
+            for (; i + 2 <= n; i += 2) {
+                __m128d x = _mm_loadu_pd(in + i);
+                __m128d range = _mm_and_pd(_mm_cmpge_pd(x, lo), _mm_cmple_pd(x, hi));
+                if (_mm_movemask_pd(range) != 0x3) {
+                    out[i] = rsqrt<double, Steps>(in[i]);
+                    out[i + 1] = rsqrt<double, Steps>(in[i + 1]);
+                    continue;
+                }
+                __m128d y = _mm_cvtps_pd(_mm_rsqrt_ps(_mm_cvtpd_ps(x)));
+                __m128d xhalf = _mm_mul_pd(half, x);
+                for (int s = 0; s < Steps; s++) {
+                    y = _mm_mul_pd(y, _mm_sub_pd(three_halves, _mm_mul_pd(xhalf, _mm_mul_pd(y, y))));
+                }
+                _mm_storeu_pd(out + i, y);
+            }
+#endif
+            for (; i < n; i++) {
+                out[i] = rsqrt<double, Steps>(in[i]);
+            }
+        }
+    }
+
+#if defined(EXTLIB_SSE)
+    // Splits 4 packed xyz triples, 12 floats, into one register per component
+    inline void deinterleave3(const float* in, __m128 &x, __m128 &y, __m128 &z) {
+        __m128 a = _mm_loadu_ps(in);
+        __m128 b = _mm_loadu_ps(in + 4);
+        __m128 c = _mm_loadu_ps(in + 8);
+        x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+        y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+        z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+    }
+
+    // Inverse of deinterleave3, writes 4 packed xyz triples
+    inline void interleave3(__m128 x, __m128 y, __m128 z, float* out) {
+        __m128 xy_lo = _mm_unpacklo_ps(x, y);
+        __m128 xy_hi = _mm_unpackhi_ps(x, y);
+        __m128 a = _mm_shuffle_ps(xy_lo, _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0));
+        __m128 b = _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)), xy_hi, _MM_SHUFFLE(1, 0, 2, 0));
+        __m128 c = _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)), _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+        _mm_storeu_ps(out, a);
+        _mm_storeu_ps(out + 4, b);
+        _mm_storeu_ps(out + 8, c);
+    }
+#endif
+
+    // Alignment of a Vec4<T>, wide enough to load it into a single register
+    template<typename T>
+    constexpr std::size_t vec4_alignment = alignof(T);
+#if defined(EXTLIB_SSE)
+    template<>
+    constexpr std::size_t vec4_alignment<float> = 16;
+#endif
+#if defined(EXTLIB_AVX)
+    template<>
+    constexpr std::size_t vec4_alignment<double> = 32;
+#elif defined(EXTLIB_SSE2)
+    template<>
+    constexpr std::size_t vec4_alignment<double> = 16;
+#endif
+
+    /**
+     * @brief Kernels for 4 component vectors, pointers point to 4 contiguous components aligned to vec4_alignment
+     *
+     * @tparam T Type of the components
+     */
+    template<typename T>
+    struct vec4 {
+        static inline void add(const T* a, const T* b, T* out) {
+            for (int i = 0; i < 4; i++) out[i] = a[i] + b[i];
+        }
+
+        static inline void sub(const T* a, const T* b, T* out) {
+            for (int i = 0; i < 4; i++) out[i] = a[i] - b[i];
+        }
+
+        static inline void mul(const T* a, const T* b, T* out) {
+            for (int i = 0; i < 4; i++) out[i] = a[i] * b[i];
+        }
+
+        static inline void div(const T* a, const T* b, T* out) {
+            for (int i = 0; i < 4; i++) out[i] = a[i] / b[i];
+        }
+
+        static inline T dot(const T* a, const T* b) {
+            return a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+        }
+
+        // Cross product of the xyz part, w becomes a.w * b.w
+        static inline void cross(const T* a, const T* b, T* out) {
+            T x = a[1] * b[2] - a[2] * b[1];
+            T y = a[2] * b[0] - a[0] * b[2];
+            T z = a[0] * b[1] - a[1] * b[0];
+            T w = a[3] * b[3];
+            out[0] = x;
+            out[1] = y;
+            out[2] = z;
+            out[3] = w;
+        }
+
+        static inline void normalize(const T* a, T* out) {
+            T mag = (T)std::sqrt(dot(a, a));
+            for (int i = 0; i < 4; i++) out[i] = a[i] / mag;
+        }
+
+        static inline T distance(const T* a, const T* b) {
+            T sum = (T)0;
+            for (int i = 0; i < 4; i++) {
+                T d = a[i] - b[i];
+                sum += d * d;
+            }
+            return (T)std::sqrt(sum);
+        }
+    };
+
+#if defined(EXTLIB_SSE)
+    template<>
+    struct vec4<float> {
+        // Sum of all lanes, broadcast to every lane
+        static inline __m128 hsum(__m128 v) {
+            __m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+            __m128 sums = _mm_add_ps(v, shuf);
+            shuf = _mm_shuffle_ps(sums, sums, _MM_SHUFFLE(1, 0, 3, 2));
+            return _mm_add_ps(sums, shuf);
+        }
+
+        static inline void add(const float* a, const float* b, float* out) {
+            _mm_store_ps(out, _mm_add_ps(_mm_load_ps(a), _mm_load_ps(b)));
+        }
+
+        static inline void sub(const float* a, const float* b, float* out) {
+            _mm_store_ps(out, _mm_sub_ps(_mm_load_ps(a), _mm_load_ps(b)));
+        }
+
+        static inline void mul(const float* a, const float* b, float* out) {
+            _mm_store_ps(out, _mm_mul_ps(_mm_load_ps(a), _mm_load_ps(b)));
+        }
+
+        static inline void div(const float* a, const float* b, float* out) {
+            _mm_store_ps(out, _mm_div_ps(_mm_load_ps(a), _mm_load_ps(b)));
+        }
+
+        static inline float dot(const float* a, const float* b) {
+            return _mm_cvtss_f32(hsum(_mm_mul_ps(_mm_load_ps(a), _mm_load_ps(b))));
+        }
+
+        static inline void cross(const float* a, const float* b, float* out) {
+            __m128 va = _mm_load_ps(a);
+            __m128 vb = _mm_load_ps(b);
+            // (y, z, x, w) and (z, x, y, w) permutations
+            __m128 a_yzx = _mm_shuffle_ps(va, va, _MM_SHUFFLE(3, 0, 2, 1));
+            __m128 b_yzx = _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(3, 0, 2, 1));
+            __m128 a_zxy = _mm_shuffle_ps(va, va, _MM_SHUFFLE(3, 1, 0, 2));
+            __m128 b_zxy = _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(3, 1, 0, 2));
+            __m128 c = _mm_sub_ps(_mm_mul_ps(a_yzx, b_zxy), _mm_mul_ps(a_zxy, b_yzx));
+            // The w lane of c is zero, put a.w * b.w back in it
+            __m128 w = _mm_mul_ss(_mm_shuffle_ps(va, va, _MM_SHUFFLE(3, 3, 3, 3)), _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(3, 3, 3, 3)));
+            __m128 wz = _mm_shuffle_ps(c, w, _MM_SHUFFLE(0, 0, 2, 2));
+            _mm_store_ps(out, _mm_shuffle_ps(c, wz, _MM_SHUFFLE(2, 0, 1, 0)));
+        }
+
+        static inline void normalize(const float* a, float* out) {
+            __m128 va = _mm_load_ps(a);
+            __m128 mag = _mm_sqrt_ps(hsum(_mm_mul_ps(va, va)));
+            _mm_store_ps(out, _mm_div_ps(va, mag));
+        }
+
+        static inline float distance(const float* a, const float* b) {
+            __m128 d = _mm_sub_ps(_mm_load_ps(a), _mm_load_ps(b));
+            return _mm_cvtss_f32(_mm_sqrt_ss(hsum(_mm_mul_ps(d, d))));
+        }
+    };
+#endif
+
+#if defined(EXTLIB_AVX)
+    template<>
+    struct vec4<double> {
+        // Sum of all lanes
+        static inline __m128d hsum(__m256d v) {
+            __m128d lo = _mm256_castpd256_pd128(v);
+            __m128d hi = _mm256_extractf128_pd(v, 1);
+            lo = _mm_add_pd(lo, hi);
+            return _mm_add_sd(lo, _mm_unpackhi_pd(lo, lo));
+        }
+
+        static inline void add(const double* a, const double* b, double* out) {
+            _mm256_store_pd(out, _mm256_add_pd(_mm256_load_pd(a), _mm256_load_pd(b)));
+        }
+
+        static inline void sub(const double* a, const double* b, double* out) {
+            _mm256_store_pd(out, _mm256_sub_pd(_mm256_load_pd(a), _mm256_load_pd(b)));
+        }
+
+        static inline void mul(const double* a, const double* b, double* out) {
+            _mm256_store_pd(out, _mm256_mul_pd(_mm256_load_pd(a), _mm256_load_pd(b)));
+        }
+
+        static inline void div(const double* a, const double* b, double* out) {
+            _mm256_store_pd(out, _mm256_div_pd(_mm256_load_pd(a), _mm256_load_pd(b)));
+        }
+
+        static inline double dot(const double* a, const double* b) {
+            return _mm_cvtsd_f64(hsum(_mm256_mul_pd(_mm256_load_pd(a), _mm256_load_pd(b))));
+        }
+
+        static inline void cross(const double* a, const double* b, double* out) {
+            // Three lanes of work, the scalar version is as fast as shuffling across 128 bit halves
+            double x = a[1] * b[2] - a[2] * b[1];
+            double y = a[2] * b[0] - a[0] * b[2];
+            double z = a[0] * b[1] - a[1] * b[0];
+            _mm256_store_pd(out, _mm256_set_pd(a[3] * b[3], z, y, x));
+        }
+
+        static inline void normalize(const double* a, double* out) {
+            __m256d va = _mm256_load_pd(a);
+            __m128d sum = hsum(_mm256_mul_pd(va, va));
+            __m128d mag = _mm_sqrt_pd(_mm_unpacklo_pd(sum, sum));
+            _mm256_store_pd(out, _mm256_div_pd(va, _mm256_insertf128_pd(_mm256_castpd128_pd256(mag), mag, 1)));
+        }
+
+        static inline double distance(const double* a, const double* b) {
+            __m256d d = _mm256_sub_pd(_mm256_load_pd(a), _mm256_load_pd(b));
+            __m128d sum = hsum(_mm256_mul_pd(d, d));
+            return _mm_cvtsd_f64(_mm_sqrt_sd(sum, sum));
+        }
+    };
+#elif defined(EXTLIB_SSE2)
+    template<>
+    struct vec4<double> {
+        // Sum of both lanes
+        static inline __m128d hsum(__m128d v) {
+            return _mm_add_sd(v, _mm_unpackhi_pd(v, v));
+        }
+
+        static inline void add(const double* a, const double* b, double* out) {
+            _mm_store_pd(out, _mm_add_pd(_mm_load_pd(a), _mm_load_pd(b)));
+            _mm_store_pd(out + 2, _mm_add_pd(_mm_load_pd(a + 2), _mm_load_pd(b + 2)));
+        }
+
+        static inline void sub(const double* a, const double* b, double* out) {
+            _mm_store_pd(out, _mm_sub_pd(_mm_load_pd(a), _mm_load_pd(b)));
+            _mm_store_pd(out + 2, _mm_sub_pd(_mm_load_pd(a + 2), _mm_load_pd(b + 2)));
+        }
+
+        static inline void mul(const double* a, const double* b, double* out) {
+            _mm_store_pd(out, _mm_mul_pd(_mm_load_pd(a), _mm_load_pd(b)));
+            _mm_store_pd(out + 2, _mm_mul_pd(_mm_load_pd(a + 2), _mm_load_pd(b + 2)));
+        }
+
+        static inline void div(const double* a, const double* b, double* out) {
+            _mm_store_pd(out, _mm_div_pd(_mm_load_pd(a), _mm_load_pd(b)));
+            _mm_store_pd(out + 2, _mm_div_pd(_mm_load_pd(a + 2), _mm_load_pd(b + 2)));
+        }
+
+        static inline double dot(const double* a, const double* b) {
+            __m128d lo = _mm_mul_pd(_mm_load_pd(a), _mm_load_pd(b));
+            __m128d hi = _mm_mul_pd(_mm_load_pd(a + 2), _mm_load_pd(b + 2));
+            return _mm_cvtsd_f64(hsum(_mm_add_pd(lo, hi)));
+        }
+
+        static inline void cross(const double* a, const double* b, double* out) {
+            double x = a[1] * b[2] - a[2] * b[1];
+            double y = a[2] * b[0] - a[0] * b[2];
+            double z = a[0] * b[1] - a[1] * b[0];
+            _mm_store_pd(out, _mm_set_pd(y, x));
+            _mm_store_pd(out + 2, _mm_set_pd(a[3] * b[3], z));
+        }
+
+        static inline void normalize(const double* a, double* out) {
+            __m128d lo = _mm_load_pd(a);
+            __m128d hi = _mm_load_pd(a + 2);
+            __m128d sum = hsum(_mm_add_pd(_mm_mul_pd(lo, lo), _mm_mul_pd(hi, hi)));
+            __m128d mag = _mm_sqrt_pd(_mm_unpacklo_pd(sum, sum));
+            _mm_store_pd(out, _mm_div_pd(lo, mag));
+            _mm_store_pd(out + 2, _mm_div_pd(hi, mag));
+        }
+
+        static inline double distance(const double* a, const double* b) {
+            __m128d lo = _mm_sub_pd(_mm_load_pd(a), _mm_load_pd(b));
+            __m128d hi = _mm_sub_pd(_mm_load_pd(a + 2), _mm_load_pd(b + 2));
+            __m128d sum = hsum(_mm_add_pd(_mm_mul_pd(lo, lo), _mm_mul_pd(hi, hi)));
+            return _mm_cvtsd_f64(_mm_sqrt_sd(sum, sum));
+        }
+    };
+#endif
+
+    /**
+     * @brief Kernels for column major 4x4 matrices, pointers point to 16 contiguous elements aligned to vec4_alignment
+     *
+     * @tparam T Type of the elements
+     */
+    template<typename T>
+    struct mat4 {
+        static inline void mul(const T* a, const T* b, T* out) {
+            T tmp[16];
+            for (int c = 0; c < 4; c++) {
+                for (int r = 0; r < 4; r++) {
+                    T sum = (T)0;
+                    for (int k = 0; k < 4; k++) sum += a[k * 4 + r] * b[c * 4 + k];
+                    tmp[c * 4 + r] = sum;
+                }
+            }
+            for (int i = 0; i < 16; i++) out[i] = tmp[i];
+        }
+
+        static inline void transpose(const T* a, T* out) {
+            T tmp[16];
+            for (int c = 0; c < 4; c++) {
+                for (int r = 0; r < 4; r++) tmp[r * 4 + c] = a[c * 4 + r];
+            }
+            for (int i = 0; i < 16; i++) out[i] = tmp[i];
+        }
+
+        // out[i] = m * in[i] for n 4 component vectors
+        static inline void transform(const T* m, const T* in, T* out, std::size_t n) {
+            for (std::size_t i = 0; i < n; i++) {
+                const T* v = in + i * 4;
+                T x = v[0], y = v[1], z = v[2], w = v[3];
+                for (int r = 0; r < 4; r++) {
+                    out[i * 4 + r] = m[r] * x + m[4 + r] * y + m[8 + r] * z + m[12 + r] * w;
+                }
+            }
+        }
+    };
+
+#if defined(EXTLIB_SSE)
+    template<>
+    struct mat4<float> {
+        static inline __m128 column(__m128 c0, __m128 c1, __m128 c2, __m128 c3, __m128 v) {
+            __m128 r = _mm_mul_ps(c0, _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)));
+            r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))));
+            r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))));
+            return _mm_add_ps(r, _mm_mul_ps(c3, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))));
+        }
+
+        static inline void mul(const float* a, const float* b, float* out) {
+            __m128 c0 = _mm_load_ps(a);
+            __m128 c1 = _mm_load_ps(a + 4);
+            __m128 c2 = _mm_load_ps(a + 8);
+            __m128 c3 = _mm_load_ps(a + 12);
+            __m128 r0 = column(c0, c1, c2, c3, _mm_load_ps(b));
+            __m128 r1 = column(c0, c1, c2, c3, _mm_load_ps(b + 4));
+            __m128 r2 = column(c0, c1, c2, c3, _mm_load_ps(b + 8));
+            __m128 r3 = column(c0, c1, c2, c3, _mm_load_ps(b + 12));
+            _mm_store_ps(out, r0);
+            _mm_store_ps(out + 4, r1);
+            _mm_store_ps(out + 8, r2);
+            _mm_store_ps(out + 12, r3);
+        }
+
+        static inline void transpose(const float* a, float* out) {
+            __m128 c0 = _mm_load_ps(a);
+            __m128 c1 = _mm_load_ps(a + 4);
+            __m128 c2 = _mm_load_ps(a + 8);
+            __m128 c3 = _mm_load_ps(a + 12);
+            _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+            _mm_store_ps(out, c0);
+            _mm_store_ps(out + 4, c1);
+            _mm_store_ps(out + 8, c2);
+            _mm_store_ps(out + 12, c3);
+        }
+
+        static inline void transform(const float* m, const float* in, float* out, std::size_t n) {
+            __m128 c0 = _mm_load_ps(m);
+            __m128 c1 = _mm_load_ps(m + 4);
+            __m128 c2 = _mm_load_ps(m + 8);
+            __m128 c3 = _mm_load_ps(m + 12);
+            for (std::size_t i = 0; i < n; i++) {
+                _mm_store_ps(out + i * 4, column(c0, c1, c2, c3, _mm_load_ps(in + i * 4)));
+            }
+        }
+    };
+#endif
+
+#if defined(EXTLIB_AVX)
+    template<>
+    struct mat4<double> {
+        static inline __m256d column(__m256d c0, __m256d c1, __m256d c2, __m256d c3, const double* v) {
+            __m256d r = _mm256_mul_pd(c0, _mm256_broadcast_sd(v));
+            r = _mm256_add_pd(r, _mm256_mul_pd(c1, _mm256_broadcast_sd(v + 1)));
+            r = _mm256_add_pd(r, _mm256_mul_pd(c2, _mm256_broadcast_sd(v + 2)));
+            return _mm256_add_pd(r, _mm256_mul_pd(c3, _mm256_broadcast_sd(v + 3)));
+        }
+
+        static inline void mul(const double* a, const double* b, double* out) {
+            __m256d c0 = _mm256_load_pd(a);
+            __m256d c1 = _mm256_load_pd(a + 4);
+            __m256d c2 = _mm256_load_pd(a + 8);
+            __m256d c3 = _mm256_load_pd(a + 12);
+            __m256d r0 = column(c0, c1, c2, c3, b);
+            __m256d r1 = column(c0, c1, c2, c3, b + 4);
+            __m256d r2 = column(c0, c1, c2, c3, b + 8);
+            __m256d r3 = column(c0, c1, c2, c3, b + 12);
+            _mm256_store_pd(out, r0);
+            _mm256_store_pd(out + 4, r1);
+            _mm256_store_pd(out + 8, r2);
+            _mm256_store_pd(out + 12, r3);
+        }
+
+        static inline void transpose(const double* a, double* out) {
+            double tmp[16];
+            for (int c = 0; c < 4; c++) {
+                for (int r = 0; r < 4; r++) tmp[r * 4 + c] = a[c * 4 + r];
+            }
+            for (int i = 0; i < 16; i++) out[i] = tmp[i];
+        }
+
+        static inline void transform(const double* m, const double* in, double* out, std::size_t n) {
+            __m256d c0 = _mm256_load_pd(m);
+            __m256d c1 = _mm256_load_pd(m + 4);
+            __m256d c2 = _mm256_load_pd(m + 8);
+            __m256d c3 = _mm256_load_pd(m + 12);
+            for (std::size_t i = 0; i < n; i++) {
+                _mm256_store_pd(out + i * 4, column(c0, c1, c2, c3, in + i * 4));
+            }
+        }
+    };
+#endif
+}
+
+#endif
@@ -0,0 +1,432 @@
+#ifndef SPATIALHPP
+#define SPATIALHPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "geometry.hpp"
+#include "parallel.hpp"
+#include "vector.hpp"
+
+namespace spatial {
+
+    // Result of a nearest neighbour or radius query
+    template<typename T>
+    struct Neighbor {
+        std::uint32_t index;
+        T distance_squared;
+
+        constexpr bool operator < (const Neighbor<T> &other) const { return distance_squared < other.distance_squared; };
+    };
+
+    // Result of a ray query
+    template<typename T>
+    struct Hit {
+        std::uint32_t index = std::numeric_limits<std::uint32_t>::max();
+        T t = std::numeric_limits<T>::infinity();
+
+        constexpr bool valid() const { return index != std::numeric_limits<std::uint32_t>::max(); };
+    };
+
+    namespace detail {
+        // Number of tree levels that are built on their own thread
+        inline std::size_t spawn_depth(std::size_t threads) {
+            if (threads == 0) {
+                threads = parallel::threads();
+            }
+            std::size_t depth = 0;
+            while (((std::size_t)1 << depth) < threads) {
+                depth++;
+            }
+            return depth;
+        }
+
+        // Builds below this size are not worth a thread
+        constexpr std::size_t parallel_threshold = 4096;
+    }
+}
+
+/**
+ * @brief A kd-tree over a set of points, stored as a flat implicit tree of median splits
+ *
+ * Node i has its children at 2i + 1 and 2i + 2, the point range of every node follows from the
+ * point count so the nodes only store the split. Points are reordered into leaf order.
+ *
+ * @tparam T Type of the coordinates
+ */
+template<typename T>
+struct KdTree {
+    struct Node {
+        T split;
+        std::uint32_t axis;
+    };
+
+    std::vector<Vec3<T>> points;
+    std::vector<std::uint32_t> indices;
+    std::vector<Node> nodes;
+    std::size_t depth = 0;
+
+    inline KdTree() = default;
+
+    inline KdTree(std::span<const Vec3<T>> pts, std::size_t leaf_size = 8, std::size_t threads = 0) {
+        build(pts, leaf_size, threads);
+    }
+
+    inline std::size_t size() const { return points.size(); };
+
+    // Builds the tree, threads = 0 uses parallel::threads()
+    inline void build(std::span<const Vec3<T>> pts, std::size_t leaf_size = 8, std::size_t threads = 0) {
+        const std::size_t n = pts.size();
+        indices.resize(n);
+        for (std::size_t i = 0; i < n; i++) {
+            indices[i] = (std::uint32_t)i;
+        }
+        depth = 0;
+        leaf_size = std::max<std::size_t>(1, leaf_size);
+        while ((n >> depth) > leaf_size) {
+            depth++;
+        }
+        nodes.assign(((std::size_t)1 << depth) - 1, Node{ (T)0, 0 });
+        if (depth > 0) {
+            build_node(pts, 0, 0, n, 0, spatial::detail::spawn_depth(threads));
+        }
+        points.resize(n);
+        for (std::size_t i = 0; i < n; i++) {
+            points[i] = pts[indices[i]];
+        }
+    }
+
+    // Returns the k nearest points to query, sorted by distance
+    inline std::vector<spatial::Neighbor<T>> nearest(const Vec3<T> &query, std::size_t k) const {
+        std::vector<spatial::Neighbor<T>> out;
+        nearest(query, k, out);
+        return out;
+    }
+
+    // Stores the k nearest points to query in out, sorted by distance
+    inline void nearest(const Vec3<T> &query, std::size_t k, std::vector<spatial::Neighbor<T>> &out) const {
+        out.clear();
+        if (k == 0 || points.empty()) {
+            return;
+        }
+        // out is kept as a max heap on distance until the end
+        T worst = std::numeric_limits<T>::max();
+        visit(query, worst, [&](std::size_t i) {
+            T d = (points[i] - query).length_squared();
+            if (out.size() < k) {
+                out.push_back({ indices[i], d });
+                std::push_heap(out.begin(), out.end());
+                if (out.size() == k) {
+                    worst = out.front().distance_squared;
+                }
+            } else if (d < worst) {
+                std::pop_heap(out.begin(), out.end());
+                out.back() = { indices[i], d };
+                std::push_heap(out.begin(), out.end());
+                worst = out.front().distance_squared;
+            }
+        });
+        std::sort_heap(out.begin(), out.end());
+    }
+
+    // Stores every point within radius of query in out, unsorted
+    inline void radius(const Vec3<T> &query, T radius, std::vector<spatial::Neighbor<T>> &out) const {
+        out.clear();
+        T r2 = radius * radius;
+        visit(query, r2, [&](std::size_t i) {
+            T d = (points[i] - query).length_squared();
+            if (d <= r2) {
+                out.push_back({ indices[i], d });
+            }
+        });
+    }
+
+private:
+    static inline std::size_t middle(std::size_t begin, std::size_t end) {
+        return begin + (end - begin) / 2;
+    }
+
+    inline void build_node(std::span<const Vec3<T>> input, std::size_t node, std::size_t begin, std::size_t end, std::size_t level, std::size_t spawn) {
+        AABB<T> bounds;
+        for (std::size_t i = begin; i < end; i++) {
+            bounds.expand(input[indices[i]]);
+        }
+        std::uint32_t axis = (std::uint32_t)bounds.longest_axis();
+        std::size_t mid = middle(begin, end);
+        std::nth_element(indices.begin() + begin, indices.begin() + mid, indices.begin() + end, [&](std::uint32_t a, std::uint32_t b) {
+            return input[a].get(axis) < input[b].get(axis);
+        });
+
+        nodes[node] = Node{ input[indices[mid]].get(axis), axis };
+        if (level + 1 >= depth) {
+            return;
+        }
+        if (spawn > 0 && end - begin >= spatial::detail::parallel_threshold) {
+            std::thread left([&, node, begin, mid, level, spawn]() { build_node(input, 2 * node + 1, begin, mid, level + 1, spawn - 1); });
+            build_node(input, 2 * node + 2, mid, end, level + 1, spawn - 1);
+            left.join();
+        } else {
+            build_node(input, 2 * node + 1, begin, mid, level + 1, 0);
+            build_node(input, 2 * node + 2, mid, end, level + 1, 0);
+        }
+    }
+
+    // Calls leaf(i) for every point in a leaf that may be within bound of query, bound may shrink while visiting
+    template<typename F>
+    inline void visit(const Vec3<T> &query, const T &bound, F &&leaf) const {
+        struct Entry {
+            std::size_t node;
+            std::size_t begin;
+            std::size_t end;
+            std::size_t level;
+            T distance;
+        };
+        Entry stack[64];
+        std::size_t top = 0;
+        stack[top++] = { 0, 0, points.size(), 0, (T)0 };
+        while (top > 0) {
+            Entry e = stack[--top];
+            if (e.distance > bound) {
+                continue;
+            }
+            if (e.level == depth) {
+                for (std::size_t i = e.begin; i < e.end; i++) {
+                    leaf(i);
+                }
+                continue;
+            }
+            const Node &n = nodes[e.node];
+            std::size_t mid = middle(e.begin, e.end);
+            T diff = query.get(n.axis) - n.split;
+            Entry left = { 2 * e.node + 1, e.begin, mid, e.level + 1, e.distance };
+            Entry right = { 2 * e.node + 2, mid, e.end, e.level + 1, e.distance };
+            // The far side is pushed first so the near side is visited first
+            if (diff < (T)0) {
+                right.distance = diff * diff;
+                stack[top++] = right;
+                stack[top++] = left;
+            } else {
+                left.distance = diff * diff;
+                stack[top++] = left;
+                stack[top++] = right;
+            }
+        }
+    }
+};
+
+/**
+ * @brief A bounding volume hierarchy over a set of boxes, stored as a flat depth first node array
+ *
+ * The left child of an internal node directly follows it, the right child is at offset.
+ * Leaves reference count boxes starting at offset in the reordered box array.
+ *
+ * @tparam T Type of the coordinates
+ */
+template<typename T>
+struct Bvh {
+    struct Node {
+        AABB<T> bounds;
+        std::uint32_t offset;
+        std::uint32_t count;
+
+        constexpr bool leaf() const { return count != 0; };
+    };
+
+    std::vector<AABB<T>> boxes;
+    std::vector<std::uint32_t> indices;
+    std::vector<Node> nodes;
+
+    inline Bvh() = default;
+
+    inline Bvh(std::span<const AABB<T>> input, std::size_t leaf_size = 4, std::size_t threads = 0) {
+        build(input, leaf_size, threads);
+    }
+
+    inline std::size_t size() const { return boxes.size(); };
+
+    // Builds the hierarchy with median splits along the longest centroid axis, threads = 0 uses parallel::threads()
+    inline void build(std::span<const AABB<T>> input, std::size_t leaf_size = 4, std::size_t threads = 0) {
+        const std::size_t n = input.size();
+        indices.resize(n);
+        for (std::size_t i = 0; i < n; i++) {
+            indices[i] = (std::uint32_t)i;
+        }
+        nodes.clear();
+        boxes.clear();
+        if (n == 0) {
+            return;
+        }
+        nodes.reserve(2 * n / std::max<std::size_t>(1, leaf_size) + 1);
+        std::vector<Vec3<T>> centers(n);
+        for (std::size_t i = 0; i < n; i++) {
+            centers[i] = input[i].center();
+        }
+        build_node(input, centers, nodes, 0, n, std::max<std::size_t>(1, leaf_size), spatial::detail::spawn_depth(threads));
+        boxes.resize(n);
+        for (std::size_t i = 0; i < n; i++) {
+            boxes[i] = input[indices[i]];
+        }
+    }
+
+    // Finds the closest box hit by the ray
+    inline bool raycast(const Ray<T> &ray, spatial::Hit<T> &out) const {
+        return raycast(ray, [](const AABB<T> &box, const Ray<T> &r) {
+            T t;
+            return geometry::intersect(r, box, t) ? t : std::numeric_limits<T>::infinity();
+        }, out);
+    }
+
+    // Finds the closest primitive hit by the ray, hit(box, ray) returns the hit distance or infinity on a miss
+    template<typename F>
+    inline bool raycast(Ray<T> ray, F &&hit, spatial::Hit<T> &out) const {
+        out = spatial::Hit<T>();
+        if (nodes.empty()) {
+            return false;
+        }
+        std::uint32_t stack[64];
+        std::size_t top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node &n = nodes[stack[--top]];
+            T t;
+            if (!geometry::intersect(ray, n.bounds, t)) {
+                continue;
+            }
+            if (n.leaf()) {
+                for (std::uint32_t i = n.offset; i < n.offset + n.count; i++) {
+                    T d = hit(boxes[i], ray);
+                    if (d >= ray.tmin && d < ray.tmax) {
+                        ray.tmax = d;
+                        out.index = indices[i];
+                        out.t = d;
+                    }
+                }
+                continue;
+            }
+            // Visit the closer child first so tmax shrinks early
+            std::uint32_t self = (std::uint32_t)(&n - nodes.data());
+            std::uint32_t left = self + 1;
+            std::uint32_t right = n.offset;
+            T tl, tr;
+            bool hl = geometry::intersect(ray, nodes[left].bounds, tl);
+            bool hr = geometry::intersect(ray, nodes[right].bounds, tr);
+            if (hl && hr) {
+                if (tl <= tr) {
+                    stack[top++] = right;
+                    stack[top++] = left;
+                } else {
+                    stack[top++] = left;
+                    stack[top++] = right;
+                }
+            } else if (hl) {
+                stack[top++] = left;
+            } else if (hr) {
+                stack[top++] = right;
+            }
+        }
+        return out.valid();
+    }
+
+    // Stores the index of every box overlapping box in out
+    inline void overlap(const AABB<T> &box, std::vector<std::uint32_t> &out) const {
+        out.clear();
+        query([&](const AABB<T> &b) { return b.overlaps(box); }, [&](std::uint32_t i) { out.push_back(indices[i]); });
+    }
+
+    // Stores every box within radius of point in out, the distance is measured to the closest point of the box
+    inline void radius(const Vec3<T> &point, T radius, std::vector<spatial::Neighbor<T>> &out) const {
+        out.clear();
+        T r2 = radius * radius;
+        query([&](const AABB<T> &b) { return b.distance_squared(point) <= r2; }, [&](std::uint32_t i) {
+            out.push_back({ indices[i], boxes[i].distance_squared(point) });
+        });
+    }
+
+private:
+    // Visits every box whose node and own bounds pass test
+    template<typename Test, typename F>
+    inline void query(Test &&test, F &&found) const {
+        if (nodes.empty()) {
+            return;
+        }
+        std::uint32_t stack[64];
+        std::size_t top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            std::uint32_t index = stack[--top];
+            const Node &n = nodes[index];
+            if (!test(n.bounds)) {
+                continue;
+            }
+            if (n.leaf()) {
+                for (std::uint32_t i = n.offset; i < n.offset + n.count; i++) {
+                    if (test(boxes[i])) {
+                        found(i);
+                    }
+                }
+                continue;
+            }
+            stack[top++] = n.offset;
+            stack[top++] = index + 1;
+        }
+    }
+
+    // Appends the subtree over indices[begin, end) to out, child offsets are relative to the start of out
+    inline void build_node(std::span<const AABB<T>> input, const std::vector<Vec3<T>> &centers, std::vector<Node> &out, std::size_t begin, std::size_t end, std::size_t leaf_size, std::size_t spawn) {
+        AABB<T> bounds;
+        AABB<T> centroids;
+        for (std::size_t i = begin; i < end; i++) {
+            bounds.expand(input[indices[i]]);
+            centroids.expand(centers[indices[i]]);
+        }
+        std::size_t self = out.size();
+        out.push_back(Node{ bounds, (std::uint32_t)begin, (std::uint32_t)(end - begin) });
+        if (end - begin <= leaf_size) {
+            return;
+        }
+        std::size_t axis = centroids.longest_axis();
+        std::size_t mid = begin + (end - begin) / 2;
+        std::nth_element(indices.begin() + begin, indices.begin() + mid, indices.begin() + end, [&](std::uint32_t a, std::uint32_t b) {
+            return centers[a].get(axis) < centers[b].get(axis);
+        });
+
+        if (spawn > 0 && end - begin >= spatial::detail::parallel_threshold) {
+            // Both halves are built into their own arrays and appended, offsets are shifted to match
+            std::vector<Node> left_nodes;
+            std::vector<Node> right_nodes;
+            std::thread left([&]() { build_node(input, centers, left_nodes, begin, mid, leaf_size, spawn - 1); });
+            build_node(input, centers, right_nodes, mid, end, leaf_size, spawn - 1);
+            left.join();
+            append(out, left_nodes);
+            out[self].offset = (std::uint32_t)out.size();
+            append(out, right_nodes);
+        } else {
+            build_node(input, centers, out, begin, mid, leaf_size, 0);
+            out[self].offset = (std::uint32_t)out.size();
+            build_node(input, centers, out, mid, end, leaf_size, 0);
+        }
+        out[self].count = 0;
+    }
+
+    static inline void append(std::vector<Node> &out, const std::vector<Node> &nodes) {
+        std::uint32_t base = (std::uint32_t)out.size();
+        for (Node n : nodes) {
+            if (!n.leaf()) {
+                n.offset += base;
+            }
+            out.push_back(n);
+        }
+    }
+};
+
+using kdtreef = KdTree<float>;
+using kdtreed = KdTree<double>;
+using bvhf = Bvh<float>;
+using bvhd = Bvh<double>;
+
+#endif
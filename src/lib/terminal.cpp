@@ -0,0 +1,107 @@
+#include "./terminal.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace terminal {
+
+    namespace {
+        // Returns the variable, empty when it is not set
+        inline std::string_view environment(const char* name) {
+            const char* value = std::getenv(name);
+            return value != nullptr ? std::string_view(value) : std::string_view();
+        }
+
+        inline Capabilities& cached() {
+            static Capabilities value = detect();
+            return value;
+        }
+    }
+
+    Capabilities detect() {
+        Capabilities result;
+#if defined(_WIN32)
+        HANDLE handle = GetStdHandle(STD_OUTPUT_HANDLE);
+        DWORD mode = 0;
+        result.tty = GetConsoleMode(handle, &mode) != 0;
+        // Consoles before Windows 10 print escape sequences as text
+        const bool escapes = result.tty && SetConsoleMode(handle, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING) != 0;
+#else
+        result.tty = isatty(STDOUT_FILENO) != 0;
+        const bool escapes = result.tty;
+#endif
+        // https://no-color.org, any non empty value turns colours off
+        if (!environment("NO_COLOR").empty()) {
+            return result;
+        }
+        const std::string_view force = environment("FORCE_COLOR");
+        const bool forced = !force.empty() && force != "0" && force != "false";
+        if (!escapes && !forced) {
+            return result;
+        }
+
+        const std::string_view term = environment("TERM");
+        const std::string_view colorterm = environment("COLORTERM");
+        if (term == "dumb" && !forced) {
+            return result;
+        }
+        if (colorterm == "truecolor" || colorterm == "24bit" || term.find("direct") != std::string_view::npos) {
+            result.color = ColorSupport::truecolor;
+        } else if (term.find("256") != std::string_view::npos) {
+            result.color = ColorSupport::palette;
+        } else {
+            result.color = ColorSupport::basic;
+        }
+#if defined(_WIN32)
+        // The Windows 10 console and Windows Terminal draw 24 bit colours and set no TERM
+        if (escapes && term.empty()) {
+            result.color = ColorSupport::truecolor;
+        }
+#endif
+        return result;
+    }
+
+    const Capabilities& capabilities() {
+        return cached();
+    }
+
+    void set_capabilities(const Capabilities &capabilities) {
+        cached() = capabilities;
+    }
+
+    void write(std::string_view data) {
+#if defined(_WIN32)
+        HANDLE handle = GetStdHandle(STD_OUTPUT_HANDLE);
+        while (!data.empty()) {
+            DWORD written = 0;
+            const DWORD size = (DWORD)std::min<std::size_t>(data.size(), 1u << 30);
+            if (!WriteFile(handle, data.data(), size, &written, nullptr)) {
+                return;
+            }
+            data.remove_prefix(written);
+        }
+#else
+        while (!data.empty()) {
+            const ssize_t written = ::write(STDOUT_FILENO, data.data(), data.size());
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return;
+            }
+            data.remove_prefix((std::size_t)written);
+        }
+#endif
+    }
+}
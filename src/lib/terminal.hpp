@@ -0,0 +1,40 @@
+#ifndef TERMINALHPP
+#define TERMINALHPP
+
+#include <cstdint>
+#include <string_view>
+
+// Direct access to the process' standard output, below std::cout and stdio buffering
+namespace terminal {
+
+    // Colours stdout understands, each level also understands the ones below it
+    enum class ColorSupport : std::uint8_t {
+        none,       // Not a terminal, a dumb terminal or NO_COLOR is set
+        basic,      // The 16 colours of SGR 30 - 37 and 90 - 97
+        palette,    // The 256 colour palette, 38;5;n
+        truecolor,  // 24 bit colours, 38;2;r;g;b
+    };
+
+    struct Capabilities {
+        // Whether stdout is a terminal rather than a file or a pipe
+        bool tty = false;
+        ColorSupport color = ColorSupport::none;
+    };
+
+    // Inspects stdout and the environment, follows NO_COLOR and FORCE_COLOR, TERM and COLORTERM
+    // On Windows it also turns on escape sequence processing of the console
+    Capabilities detect();
+
+    // Returns the capabilities of stdout, detected on the first call
+    const Capabilities& capabilities();
+
+    // Replaces the detected capabilities, for a --color option or tests
+    // Not synchronized, call it before other threads write colours
+    void set_capabilities(const Capabilities &capabilities);
+
+    // Writes all of data to stdout, a single system call unless the system writes less than asked
+    // Does not flush std::cout or stdout, flush them first when their output has to come before data
+    void write(std::string_view data);
+}
+
+#endif
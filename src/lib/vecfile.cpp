@@ -0,0 +1,291 @@
+#include "./vecfile.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <utility>
+
+#include "./simd.hpp"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace vecfile {
+
+    std::size_t type_size(Type type) {
+        switch (type) {
+            case Type::i8: case Type::u8: case Type::unorm8:
+                return 1;
+            case Type::i16: case Type::u16: case Type::f16: case Type::snorm16:
+                return 2;
+            case Type::i32: case Type::u32: case Type::f32:
+                return 4;
+            case Type::i64: case Type::u64: case Type::f64:
+                return 8;
+        }
+        return 0;
+    }
+
+    namespace {
+        constexpr std::array<std::uint32_t, 256> crc_table() {
+            std::array<std::uint32_t, 256> table = {};
+            for (std::uint32_t i = 0; i < 256; i++) {
+                std::uint32_t c = i;
+                for (int k = 0; k < 8; k++) {
+                    c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+                }
+                table[i] = c;
+            }
+            return table;
+        }
+
+        constexpr std::array<std::uint32_t, 256> crc_lookup = crc_table();
+    }
+
+    std::uint32_t crc32c(const void* data, std::size_t size, std::uint32_t crc) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        crc = ~crc;
+#if defined(EXTLIB_SSE42)
+        // The crc32 instruction handles 8 bytes per cycle, the table one byte every few
+#if defined(__x86_64__) || defined(_M_X64)
+        std::uint64_t crc64 = crc;
+        for (; size >= 8; size -= 8, p += 8) {
+            std::uint64_t word;
+            std::memcpy(&word, p, sizeof(word));
+            crc64 = _mm_crc32_u64(crc64, word);
+        }
+        crc = (std::uint32_t)crc64;
+#endif
+        for (; size >= 4; size -= 4, p += 4) {
+            std::uint32_t word;
+            std::memcpy(&word, p, sizeof(word));
+            crc = _mm_crc32_u32(crc, word);
+        }
+#endif
+        for (; size > 0; size--, p++) {
+            crc = crc_lookup[(crc ^ *p) & 0xff] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    Mapping::Mapping(const std::string &path) {
+#if defined(_WIN32)
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            file = nullptr;
+            throw std::runtime_error("Could not open " + path);
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size)) {
+            release();
+            throw std::runtime_error("Could not read the size of " + path);
+        }
+        length = (std::size_t)size.QuadPart;
+        if (length == 0) {
+            return;
+        }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            release();
+            throw std::runtime_error("Could not map " + path);
+        }
+        begin = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (begin == nullptr) {
+            release();
+            throw std::runtime_error("Could not map " + path);
+        }
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open " + path);
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Could not read the size of " + path);
+        }
+        length = (std::size_t)info.st_size;
+        if (length == 0) {
+            ::close(fd);
+            return;
+        }
+        void* p = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping keeps its own reference to the file
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            length = 0;
+            throw std::runtime_error("Could not map " + path);
+        }
+        begin = static_cast<const std::byte*>(p);
+#endif
+    }
+
+    Mapping::~Mapping() {
+        release();
+    }
+
+    Mapping::Mapping(Mapping &&other) noexcept {
+        *this = std::move(other);
+    }
+
+    Mapping& Mapping::operator = (Mapping &&other) noexcept {
+        if (this != &other) {
+            release();
+            begin = std::exchange(other.begin, nullptr);
+            length = std::exchange(other.length, 0);
+#if defined(_WIN32)
+            file = std::exchange(other.file, nullptr);
+            mapping = std::exchange(other.mapping, nullptr);
+#endif
+        }
+        return *this;
+    }
+
+    void Mapping::release() {
+#if defined(_WIN32)
+        if (begin != nullptr) {
+            UnmapViewOfFile(begin);
+        }
+        if (mapping != nullptr) {
+            CloseHandle(mapping);
+        }
+        if (file != nullptr) {
+            CloseHandle(file);
+        }
+        mapping = nullptr;
+        file = nullptr;
+#else
+        if (begin != nullptr) {
+            ::munmap(const_cast<std::byte*>(begin), length);
+        }
+#endif
+        begin = nullptr;
+        length = 0;
+    }
+
+    RawWriter::RawWriter(const std::string &path, Header header) : header(header) {
+        stream.open(path, std::ios::binary | std::ios::trunc);
+        if (!stream) {
+            throw std::runtime_error("Could not open " + path);
+        }
+        // Written now so an unfinished file is still a valid empty one
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        for (std::uint64_t i = sizeof(Header); i < header.offset; i++) {
+            stream.put(0);
+        }
+        if (!stream) {
+            throw std::runtime_error("Could not write " + path);
+        }
+        open = true;
+    }
+
+    RawWriter::~RawWriter() = default;
+
+    void RawWriter::append(const void* data, std::size_t size) {
+        if (!open) {
+            throw std::logic_error("Writer is already finished");
+        }
+        if (size == 0) {
+            return;
+        }
+        stream.write(static_cast<const char*>(data), (std::streamsize)size);
+        if (!stream) {
+            throw std::runtime_error("Could not write vector file");
+        }
+        if (header.flags & flags::checksum) {
+            crc = crc32c(data, size, crc);
+        }
+        bytes += size;
+    }
+
+    void RawWriter::pad(std::size_t alignment) {
+        static constexpr char zeros[64] = {};
+        std::size_t rest = (std::size_t)((alignment - bytes % alignment) % alignment);
+        while (rest > 0) {
+            std::size_t n = std::min(rest, sizeof(zeros));
+            append(zeros, n);
+            rest -= n;
+        }
+    }
+
+    void RawWriter::finish(std::uint64_t count, std::uint64_t stride) {
+        if (!open) {
+            throw std::logic_error("Writer is already finished");
+        }
+        header.count = count;
+        header.stride = stride;
+        header.checksum = (header.flags & flags::checksum) ? crc : 0;
+        stream.seekp(0);
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        stream.close();
+        open = false;
+        if (!stream) {
+            throw std::runtime_error("Could not write vector file");
+        }
+    }
+
+    Reader::Reader(const std::string &path, bool verify) : map(path) {
+        if (map.size() < sizeof(Header)) {
+            throw std::runtime_error(path + " is not a vector file");
+        }
+        const Header &h = header();
+        if (!std::equal(std::begin(magic), std::end(magic), h.magic)) {
+            throw std::runtime_error(path + " is not a vector file");
+        }
+        if (h.version == 0 || h.version > version) {
+            throw std::runtime_error(path + " has an unsupported version");
+        }
+        std::size_t element = type_size(h.type);
+        if (element == 0 || h.dimension == 0 || (h.layout != Layout::aos && h.layout != Layout::soa)) {
+            throw std::runtime_error(path + " has an unsupported element type");
+        }
+        if (h.alignment == 0 || (h.alignment & (h.alignment - 1)) != 0 || h.offset < sizeof(Header) || h.offset % h.alignment != 0 || h.offset > map.size()) {
+            throw std::runtime_error(path + " has a corrupt header");
+        }
+        // Divisions instead of products so a corrupt count can not overflow
+        std::uint64_t available = map.size() - h.offset;
+        bool fits;
+        if (h.layout == Layout::aos) {
+            fits = h.count <= available / element / h.dimension;
+        } else {
+            fits = h.count <= available / element
+                && (h.dimension == 1 || (h.stride >= h.count * element && h.stride % h.alignment == 0
+                    && h.stride <= (available - h.count * element) / (h.dimension - 1)));
+        }
+        if (!fits) {
+            throw std::runtime_error(path + " is truncated");
+        }
+        if (verify && !this->verify()) {
+            throw std::runtime_error(path + " failed the checksum");
+        }
+    }
+
+    bool Reader::verify() const {
+        if (!(header().flags & flags::checksum)) {
+            return true;
+        }
+        std::span<const std::byte> bytes = data();
+        return crc32c(bytes.data(), bytes.size()) == header().checksum;
+    }
+
+    void Reader::check(Type type, std::size_t dimension, Layout layout, std::size_t alignment) const {
+        if (header().type != type || header().dimension != dimension) {
+            throw std::invalid_argument("Vector type does not match the file");
+        }
+        if (header().layout != layout) {
+            throw std::invalid_argument("Vector layout does not match the file");
+        }
+        if (reinterpret_cast<std::uintptr_t>(data().data()) % alignment != 0) {
+            throw std::runtime_error("Vector data is misaligned");
+        }
+    }
+}
@@ -0,0 +1,330 @@
+#ifndef VECFILEHPP
+#define VECFILEHPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "packed.hpp"
+#include "vector.hpp"
+#include "vectorarray.hpp"
+
+// Binary container for Vec arrays, loaded by memory mapping the file instead of parsing it
+//
+// Layout, all little endian:
+//   Header         64 bytes, see vecfile::Header
+//   padding        zeros up to header.offset, a multiple of header.alignment
+//   data           aos: count vectors back to back
+//                  soa: dimension lanes of count components, lane i starts at offset + i * stride
+// The optional checksum is a CRC-32C of every byte from header.offset to the end of the file.
+namespace vecfile {
+
+    static_assert(std::endian::native == std::endian::little, "vecfile is only implemented for little endian hosts");
+
+    inline constexpr char magic[8] = { 'E', 'X', 'T', 'V', 'E', 'C', '\r', '\n' };
+    inline constexpr std::uint32_t version = 1;
+
+    enum class Type : std::uint32_t {
+        i8 = 1, u8, i16, u16, i32, u32, i64, u64, f32, f64, f16, snorm16, unorm8
+    };
+
+    enum class Layout : std::uint32_t {
+        aos = 0, // Vec<T, N> after each other
+        soa = 1  // One lane per component, like VecArray
+    };
+
+    namespace flags {
+        // header.checksum holds the CRC-32C of the data
+        inline constexpr std::uint32_t checksum = 1;
+    }
+
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        Type type;
+        std::uint32_t dimension;
+        Layout layout;
+        std::uint64_t count;
+        std::uint64_t alignment;
+        std::uint64_t offset;
+        // Distance between soa lanes in bytes, 0 for aos
+        std::uint64_t stride;
+        std::uint32_t flags;
+        std::uint32_t checksum;
+    };
+
+    static_assert(sizeof(Header) == 64, "Header has to be 64 bytes");
+
+    // Returns the Type stored for components of type T
+    template<typename T>
+    constexpr Type type_of() {
+        if constexpr (std::is_same_v<T, float>) {
+            return Type::f32;
+        } else if constexpr (std::is_same_v<T, double>) {
+            return Type::f64;
+        } else if constexpr (std::is_same_v<T, half>) {
+            return Type::f16;
+        } else if constexpr (std::is_same_v<T, snorm16>) {
+            return Type::snorm16;
+        } else if constexpr (std::is_same_v<T, unorm8>) {
+            return Type::unorm8;
+        } else {
+            static_assert(std::is_integral_v<T> && !std::is_same_v<T, bool>, "Unsupported component type");
+            constexpr bool s = std::is_signed_v<T>;
+            if constexpr (sizeof(T) == 1) {
+                return s ? Type::i8 : Type::u8;
+            } else if constexpr (sizeof(T) == 2) {
+                return s ? Type::i16 : Type::u16;
+            } else if constexpr (sizeof(T) == 4) {
+                return s ? Type::i32 : Type::u32;
+            } else {
+                static_assert(sizeof(T) == 8, "Unsupported component type");
+                return s ? Type::i64 : Type::u64;
+            }
+        }
+    }
+
+    // Returns the size in bytes of one component of the given type, 0 for unknown types
+    std::size_t type_size(Type type);
+
+    // CRC-32C (Castagnoli), pass the previous result as crc to continue a running checksum
+    std::uint32_t crc32c(const void* data, std::size_t size, std::uint32_t crc = 0);
+
+    /**
+     * @brief A read only memory mapping of a whole file, movable but not copyable
+     */
+    class Mapping {
+    public:
+        Mapping() = default;
+        explicit Mapping(const std::string &path);
+        ~Mapping();
+
+        Mapping(Mapping &&other) noexcept;
+        Mapping& operator = (Mapping &&other) noexcept;
+        Mapping(const Mapping&) = delete;
+        Mapping& operator = (const Mapping&) = delete;
+
+        inline const std::byte* data() const { return begin; };
+        inline std::size_t size() const { return length; };
+
+    private:
+        void release();
+
+        const std::byte* begin = nullptr;
+        std::size_t length = 0;
+#if defined(_WIN32)
+        void* file = nullptr;
+        void* mapping = nullptr;
+#endif
+    };
+
+    /**
+     * @brief Building block of the writers, appends bytes and patches the header when finished
+     */
+    class RawWriter {
+    public:
+        RawWriter(const std::string &path, Header header);
+        ~RawWriter();
+
+        RawWriter(const RawWriter&) = delete;
+        RawWriter& operator = (const RawWriter&) = delete;
+
+        void append(const void* data, std::size_t size);
+        // Appends zeros until the data size is a multiple of alignment
+        void pad(std::size_t alignment);
+        // Writes the final header, further appends throw
+        void finish(std::uint64_t count, std::uint64_t stride);
+
+        inline std::uint64_t written() const { return bytes; };
+        inline bool is_open() const { return open; };
+
+    private:
+        std::ofstream stream;
+        Header header;
+        std::uint64_t bytes = 0;
+        std::uint32_t crc = 0;
+        bool open = false;
+    };
+
+    inline Header make_header(Type type, std::size_t dimension, Layout layout, std::size_t alignment, bool checksum) {
+        if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+            throw std::invalid_argument("Alignment has to be a power of two");
+        }
+        Header header = {};
+        std::copy(std::begin(magic), std::end(magic), header.magic);
+        header.version = version;
+        header.type = type;
+        header.dimension = (std::uint32_t)dimension;
+        header.layout = layout;
+        header.alignment = alignment;
+        header.offset = (sizeof(Header) + alignment - 1) / alignment * alignment;
+        header.flags = checksum ? flags::checksum : 0;
+        return header;
+    }
+
+    /**
+     * @brief Streams Vec<T, N> into an aos file, the header is completed by close() or the destructor
+     *
+     * @tparam T Type of the components
+     * @tparam N Number of components
+     */
+    template<typename T, std::size_t N>
+    class Writer {
+    public:
+        static_assert(sizeof(Vec<T, N>) == N * sizeof(T), "Vec has to be tightly packed");
+
+        inline explicit Writer(const std::string &path, bool checksum = true, std::size_t alignment = 64)
+            : raw(path, make_header(type_of<T>(), N, Layout::aos, alignment, checksum)) {}
+
+        inline ~Writer() {
+            if (raw.is_open()) {
+                try {
+                    close();
+                } catch (...) {
+                }
+            }
+        }
+
+        inline void write(std::span<const Vec<T, N>> vecs) {
+            raw.append(vecs.data(), vecs.size_bytes());
+            count += vecs.size();
+        }
+
+        inline void write(const Vec<T, N> &vec) {
+            write(std::span<const Vec<T, N>>(&vec, 1));
+        }
+
+        inline void close() {
+            raw.finish(count, 0);
+        }
+
+        // Returns the number of vectors written so far
+        inline std::size_t size() const { return count; };
+
+    private:
+        RawWriter raw;
+        std::size_t count = 0;
+    };
+
+    // Writes vecs as an aos file
+    template<typename T, std::size_t N>
+    inline void save(const std::string &path, std::span<const Vec<T, N>> vecs, bool checksum = true, std::size_t alignment = 64) {
+        Writer<T, N> writer(path, checksum, alignment);
+        writer.write(vecs);
+        writer.close();
+    }
+
+    // Writes the lanes of array as a soa file, every lane starts at a multiple of alignment
+    template<typename T, std::size_t N>
+    inline void save(const std::string &path, const VecArray<T, N> &array, bool checksum = true, std::size_t alignment = 64) {
+        RawWriter raw(path, make_header(type_of<T>(), N, Layout::soa, alignment, checksum));
+        const std::uint64_t bytes = array.size() * sizeof(T);
+        for (std::size_t i = 0; i < N; i++) {
+            raw.append(array.lane(i), bytes);
+            if (i + 1 < N) {
+                raw.pad(alignment);
+            }
+        }
+        raw.finish(array.size(), (bytes + alignment - 1) / alignment * alignment);
+    }
+
+    /**
+     * @brief Read only view of the lanes of a soa file, used like a VecArray without owning the data
+     *
+     * @tparam T Type of the components
+     * @tparam N Number of components
+     */
+    template<typename T, std::size_t N>
+    struct LaneView {
+        using value_type = Vec<T, N>;
+
+        std::array<std::span<const T>, N> lanes;
+
+        inline std::size_t size() const { return lanes[0].size(); };
+        inline bool empty() const { return lanes[0].empty(); };
+        inline static constexpr std::size_t dimensions() { return N; };
+
+        // Returns the raw pointer to a lane
+        inline const T* lane(std::size_t index) const { return lanes[index].data(); };
+
+        inline const T* x() const { return lane(0); };
+        inline const T* y() const { return lane(1); };
+        inline const T* z() const requires (N >= 3) { return lane(2); };
+        inline const T* w() const requires (N >= 4) { return lane(3); };
+
+        inline value_type get(std::size_t index) const {
+            value_type out;
+            for (std::size_t i = 0; i < N; i++) {
+                out.get(i) = lanes[i][index];
+            }
+            return out;
+        }
+
+        inline value_type operator [] (std::size_t index) const { return get(index); };
+
+        // Copies the lanes into a VecArray for the soa kernels
+        inline VecArray<T, N> to_array() const {
+            VecArray<T, N> out(size());
+            for (std::size_t i = 0; i < N; i++) {
+                std::copy(lanes[i].begin(), lanes[i].end(), out.lane(i));
+            }
+            return out;
+        }
+    };
+
+    /**
+     * @brief Memory maps a vector file and hands out views into it, the views are valid as long as the Reader lives
+     */
+    class Reader {
+    public:
+        // Validates the header, verify also checks the checksum which reads the whole file
+        explicit Reader(const std::string &path, bool verify = false);
+
+        inline const Header& header() const { return *reinterpret_cast<const Header*>(map.data()); };
+        inline std::size_t size() const { return (std::size_t)header().count; };
+        inline Type type() const { return header().type; };
+        inline std::size_t dimension() const { return header().dimension; };
+        inline Layout layout() const { return header().layout; };
+
+        // Returns every byte after the header padding
+        inline std::span<const std::byte> data() const {
+            return std::span<const std::byte>(map.data() + header().offset, map.size() - header().offset);
+        }
+
+        // Returns true when the file has no checksum or it matches
+        bool verify() const;
+
+        // Returns the vectors of an aos file
+        template<typename T, std::size_t N>
+        inline std::span<const Vec<T, N>> view() const {
+            static_assert(sizeof(Vec<T, N>) == N * sizeof(T), "Vec has to be tightly packed");
+            check(type_of<T>(), N, Layout::aos, alignof(Vec<T, N>));
+            return std::span<const Vec<T, N>>(reinterpret_cast<const Vec<T, N>*>(data().data()), size());
+        }
+
+        // Returns the lanes of a soa file
+        template<typename T, std::size_t N>
+        inline LaneView<T, N> lanes() const {
+            check(type_of<T>(), N, Layout::soa, alignof(T));
+            LaneView<T, N> out;
+            for (std::size_t i = 0; i < N; i++) {
+                out.lanes[i] = std::span<const T>(reinterpret_cast<const T*>(data().data() + i * header().stride), size());
+            }
+            return out;
+        }
+
+    private:
+        void check(Type type, std::size_t dimension, Layout layout, std::size_t alignment) const;
+
+        Mapping map;
+    };
+}
+
+#endif
@@ -1,800 +1,505 @@
 #ifndef VECTORHPP
 #define VECTORHPP
 #define _USE_MATH_DEFINES
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
 #include <iosfwd>
 #include <math.h>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "math.hpp"
+#include "simd.hpp"
 
 /**
- * @brief A vector2
- * 
- * @tparam T Type of the vector2
+ * @brief Named component storage of a vector
+ *
+ * @tparam T Type of the components
+ * @tparam N Number of components
  */
-template<typename T>
-struct Vec2 {
-    T x;
-    T y;
-
-    inline const Vec2<T> operator + (Vec2<T> other) { return {x + other.x, y + other.y }; };
-    inline const Vec2<T> operator - (Vec2<T> other) { return {x - other.x, y - other.y }; };
-    inline const Vec2<T> operator * (Vec2<T> other) { return {x * other.x, y * other.y }; };
-    inline const Vec2<T> operator / (Vec2<T> other) { return {x / other.x, y / other.y }; };
-
-    inline T& operator [] (int index) {
-        switch(index) {
-            case 0:
-            return x;
-
-            case 1:
-            return y;
-
-            default:
-            throw std::out_of_range("Out of range item");
-            return x;
-        }
-    }
-
-    inline friend std::ostream& operator<<(std::ostream& os, const Vec2<T>& vec)
-    {
-        os << vec.x << ", " << vec.y;
-        return os;
-    }
-
-    template <typename T2>
-    inline Vec2(const Vec2<T2> &other) {
-        this->x = (T)other.x;
-        this->y = (T)other.y;
-    }; 
-
-    inline Vec2(const T x, const T y) {
-        this->x = x;
-        this->y = y;
-        return;
-    }
-
-    inline Vec2(const T x) {
-        this->x = x;
-        this->y = (T)0;
-        return;
-    }
+template<typename T, std::size_t N>
+struct VecStorage {
+    T e[N] = {};
+};
 
-    inline Vec2() {
-        this->x = (T)0;
-        this->y = (T)0;
-        return;
-    }
-    
-    // Returns the dot product of two vectors
-    inline T dot(const Vec2<T> &other) {
-        return x * other.x + y * other.y ;
-    }
+template<typename T>
+struct VecStorage<T, 2> {
+    T x{};
+    T y{};
 
-    // Returns the cross product of two vectors
-    inline Vec2<T> cross(const Vec2<T> &other) {
-        return {y * other.x - x * other.y, x * other.y - y * other.x};
-    }
-    
-    // Returns the magnitude of the vector
-    inline T magnitude() {
-        return std::sqrt(x * x + y * y);
-    }
-    
-    // Returns the normalized vector
-    inline Vec2<T> normalize() {
-        T mag = magnitude();
-        return {x / mag, y / mag};
-    }
+    static constexpr T VecStorage::* members[2] = { &VecStorage::x, &VecStorage::y };
+};
 
-    // Returns the length of the vector
-    inline T length() {
-        return std::sqrt(x * x + y * y);
-    }
+template<typename T>
+struct VecStorage<T, 3> {
+    T x{};
+    T y{};
+    T z{};
 
-    // Returns the distance between two vectors
-    inline T distance(const Vec2<T> &other) {
-        return std::sqrt(std::pow(x - other.x, 2) + std::pow(y - other.y, 2));
-    }
+    static constexpr T VecStorage::* members[3] = { &VecStorage::x, &VecStorage::y, &VecStorage::z };
+};
 
-    // Returns the angle between two vectors
-    inline T angle(const Vec2<T> &other) {
-        return std::acos(dot(other) / (magnitude() * other.magnitude()));
-    }
+// float and double vector4s are aligned so they can be loaded into one SIMD register
+template<typename T>
+struct alignas(simd::vec4_alignment<T>) VecStorage<T, 4> {
+    T x{};
+    T y{};
+    T z{};
+    T w{};
 
-    // Returns the angle between two vectors in radians
-    inline T angle_rad(const Vec2<T> &other) {
-        return std::acos(dot(other) / (magnitude() * other.magnitude()));
-    }
-    
-    // Returns the angle between two vectors in degrees
-    inline T angle_deg(const Vec2<T> &other) {
-        return std::acos(dot(other) / (magnitude() * other.magnitude())) * 180 / M_PI;
-    }
+    static constexpr T VecStorage::* members[4] = { &VecStorage::x, &VecStorage::y, &VecStorage::z, &VecStorage::w };
+};
 
+template<typename T>
+struct VecStorage<T, 5> {
+    T x{};
+    T y{};
+    T z{};
+    T w{};
+    T v{};
+
+    static constexpr T VecStorage::* members[5] = { &VecStorage::x, &VecStorage::y, &VecStorage::z, &VecStorage::w, &VecStorage::v };
 };
 
-/**
- * @brief A vector3
- * 
- * @tparam T Type of the vector3
- */
 template<typename T>
-struct Vec3 {
-    T x;
-    T y;
-    T z;
+struct VecStorage<T, 6> {
+    T x{};
+    T y{};
+    T z{};
+    T w{};
+    T v{};
+    T u{};
+
+    static constexpr T VecStorage::* members[6] = { &VecStorage::x, &VecStorage::y, &VecStorage::z, &VecStorage::w, &VecStorage::v, &VecStorage::u };
+};
 
-    inline const Vec3<T> operator + (Vec3<T> other) { return {x + other.x, y + other.y, z + other.z }; };
-    inline const Vec3<T> operator - (Vec3<T> other) { return {x - other.x, y - other.y, z - other.z }; };
-    inline const Vec3<T> operator * (Vec3<T> other) { return {x * other.x, y * other.y, z * other.z }; };
-    inline const Vec3<T> operator / (Vec3<T> other) { return {x / other.x, y / other.y, z / other.z }; };
+template<typename T, std::size_t N>
+struct Vec;
+
+// Expression templates, lets compound expressions like lazy(a) + b * c - d evaluate in a single pass
+namespace vecexpr {
+
+    // Base of every expression node
+    template<typename E>
+    struct Expr {};
+
+    template<typename E>
+    constexpr bool is_expr = std::is_base_of_v<Expr<E>, E>;
+
+    // Square root usable in constant expressions
+    template<typename T>
+    constexpr T sqrt(T value) {
+        // Types like Fixed bring their own square root
+        if constexpr (requires { { value.sqrt() } -> std::same_as<T>; }) {
+            return value.sqrt();
+        } else {
+            if (std::is_constant_evaluated()) {
+                if constexpr (std::is_floating_point_v<T>) {
+                    if (!(value > (T)0)) {
+                        return value == (T)0 ? (T)0 : (T)NAN;
+                    }
+                    T guess = value > (T)1 ? value : (T)1;
+                    for (int i = 0; i < 128; i++) {
+                        T next = (guess + value / guess) / (T)2;
+                        if (next >= guess) {
+                            break;
+                        }
+                        guess = next;
+                    }
+                    return guess;
+                } else {
+                    if (value <= (T)0) {
+                        return (T)0;
+                    }
+                    T guess = value;
+                    T next = (guess + 1) / 2;
+                    while (next < guess) {
+                        guess = next;
+                        next = (guess + value / guess) / 2;
+                    }
+                    return guess;
+                }
+            }
+            return (T)std::sqrt(value);
+        }
+    }
 
-    inline T& operator [] (int index) {
-        switch(index) {
-            case 0:
-            return x;
+    // Reference to a vector inside an expression
+    template<typename T, std::size_t N>
+    struct Ref : Expr<Ref<T, N>> {
+        using value_type = T;
+        static constexpr std::size_t size = N;
 
-            case 1:
-            return y;
+        const Vec<T, N> &vec;
 
-            case 2:
-            return z;
+        constexpr Ref(const Vec<T, N> &vec) : vec(vec) {};
+        constexpr T operator [] (std::size_t index) const { return vec.get(index); };
+    };
 
-            default:
-            throw std::out_of_range("Out of range item");
-            return x;
-        }
-    }
+    // Scalar broadcast to every component
+    template<typename T, std::size_t N>
+    struct Scalar : Expr<Scalar<T, N>> {
+        using value_type = T;
+        static constexpr std::size_t size = N;
 
-    inline friend std::ostream& operator<<(std::ostream& os, const Vec3<T>& vec)
-    {
-        os << vec.x << ", " << vec.y << ", " << vec.z;
-        return os;
-    }
+        T value;
 
-    template <typename T2>
-    inline Vec3(const Vec3<T2> &other) {
-        this->x = (T)other.x;
-        this->y = (T)other.y;
-        this->z = (T)other.z;
-    }; 
-    
-    inline Vec3(const T x, const T y, const T z) {
-        this->x = x;
-        this->y = y;
-        this->z = z;
-        return;
-    }
+        constexpr Scalar(T value) : value(value) {};
+        constexpr T operator [] (std::size_t) const { return value; };
+    };
 
+    struct Add { template<typename T> static constexpr T apply(T a, T b) { return a + b; }; };
+    struct Sub { template<typename T> static constexpr T apply(T a, T b) { return a - b; }; };
+    struct Mul { template<typename T> static constexpr T apply(T a, T b) { return a * b; }; };
+    struct Div { template<typename T> static constexpr T apply(T a, T b) { return a / b; }; };
 
-    inline Vec3(const T x, const T y) {
-        this->x = x;
-        this->y = y;
-        this->z = (T)0;
-        return;
-    }
+    // Component wise binary operation
+    template<typename Op, typename L, typename R>
+    struct Binary : Expr<Binary<Op, L, R>> {
+        using value_type = typename L::value_type;
+        static constexpr std::size_t size = L::size;
+        static_assert(L::size == R::size, "Vector sizes do not match");
 
-    inline Vec3(const T x) {
-        this->x = x;
-        this->y = (T)0;
-        this->z = (T)0;
-        return;
-    }
+        L l;
+        R r;
 
-    inline Vec3() {
-        this->x = (T)0;
-        this->y = (T)0;
-        this->z = (T)0;
-        return;
-    }
+        constexpr Binary(L l, R r) : l(l), r(r) {};
+        constexpr value_type operator [] (std::size_t index) const { return Op::apply(l[index], r[index]); };
+    };
 
-    template <typename T2>
-    inline Vec3(const Vec2<T2> &other) {
-        this->x = (T)other.x;
-        this->y = (T)other.y;
-        this->z = (T)0;
+    // Wraps vectors into references, keeps expressions as they are
+    template<typename E>
+    constexpr const E& wrap(const E &e) requires is_expr<E> { return e; };
+    template<typename T, std::size_t N>
+    constexpr Ref<T, N> wrap(const Vec<T, N> &vec) { return Ref<T, N>(vec); };
+
+    template<typename E>
+    using wrapped = std::remove_cvref_t<decltype(wrap(std::declval<const E&>()))>;
+
+    // At least one side has to be an expression, plain vectors use the eager operators
+    template<typename L, typename R>
+    concept operands = (is_expr<L> || is_expr<R>) && requires (const L &l, const R &r) { wrap(l); wrap(r); };
+
+    template<typename L, typename R>
+    constexpr auto operator + (const L &l, const R &r) requires operands<L, R> { return Binary<Add, wrapped<L>, wrapped<R>>(wrap(l), wrap(r)); };
+    template<typename L, typename R>
+    constexpr auto operator - (const L &l, const R &r) requires operands<L, R> { return Binary<Sub, wrapped<L>, wrapped<R>>(wrap(l), wrap(r)); };
+    template<typename L, typename R>
+    constexpr auto operator * (const L &l, const R &r) requires operands<L, R> { return Binary<Mul, wrapped<L>, wrapped<R>>(wrap(l), wrap(r)); };
+    template<typename L, typename R>
+    constexpr auto operator / (const L &l, const R &r) requires operands<L, R> { return Binary<Div, wrapped<L>, wrapped<R>>(wrap(l), wrap(r)); };
+
+    template<typename E>
+    constexpr auto operator * (const E &e, typename E::value_type s) requires is_expr<E> {
+        return Binary<Mul, E, Scalar<typename E::value_type, E::size>>(e, s);
     };
-    
-    // Returns the dot product of two vectors
-    inline T dot(const Vec3<T> &other) {
-        return x * other.x + y * other.y + z * other.z;
-    }
+    template<typename E>
+    constexpr auto operator / (const E &e, typename E::value_type s) requires is_expr<E> {
+        return Binary<Div, E, Scalar<typename E::value_type, E::size>>(e, s);
+    };
+}
 
-    // Returns the cross product of two vectors
-    inline Vec3<T> cross(const Vec3<T> &other) {
-        return {y * other.z - z * other.y, z * other.x - x * other.z, x * other.y - y * other.x};
-    }
-    
-    // Returns the magnitude of the vector
-    inline T magnitude() {
-        return std::sqrt(x * x + y * y + z * z);
-    }
-    
-    // Returns the normalized vector
-    inline Vec3<T> normalize() {
-        T mag = magnitude();
-        return {x / mag, y / mag, z / mag};
-    }
+// Starts a lazily evaluated expression, the result has to be assigned to a Vec before the operands go out of scope
+template<typename T, std::size_t N>
+constexpr vecexpr::Ref<T, N> lazy(const Vec<T, N> &vec) {
+    return vecexpr::Ref<T, N>(vec);
+}
 
-    // Returns the length of the vector
-    inline T length() {
-        return std::sqrt(x * x + y * y + z * z);
-    }
+/**
+ * @brief A vector with N components, Vec2 up to Vec6 are aliases of it
+ *
+ * @tparam T Type of the vector
+ * @tparam N Number of components
+ */
+template<typename T, std::size_t N>
+struct Vec : VecStorage<T, N> {
+    static_assert(N > 0, "A vector needs at least one component");
 
-    // Returns the distance between two vectors
-    inline T distance(const Vec3<T> &other) {
-        return std::sqrt(std::pow(x - other.x, 2) + std::pow(y - other.y, 2) + std::pow(z - other.z, 2));
-    }
+    using value_type = T;
+    static constexpr std::size_t size = N;
 
-    // Returns the angle between two vectors
-    inline T angle(const Vec3<T> &other) {
-        return std::acos(dot(other) / (magnitude() * other.magnitude()));
+    // Calls f(i) for every i in [From, To), unrolled so every index is a constant after inlining
+    template<std::size_t From, std::size_t To, typename F>
+    static constexpr void unroll(F &&f) {
+        [&]<std::size_t... I>(std::index_sequence<I...>) { (f(From + I), ...); }(std::make_index_sequence<To - From>{});
     }
 
-    // Returns the angle between two vectors in radians
-    inline T angle_rad(const Vec3<T> &other) {
-        return std::acos(dot(other) / (magnitude() * other.magnitude()));
-    }
-    
-    // Returns the angle between two vectors in degrees
-    inline T angle_deg(const Vec3<T> &other) {
-        return std::acos(dot(other) / (magnitude() * other.magnitude())) * 180 / M_PI;
+    // Returns the component at index, no bounds checking
+    constexpr T& get(std::size_t index) {
+        if constexpr (N >= 2 && N <= 6) {
+            return this->*VecStorage<T, N>::members[index];
+        } else {
+            return this->e[index];
+        }
     }
-};
 
-/**
- * @brief A vector4
- * 
- * @tparam T Type of the vector4
- */
-template<typename T>
-struct Vec4 {
-    T x;
-    T y;
-    T z;
-    T w;
-
-    inline const Vec4<T> operator + (Vec4<T> other) { return {x + other.x, y + other.y, z + other.z, w + other.w }; };
-    inline const Vec4<T> operator - (Vec4<T> other) { return {x - other.x, y - other.y, z - other.z, w - other.w }; };
-    inline const Vec4<T> operator * (Vec4<T> other) { return {x * other.x, y * other.y, z * other.z, w * other.w }; };
-    inline const Vec4<T> operator / (Vec4<T> other) { return {x / other.x, y / other.y, z / other.z, w / other.w }; };
-
-    inline T& operator [] (int index) {
-        switch(index) {
-            case 0:
-            return x;
-
-            case 1:
-            return y;
-
-            case 2:
-            return z;
-            
-            case 3:
-            return w;
-
-            default:
-            throw std::out_of_range("Out of range item");
-            return x;
+    constexpr const T& get(std::size_t index) const {
+        if constexpr (N >= 2 && N <= 6) {
+            return this->*VecStorage<T, N>::members[index];
+        } else {
+            return this->e[index];
         }
     }
 
-    inline friend std::ostream& operator<<(std::ostream& os, const Vec4<T>& vec)
-    {
-        os << vec.x << ", " << vec.y << ", " << vec.z << ", " << vec.w;
-        return os;
+    constexpr T& operator [] (int index) {
+        if (index < 0 || (std::size_t)index >= N) {
+            throw std::out_of_range("Out of range item");
+        }
+        return get((std::size_t)index);
     }
 
-
-    template <typename T2>
-    inline Vec4(const Vec4<T2> &other) {
-        this->x = (T)other.x;
-        this->y = (T)other.y;
-        this->z = (T)other.z;
-        this->w = (T)other.w;
-    }; 
-    
-    inline Vec4(const T x, const T y, const T z, const T w) {
-        this->x = x;
-        this->y = y;
-        this->z = z;
-        this->w = w;
-        return;
-    }
-    
-    inline Vec4(const T x, const T y, const T z) {
-        this->x = x;
-        this->y = y;
-        this->z = z;
-        this->w = (T)0;
-        return;
-    }
-
-    
-    inline Vec4(const T x, const T y) {
-        this->x = x;
-        this->y = y;
-        this->z = (T)0;
-        this->w = (T)0;
-        return;
-    }
-
-    inline Vec4(const T x) {
-        this->x = x;
-        this->y = (T)0;
-        this->z = (T)0;
-        this->w = (T)0;
-        return;
-    }
-
-    inline Vec4() {
-        this->x = (T)0;
-        this->y = (T)0;
-        this->z = (T)0;
-        this->w = (T)0;
-        return;
-    }
-
-    template <typename T2>
-    inline Vec4(const Vec3<T2> &other) {
-        this->x = (T)other.x;
-        this->y = (T)other.y;
-        this->z = (T)other.z;
-        this->w = (T)0;
-    };
-
-    template <typename T2>
-    inline Vec4(const Vec2<T2> &other) {
-        this->x = (T)other.x;
-        this->y = (T)other.y;
-        this->z = (T)0;
-        this->w = (T)0;
-    };
-
-    // Returns the dot product of two vectors
-    inline T dot(const Vec4<T> &other) {
-        return x * other.x + y * other.y + z * other.z + w * other.w;
+    constexpr const T& operator [] (int index) const {
+        if (index < 0 || (std::size_t)index >= N) {
+            throw std::out_of_range("Out of range item");
+        }
+        return get((std::size_t)index);
     }
 
-    // Returns the cross product of two vectors
-    inline Vec4<T> cross(const Vec4<T> &other) {
-        return {y * other.z - z * other.y, z * other.x - x * other.z, x * other.y - y * other.x, w * other.w};
-    }
-    
-    // Returns the magnitude of the vector
-    inline T magnitude() {
-        return std::sqrt(x * x + y * y + z * z + w * w);
-    }
-    
-    // Returns the normalized vector
-    inline Vec4<T> normalize() {
-        T mag = magnitude();
-        return {x / mag, y / mag, z / mag, w / mag};
-    }
+    constexpr Vec() = default;
 
-    // Returns the length of the vector
-    inline T length() {
-        return std::sqrt(x * x + y * y + z * z + w * w);
+    // Takes up to N components, the rest is zero
+    template<typename... Args>
+    requires (sizeof...(Args) >= 1 && sizeof...(Args) <= N && (std::is_convertible_v<Args, T> && ...))
+    constexpr Vec(const Args... args) {
+        std::size_t i = 0;
+        ((get(i++) = (T)args), ...);
     }
 
-    // Returns the distance between two vectors
-    inline T distance(const Vec4<T> &other) {
-        return std::sqrt(std::pow(x - other.x, 2) + std::pow(y - other.y, 2) + std::pow(z - other.z, 2) + std::pow(w - other.w, 2));
+    // Converts from a vector of another type and/or smaller size, missing components are zero
+    template<typename T2, std::size_t M>
+    requires (M <= N)
+    constexpr Vec(const Vec<T2, M> &other) {
+        unroll<0, M>([&](std::size_t i) { get(i) = (T)other.get(i); });
     }
 
-    // Returns the angle between two vectors
-    inline T angle(const Vec4<T> &other) {
-        return std::acos(dot(other) / (magnitude() * other.magnitude()));
+    // Evaluates an expression in a single pass
+    template<typename E>
+    requires (vecexpr::is_expr<E> && E::size == N)
+    constexpr Vec(const E &expr) {
+        unroll<0, N>([&](std::size_t i) { get(i) = (T)expr[i]; });
     }
 
-    // Returns the angle between two vectors in radians
-    inline T angle_rad(const Vec4<T> &other) {
-        return std::acos(dot(other) / (magnitude() * other.magnitude()));
-    }
-    
-    // Returns the angle between two vectors in degrees
-    inline T angle_deg(const Vec4<T> &other) {
-        return std::acos(dot(other) / (magnitude() * other.magnitude())) * 180 / M_PI;
+    constexpr Vec<T, N> operator + (const Vec<T, N> &other) const {
+        Vec<T, N> out;
+        if constexpr (N == 4) {
+            if (!std::is_constant_evaluated()) {
+                simd::vec4<T>::add(&this->x, &other.x, &out.x);
+                return out;
+            }
+        }
+        unroll<0, N>([&](std::size_t i) { out.get(i) = get(i) + other.get(i); });
+        return out;
     }
-};
 
-/**
- * @brief A vector5
- * 
- * @tparam T Type of the vector5
- */
-template<typename T>
-struct Vec5 {
-    T x;
-    T y;
-    T z;
-    T w;
-    T v;
-    
-    inline const Vec5<T> operator + (Vec5<T> other) { return {x + other.x, y + other.y, z + other.z, w + other.w, v + other.v }; };
-    inline const Vec5<T> operator - (Vec5<T> other) { return {x - other.x, y - other.y, z - other.z, w - other.w, v - other.v }; };
-    inline const Vec5<T> operator * (Vec5<T> other) { return {x * other.x, y * other.y, z * other.z, w * other.w, v * other.v }; };
-    inline const Vec5<T> operator / (Vec5<T> other) { return {x / other.x, y / other.y, z / other.z, w / other.w, v / other.v }; };
-
-    inline T& operator [] (int index) {
-        switch(index) {
-            case 0:
-            return x;
-
-            case 1:
-            return y;
-
-            case 2:
-            return z;
-            
-            case 3:
-            return w;
-
-            case 4:
-            return v;
-
-            default:
-            throw std::out_of_range("Out of range item");
-            return x;
+    constexpr Vec<T, N> operator - (const Vec<T, N> &other) const {
+        Vec<T, N> out;
+        if constexpr (N == 4) {
+            if (!std::is_constant_evaluated()) {
+                simd::vec4<T>::sub(&this->x, &other.x, &out.x);
+                return out;
+            }
         }
+        unroll<0, N>([&](std::size_t i) { out.get(i) = get(i) - other.get(i); });
+        return out;
     }
 
-    inline friend std::ostream& operator<<(std::ostream& os, const Vec5<T>& vec)
-    {
-        os << vec.x << ", " << vec.y << ", " << vec.z << ", " << vec.w << ", " << vec.v;
-        return os;
+    constexpr Vec<T, N> operator * (const Vec<T, N> &other) const {
+        Vec<T, N> out;
+        if constexpr (N == 4) {
+            if (!std::is_constant_evaluated()) {
+                simd::vec4<T>::mul(&this->x, &other.x, &out.x);
+                return out;
+            }
+        }
+        unroll<0, N>([&](std::size_t i) { out.get(i) = get(i) * other.get(i); });
+        return out;
     }
 
-
-    template <typename T2>
-    inline Vec5(const Vec5<T2> &other) {
-        this->x = (T)other.x;
-        this->y = (T)other.y;
-        this->z = (T)other.z;
-        this->w = (T)other.w;
-        this->v = (T)other.v;
-    }; 
-    
-    inline Vec5(const T x, const T y, const T z, const T w, const T v) {
-        this->x = x;
-        this->y = y;
-        this->z = z;
-        this->w = w;
-        this->v = v;
-        return;
-    }
-
-    inline Vec5(const T x, const T y, const T z, const T w) {
-        this->x = x;
-        this->y = y;
-        this->z = z;
-        this->w = w;
-        return;
-    }
-    
-    inline Vec5(const T x, const T y, const T z) {
-        this->x = x;
-        this->y = y;
-        this->z = z;
-        this->w = (T)0;
-        this->v = (T)0;
-        return;
-    }
-
-    
-    inline Vec5(const T x, const T y) {
-        this->x = x;
-        this->y = y;
-        this->z = (T)0;
-        this->w = (T)0;
-        this->v = (T)0;
-        return;
-    }
-
-    inline Vec5(const T x) {
-        this->x = x;
-        this->y = (T)0;
-        this->z = (T)0;
-        this->w = (T)0;
-        return;
-    }
-
-    inline Vec5() {
-        this->x = (T)0;
-        this->y = (T)0;
-        this->z = (T)0;
-        this->w = (T)0;
-        this->v = (T)0;
-        return;
-    }
-
-    template <typename T2>
-    inline Vec5(const Vec4<T2> &other) {
-        this->x = (T)other.x;
-        this->y = (T)other.y;
-        this->z = (T)other.z;
-        this->w = (T)other.w;
-        this->v = (T)0;
-    };
-
-    template <typename T2>
-    inline Vec5(const Vec3<T2> &other) {
-        this->x = (T)other.x;
-        this->y = (T)other.y;
-        this->z = (T)other.z;
-        this->w = (T)0;
-        this->v = (T)0;
-    };
-
-    template <typename T2>
-    inline Vec5(const Vec2<T2> &other) {
-        this->x = (T)other.x;
-        this->y = (T)other.y;
-        this->z = (T)0;
-        this->w = (T)0;
-        this->v = (T)0;
-    };
-
-    // Returns the dot product of two vectors
-    inline T dot(const Vec5<T> &other) {
-        return x * other.x + y * other.y + z * other.z + w * other.w + v * other.v;
+    constexpr Vec<T, N> operator / (const Vec<T, N> &other) const {
+        Vec<T, N> out;
+        if constexpr (N == 4) {
+            if (!std::is_constant_evaluated()) {
+                simd::vec4<T>::div(&this->x, &other.x, &out.x);
+                return out;
+            }
+        }
+        unroll<0, N>([&](std::size_t i) { out.get(i) = get(i) / other.get(i); });
+        return out;
     }
 
-    // Returns the cross product of two vectors
-    inline Vec5<T> cross(const Vec5<T> &other) {
-        return {y * other.z - z * other.y, z * other.x - x * other.z, x * other.y - y * other.x, w * other.w, v * other.v};
-    }
-    
-    // Returns the magnitude of the vector
-    inline T magnitude() {
-        return std::sqrt(x * x + y * y + z * z + w * w + v * v);
-    }
-    
-    // Returns the normalized vector
-    inline Vec5<T> normalize() {
-        T mag = magnitude();
-        return {x / mag, y / mag, z / mag, w / mag, v / mag};
+    constexpr Vec<T, N> operator * (T scalar) const {
+        Vec<T, N> out;
+        unroll<0, N>([&](std::size_t i) { out.get(i) = get(i) * scalar; });
+        return out;
     }
 
-    // Returns the length of the vector
-    inline T length() {
-        return std::sqrt(x * x + y * y + z * z + w * w + v * v);
+    constexpr Vec<T, N> operator / (T scalar) const {
+        Vec<T, N> out;
+        unroll<0, N>([&](std::size_t i) { out.get(i) = get(i) / scalar; });
+        return out;
     }
 
-    // Returns the distance between two vectors
-    inline T distance(const Vec5<T> &other) {
-        return std::sqrt(std::pow(x - other.x, 2) + std::pow(y - other.y, 2) + std::pow(z - other.z, 2) + std::pow(w - other.w, 2) + std::pow(v - other.v, 2));
+    constexpr Vec<T, N> operator - () const {
+        Vec<T, N> out;
+        unroll<0, N>([&](std::size_t i) { out.get(i) = -get(i); });
+        return out;
     }
 
-    // Returns the angle between two vectors
-    inline T angle(const Vec5<T> &other) {
-        return std::acos(dot(other) / (magnitude() * other.magnitude()));
-    }
+    constexpr Vec<T, N>& operator += (const Vec<T, N> &other) { return *this = *this + other; };
+    constexpr Vec<T, N>& operator -= (const Vec<T, N> &other) { return *this = *this - other; };
+    constexpr Vec<T, N>& operator *= (const Vec<T, N> &other) { return *this = *this * other; };
+    constexpr Vec<T, N>& operator /= (const Vec<T, N> &other) { return *this = *this / other; };
+    constexpr Vec<T, N>& operator *= (T scalar) { return *this = *this * scalar; };
+    constexpr Vec<T, N>& operator /= (T scalar) { return *this = *this / scalar; };
 
-    // Returns the angle between two vectors in radians
-    inline T angle_rad(const Vec5<T> &other) {
-        return std::acos(dot(other) / (magnitude() * other.magnitude()));
+    constexpr bool operator == (const Vec<T, N> &other) const {
+        bool equal = true;
+        unroll<0, N>([&](std::size_t i) { equal = equal && get(i) == other.get(i); });
+        return equal;
     }
 
-    // Returns the angle between two vectors in degrees
-    inline T angle_deg(const Vec5<T> &other) {
-        return std::acos(dot(other) / (magnitude() * other.magnitude())) * 180 / M_PI;
+    // Returns whether every component is within max(absolute, relative * max(|a|, |b|)) of the other
+    constexpr bool approx_equal(const Vec<T, N> &other, T relative = math::default_epsilon<T>, T absolute = math::default_epsilon<T>) const requires std::floating_point<T> {
+        bool equal = true;
+        unroll<0, N>([&](std::size_t i) { equal = equal && math::relative_equal(get(i), other.get(i), relative, absolute); });
+        return equal;
     }
-};
 
-template <typename T>
-struct Vec6 {
-    T x;
-    T y;
-    T z;
-    T w;
-    T v;
-    T u;
-    
-    inline const Vec6<T> operator + (Vec6<T> other) { return {x + other.x, y + other.y, z + other.z, w + other.w, v + other.v, u + other.u }; };
-    inline const Vec6<T> operator - (Vec6<T> other) { return {x - other.x, y - other.y, z - other.z, w - other.w, v - other.v, u - other.u }; };
-    inline const Vec6<T> operator * (Vec6<T> other) { return {x * other.x, y * other.y, z * other.z, w * other.w, v * other.v, u * other.u }; };
-    inline const Vec6<T> operator / (Vec6<T> other) { return {x / other.x, y / other.y, z / other.z, w / other.w, v / other.v, u / other.u }; };
-
-    inline T& operator [] (int index) {
-        switch(index) {
-            case 0:
-            return x;
-
-            case 1:
-            return y;
-
-            case 2:
-            return z;
-            
-            case 3:
-            return w;
-
-            case 4:
-            return v;
-
-            case 5:
-            return u;
-
-            default:
-            throw std::out_of_range("Out of range item");
-            return x;
-        }
+    // Returns whether every component is at most max_ulps representable values from the other
+    constexpr bool ulp_equal(const Vec<T, N> &other, std::uint64_t max_ulps = 4) const requires (std::same_as<T, float> || std::same_as<T, double>) {
+        bool equal = true;
+        unroll<0, N>([&](std::size_t i) { equal = equal && math::ulp_equal(get(i), other.get(i), max_ulps); });
+        return equal;
     }
 
-    inline friend std::ostream& operator<<(std::ostream& os, const Vec6<T>& vec)
+    inline friend std::ostream& operator<<(std::ostream& os, const Vec<T, N>& vec)
     {
-        os << vec.x << ", " << vec.y << ", " << vec.z << ", " << vec.w << ", " << vec.v << ", " << vec.u;
+        for (std::size_t i = 0; i < N; i++) {
+            os << vec.get(i) << (i + 1 < N ? ", " : "");
+        }
         return os;
     }
 
-
-    template <typename T2>
-    inline Vec6(const Vec6<T2> &other) {
-        this->x = (T)other.x;
-        this->y = (T)other.y;
-        this->z = (T)other.z;
-        this->w = (T)other.w;
-        this->v = (T)other.v;
-        this->u = (T)other.u;
-    }; 
-    
-    inline Vec6(const T x, const T y, const T z, const T w, const T v, const T u) {
-        this->x = x;
-        this->y = y;
-        this->z = z;
-        this->w = w;
-        this->v = v;
-        this->u = u;
-        return;
-    }
-
-    inline Vec6(const T x, const T y, const T z, const T w, const T v) {
-        this->x = x;
-        this->y = y;
-        this->z = z;
-        this->w = w;
-        this->v = v;
-        this->u = (T)0;
-        return;
-    }
-
-    inline Vec6(const T x, const T y, const T z, const T w) {
-        this->x = x;
-        this->y = y;
-        this->z = z;
-        this->w = w;
-        this->v = (T)0;
-        this->u = (T)0;
-        return;
-    }
-    
-    inline Vec6(const T x, const T y, const T z) {
-        this->x = x;
-        this->y = y;
-        this->z = z;
-        this->w = (T)0;
-        this->v = (T)0;
-        this->u = (T)0;
-        return;
-    }
-
-    
-    inline Vec6(const T x, const T y) {
-        this->x = x;
-        this->y = y;
-        this->z = (T)0;
-        this->w = (T)0;
-        this->v = (T)0;
-        this->u = (T)0;
-        return;
-    }
-
-    inline Vec6(const T x) {
-        this->x = x;
-        this->y = (T)0;
-        this->z = (T)0;
-        this->w = (T)0;
-        this->v = (T)0;
-        this->u = (T)0;
-        return;
-    }
-
-    inline Vec6() {
-        this->x = (T)0;
-        this->y = (T)0;
-        this->z = (T)0;
-        this->w = (T)0;
-        this->v = (T)0;
-        this->u = (T)0;
-        return;
-    }
-
-    template <typename T2>
-    inline Vec6(const Vec5<T2> &other) {
-        this->x = (T)other.x;
-        this->y = (T)other.y;
-        this->z = (T)other.z;
-        this->w = (T)other.w;
-        this->v = (T)other.v;
-        this->u = (T)0;
-    };
-
-    template <typename T2>
-    inline Vec6(const Vec4<T2> &other) {
-        this->x = (T)other.x;
-        this->y = (T)other.y;
-        this->z = (T)other.z;
-        this->w = (T)other.w;
-        this->v = (T)0;
-        this->u = (T)0;
-    };
-
-    template <typename T2>
-    inline Vec6(const Vec3<T2> &other) {
-        this->x = (T)other.x;
-        this->y = (T)other.y;
-        this->z = (T)other.z;
-        this->w = (T)0;
-        this->v = (T)0;
-        this->u = (T)0;
-    };
-
-    template <typename T2>
-    inline Vec6(const Vec2<T2> &other) {
-        this->x = (T)other.x;
-        this->y = (T)other.y;
-        this->z = (T)0;
-        this->w = (T)0;
-        this->v = (T)0;
-        this->u = (T)0;
-    };
+    // Returns the xyz part of a padded vector
+    constexpr Vec<T, 3> xyz() const requires (N >= 3) {
+        return {this->x, this->y, this->z};
+    }
 
     // Returns the dot product of two vectors
-    inline T dot(const Vec6<T> &other) {
-        return x * other.x + y * other.y + z * other.z + w * other.w + v * other.v + u * other.u;
+    constexpr T dot(const Vec<T, N> &other) const {
+        // Types like Fixed sum the products at double width and round once
+        if constexpr (requires (T a) { T::from_product(T::accumulate(T::product(a, a), T::product(a, a))); }) {
+            auto sum = T::product(get(0), other.get(0));
+            unroll<1, N>([&](std::size_t i) { sum = T::accumulate(sum, T::product(get(i), other.get(i))); });
+            return T::from_product(sum);
+        }
+        if constexpr (N == 4) {
+            if (!std::is_constant_evaluated()) {
+                return simd::vec4<T>::dot(&this->x, &other.x);
+            }
+        }
+        T sum = get(0) * other.get(0);
+        unroll<1, N>([&](std::size_t i) { sum += get(i) * other.get(i); });
+        return sum;
+    }
+
+    // Returns the cross product of two vectors, components past z are multiplied
+    constexpr Vec<T, N> cross(const Vec<T, N> &other) const requires (N >= 2) {
+        Vec<T, N> out;
+        if constexpr (N == 2) {
+            out.x = this->y * other.x - this->x * other.y;
+            out.y = this->x * other.y - this->y * other.x;
+        } else {
+            if constexpr (N == 4) {
+                if (!std::is_constant_evaluated()) {
+                    simd::vec4<T>::cross(&this->x, &other.x, &out.x);
+                    return out;
+                }
+            }
+            out.get(0) = get(1) * other.get(2) - get(2) * other.get(1);
+            out.get(1) = get(2) * other.get(0) - get(0) * other.get(2);
+            out.get(2) = get(0) * other.get(1) - get(1) * other.get(0);
+            unroll<3, N>([&](std::size_t i) { out.get(i) = get(i) * other.get(i); });
+        }
+        return out;
     }
 
-    // Returns the cross product of two vectors
-    inline Vec6<T> cross(const Vec6<T> &other) {
-        return {y * other.z - z * other.y, z * other.x - x * other.z, x * other.y - y * other.x, w * other.w, v * other.v, u * other.u};
+    // Returns the squared length of the vector
+    constexpr T length_squared() const {
+        return dot(*this);
     }
-    
+
     // Returns the magnitude of the vector
-    inline T magnitude() {
-        return std::sqrt(x * x + y * y + z * z + w * w + v * v + u * u);
+    constexpr T magnitude() const {
+        return vecexpr::sqrt(dot(*this));
     }
-    
+
     // Returns the normalized vector
-    inline Vec6<T> normalize() {
-        T mag = magnitude();
-        return {x / mag, y / mag, z / mag, w / mag, v / mag, u / mag};
+    constexpr Vec<T, N> normalize() const {
+        if constexpr (N == 4 && std::is_arithmetic_v<T>) {
+            if (!std::is_constant_evaluated()) {
+                Vec<T, N> out;
+                simd::vec4<T>::normalize(&this->x, &out.x);
+                return out;
+            }
+        }
+        return *this / magnitude();
+    }
+
+    // Returns the normalized vector using simd::rsqrt with Steps Newton-Raphson steps, exact at compile time
+    template<int Steps = simd::rsqrt_steps<T>>
+    constexpr Vec<T, N> normalize_fast() const {
+        if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>) {
+            if (!std::is_constant_evaluated()) {
+                return *this * simd::rsqrt<T, Steps>(dot(*this));
+            }
+        }
+        return normalize();
     }
 
     // Returns the length of the vector
-    inline T length() {
-        return std::sqrt(x * x + y * y + z * z + w * w + v * v + u * u);
+    constexpr T length() const {
+        return magnitude();
     }
 
     // Returns the distance between two vectors
-    inline T distance(const Vec6<T> &other) {
-        return std::sqrt(std::pow(x - other.x, 2) + std::pow(y - other.y, 2) + std::pow(z - other.z, 2) + std::pow(w - other.w, 2) + std::pow(v - other.v, 2) + std::pow(u - other.u, 2));
+    constexpr T distance(const Vec<T, N> &other) const {
+        if constexpr (N == 4 && std::is_arithmetic_v<T>) {
+            if (!std::is_constant_evaluated()) {
+                return simd::vec4<T>::distance(&this->x, &other.x);
+            }
+        }
+        return (*this - other).magnitude();
     }
 
     // Returns the angle between two vectors
-    inline T angle(const Vec6<T> &other) {
+    inline T angle(const Vec<T, N> &other) const {
         return std::acos(dot(other) / (magnitude() * other.magnitude()));
     }
 
     // Returns the angle between two vectors in radians
-    inline T angle_rad(const Vec6<T> &other) {
+    inline T angle_rad(const Vec<T, N> &other) const {
         return std::acos(dot(other) / (magnitude() * other.magnitude()));
     }
 
     // Returns the angle between two vectors in degrees
-    inline T angle_deg(const Vec6<T> &other) {
+    inline T angle_deg(const Vec<T, N> &other) const {
         return std::acos(dot(other) / (magnitude() * other.magnitude())) * 180 / M_PI;
     }
 };
 
+template<typename T, std::size_t N>
+constexpr Vec<T, N> operator * (T scalar, const Vec<T, N> &vec) {
+    return vec * scalar;
+}
+
+template<typename T> using Vec2 = Vec<T, 2>;
+template<typename T> using Vec3 = Vec<T, 3>;
+template<typename T> using Vec4 = Vec<T, 4>;
+template<typename T> using Vec5 = Vec<T, 5>;
+template<typename T> using Vec6 = Vec<T, 6>;
 
 
 using vec2s  = Vec2<short int>;
@@ -949,6 +654,10 @@ using float4  = Vec4<float>;
 using double4  = Vec4<double>;
 using long_double4 = Vec4<long double>;
 
+// Padded 3 component vectors, keep w at zero and the SIMD Vec4 paths give 3D results
+using float3a  = Vec4<float>;
+using double3a  = Vec4<double>;
+
 using int5  = Vec5<int>;
 using long5  = Vec5<long>;
 using float5  = Vec5<float>;
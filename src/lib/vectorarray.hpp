@@ -0,0 +1,396 @@
+#ifndef VECTORARRAYHPP
+#define VECTORARRAYHPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "fastmath.hpp"
+#include "math.hpp"
+#include "simd.hpp"
+#include "vector.hpp"
+
+namespace soa {
+
+    template<typename T>
+    using lane = std::vector<T, simd::aligned_allocator<T>>;
+}
+
+/**
+ * @brief A structure-of-arrays container of vectors, every component is stored in its own aligned lane
+ *
+ * @tparam T Type of the components
+ * @tparam N Number of components
+ */
+template<typename T, std::size_t N>
+struct VecArray {
+    using value_type = Vec<T, N>;
+
+    std::array<soa::lane<T>, N> lanes;
+
+    inline VecArray() = default;
+
+    inline VecArray(std::size_t count) {
+        resize(count);
+    }
+
+    inline VecArray(std::span<const value_type> vecs) {
+        resize(vecs.size());
+        for (std::size_t i = 0; i < vecs.size(); i++) {
+            set(i, vecs[i]);
+        }
+    }
+
+    inline std::size_t size() const { return lanes[0].size(); };
+    inline bool empty() const { return lanes[0].empty(); };
+    inline static constexpr std::size_t dimensions() { return N; };
+
+    inline void resize(std::size_t count) {
+        for (auto &l : lanes) {
+            l.resize(count);
+        }
+    }
+
+    inline void reserve(std::size_t count) {
+        for (auto &l : lanes) {
+            l.reserve(count);
+        }
+    }
+
+    inline void clear() {
+        for (auto &l : lanes) {
+            l.clear();
+        }
+    }
+
+    // Returns the raw pointer to a lane
+    inline T* lane(std::size_t index) { return lanes[index].data(); };
+    inline const T* lane(std::size_t index) const { return lanes[index].data(); };
+
+    inline T* x() { return lane(0); };
+    inline T* y() { return lane(1); };
+    inline const T* x() const { return lane(0); };
+    inline const T* y() const { return lane(1); };
+    inline T* z() requires (N >= 3) { return lane(2); };
+    inline const T* z() const requires (N >= 3) { return lane(2); };
+    inline T* w() requires (N >= 4) { return lane(3); };
+    inline const T* w() const requires (N >= 4) { return lane(3); };
+
+    // Gathers the vector at index
+    inline value_type get(std::size_t index) const {
+        if (index >= size()) {
+            throw std::out_of_range("Out of range item");
+        }
+        value_type out;
+        for (std::size_t i = 0; i < N; i++) {
+            out.get(i) = lanes[i][index];
+        }
+        return out;
+    }
+
+    // Scatters a vector into index
+    inline void set(std::size_t index, value_type vec) {
+        if (index >= size()) {
+            throw std::out_of_range("Out of range item");
+        }
+        for (std::size_t i = 0; i < N; i++) {
+            lanes[i][index] = vec.get(i);
+        }
+    }
+
+    inline value_type operator [] (std::size_t index) const { return get(index); };
+
+    inline void push_back(value_type vec) {
+        for (std::size_t i = 0; i < N; i++) {
+            lanes[i].push_back(vec.get(i));
+        }
+    }
+
+    // Converts back to an array-of-structs layout
+    inline std::vector<value_type> to_vector() const {
+        std::vector<value_type> out(size());
+        for (std::size_t i = 0; i < size(); i++) {
+            for (std::size_t l = 0; l < N; l++) {
+                out[i].get(l) = lanes[l][i];
+            }
+        }
+        return out;
+    }
+};
+
+template<typename T> using Vec2Array = VecArray<T, 2>;
+template<typename T> using Vec3Array = VecArray<T, 3>;
+template<typename T> using Vec4Array = VecArray<T, 4>;
+
+using vec2farray = Vec2Array<float>;
+using vec2darray = Vec2Array<double>;
+using vec3farray = Vec3Array<float>;
+using vec3darray = Vec3Array<double>;
+using vec4farray = Vec4Array<float>;
+using vec4darray = Vec4Array<double>;
+
+// Bulk kernels over VecArray, the inner loops work on one lane at a time so the compiler can run them at full SIMD width
+namespace soa {
+
+    namespace detail {
+        template<typename T, std::size_t N>
+        inline void check_size(const VecArray<T, N> &a, std::size_t n) {
+            if (a.size() != n) {
+                throw std::invalid_argument("Array sizes do not match");
+            }
+        }
+
+        template<typename T, std::size_t N>
+        inline void prepare(VecArray<T, N> &out, std::size_t n) {
+            if (out.size() != n) {
+                out.resize(n);
+            }
+        }
+
+        template<typename T>
+        inline void prepare(std::span<T> out, std::size_t n) {
+            if (out.size() < n) {
+                throw std::invalid_argument("Output span too small");
+            }
+        }
+
+        // out may alias a or b, the operation is purely element wise
+        template<typename T, typename Op>
+        inline void lane_op(const T* a, const T* b, T* out, std::size_t n, Op op) {
+            for (std::size_t i = 0; i < n; i++) {
+                out[i] = op(a[i], b[i]);
+            }
+        }
+
+        // out = sum of a[l] * b[l] over every lane
+        template<typename T, std::size_t N>
+        inline void lane_dot(const VecArray<T, N> &a, const VecArray<T, N> &b, T* EXTLIB_RESTRICT out, std::size_t n) {
+            const T* EXTLIB_RESTRICT a0 = a.lane(0);
+            const T* EXTLIB_RESTRICT b0 = b.lane(0);
+            for (std::size_t i = 0; i < n; i++) {
+                out[i] = a0[i] * b0[i];
+            }
+            for (std::size_t l = 1; l < N; l++) {
+                const T* EXTLIB_RESTRICT al = a.lane(l);
+                const T* EXTLIB_RESTRICT bl = b.lane(l);
+                for (std::size_t i = 0; i < n; i++) {
+                    out[i] += al[i] * bl[i];
+                }
+            }
+        }
+    }
+
+    // out = a + b
+    template<typename T, std::size_t N>
+    inline void add(const VecArray<T, N> &a, const VecArray<T, N> &b, VecArray<T, N> &out) {
+        detail::check_size(b, a.size());
+        detail::prepare(out, a.size());
+        for (std::size_t l = 0; l < N; l++) {
+            detail::lane_op(a.lane(l), b.lane(l), out.lane(l), a.size(), [](T x, T y) { return x + y; });
+        }
+    }
+
+    // out = a - b
+    template<typename T, std::size_t N>
+    inline void sub(const VecArray<T, N> &a, const VecArray<T, N> &b, VecArray<T, N> &out) {
+        detail::check_size(b, a.size());
+        detail::prepare(out, a.size());
+        for (std::size_t l = 0; l < N; l++) {
+            detail::lane_op(a.lane(l), b.lane(l), out.lane(l), a.size(), [](T x, T y) { return x - y; });
+        }
+    }
+
+    // out = a * b, component wise
+    template<typename T, std::size_t N>
+    inline void mul(const VecArray<T, N> &a, const VecArray<T, N> &b, VecArray<T, N> &out) {
+        detail::check_size(b, a.size());
+        detail::prepare(out, a.size());
+        for (std::size_t l = 0; l < N; l++) {
+            detail::lane_op(a.lane(l), b.lane(l), out.lane(l), a.size(), [](T x, T y) { return x * y; });
+        }
+    }
+
+    // out = a / b, component wise
+    template<typename T, std::size_t N>
+    inline void div(const VecArray<T, N> &a, const VecArray<T, N> &b, VecArray<T, N> &out) {
+        detail::check_size(b, a.size());
+        detail::prepare(out, a.size());
+        for (std::size_t l = 0; l < N; l++) {
+            detail::lane_op(a.lane(l), b.lane(l), out.lane(l), a.size(), [](T x, T y) { return x / y; });
+        }
+    }
+
+    // out = a * scalar
+    template<typename T, std::size_t N>
+    inline void scale(const VecArray<T, N> &a, T scalar, VecArray<T, N> &out) {
+        detail::prepare(out, a.size());
+        for (std::size_t l = 0; l < N; l++) {
+            const T* in = a.lane(l);
+            T* o = out.lane(l);
+            for (std::size_t i = 0; i < a.size(); i++) {
+                o[i] = in[i] * scalar;
+            }
+        }
+    }
+
+    // out[i] = dot(a[i], b[i])
+    template<typename T, std::size_t N>
+    inline void dot(const VecArray<T, N> &a, const VecArray<T, N> &b, std::span<T> out) {
+        detail::check_size(b, a.size());
+        detail::prepare(out, a.size());
+        detail::lane_dot(a, b, out.data(), a.size());
+    }
+
+    // out[i] = cross(a[i], b[i])
+    template<typename T>
+    inline void cross(const VecArray<T, 3> &a, const VecArray<T, 3> &b, VecArray<T, 3> &out) {
+        detail::check_size(b, a.size());
+        if (&out == &a || &out == &b) {
+            // Aliased output, go through a temporary
+            VecArray<T, 3> tmp;
+            cross(a, b, tmp);
+            out = std::move(tmp);
+            return;
+        }
+        detail::prepare(out, a.size());
+        const std::size_t n = a.size();
+        const T* EXTLIB_RESTRICT ax = a.x();
+        const T* EXTLIB_RESTRICT ay = a.y();
+        const T* EXTLIB_RESTRICT az = a.z();
+        const T* EXTLIB_RESTRICT bx = b.x();
+        const T* EXTLIB_RESTRICT by = b.y();
+        const T* EXTLIB_RESTRICT bz = b.z();
+        T* EXTLIB_RESTRICT ox = out.x();
+        T* EXTLIB_RESTRICT oy = out.y();
+        T* EXTLIB_RESTRICT oz = out.z();
+        for (std::size_t i = 0; i < n; i++) {
+            ox[i] = ay[i] * bz[i] - az[i] * by[i];
+            oy[i] = az[i] * bx[i] - ax[i] * bz[i];
+            oz[i] = ax[i] * by[i] - ay[i] * bx[i];
+        }
+    }
+
+    // out[i] = squared length of a[i]
+    template<typename T, std::size_t N>
+    inline void length_squared(const VecArray<T, N> &a, std::span<T> out) {
+        detail::prepare(out, a.size());
+        detail::lane_dot(a, a, out.data(), a.size());
+    }
+
+    // out[i] = length of a[i]
+    template<typename T, std::size_t N>
+    inline void length(const VecArray<T, N> &a, std::span<T> out) {
+        length_squared(a, out);
+        simd::sqrt(out.data(), a.size());
+    }
+
+    // out[i] = distance between a[i] and b[i]
+    template<typename T, std::size_t N>
+    inline void distance(const VecArray<T, N> &a, const VecArray<T, N> &b, std::span<T> out) {
+        detail::check_size(b, a.size());
+        detail::prepare(out, a.size());
+        const std::size_t n = a.size();
+        T* EXTLIB_RESTRICT o = out.data();
+        for (std::size_t i = 0; i < n; i++) {
+            o[i] = (T)0;
+        }
+        for (std::size_t l = 0; l < N; l++) {
+            const T* EXTLIB_RESTRICT al = a.lane(l);
+            const T* EXTLIB_RESTRICT bl = b.lane(l);
+            for (std::size_t i = 0; i < n; i++) {
+                T d = al[i] - bl[i];
+                o[i] += d * d;
+            }
+        }
+        simd::sqrt(o, n);
+    }
+
+    // out[i] = normalized a[i], out may be a
+    template<typename T, std::size_t N>
+    inline void normalize(const VecArray<T, N> &a, VecArray<T, N> &out) {
+        const std::size_t n = a.size();
+        soa::lane<T> inv(n);
+        length(a, std::span<T>(inv.data(), n));
+        T* EXTLIB_RESTRICT s = inv.data();
+        for (std::size_t i = 0; i < n; i++) {
+            s[i] = (T)1 / s[i];
+        }
+        detail::prepare(out, n);
+        for (std::size_t l = 0; l < N; l++) {
+            detail::lane_op(a.lane(l), inv.data(), out.lane(l), n, [](T x, T y) { return x * y; });
+        }
+    }
+
+    // out[i] = normalized a[i] using simd::rsqrt with Steps Newton-Raphson steps, out may be a
+    template<int Steps = -1, typename T, std::size_t N>
+    inline void normalize_fast(const VecArray<T, N> &a, VecArray<T, N> &out) {
+        constexpr int steps = Steps < 0 ? simd::rsqrt_steps<T> : Steps;
+        const std::size_t n = a.size();
+        soa::lane<T> inv(n);
+        length_squared(a, std::span<T>(inv.data(), n));
+        simd::rsqrt<T, steps>(inv.data(), inv.data(), n);
+        detail::prepare(out, n);
+        for (std::size_t l = 0; l < N; l++) {
+            detail::lane_op(a.lane(l), inv.data(), out.lane(l), n, [](T x, T y) { return x * y; });
+        }
+    }
+    // out[i] = angle between a[i] and b[i] in radians, float and double only
+    template<typename T, std::size_t N>
+    inline void angle(const VecArray<T, N> &a, const VecArray<T, N> &b, std::span<T> out) {
+        detail::check_size(b, a.size());
+        detail::prepare(out, a.size());
+        const std::size_t n = a.size();
+        soa::lane<T> la(n);
+        soa::lane<T> lb(n);
+        length_squared(a, std::span<T>(la.data(), n));
+        length_squared(b, std::span<T>(lb.data(), n));
+        T* EXTLIB_RESTRICT o = out.data();
+        T* EXTLIB_RESTRICT l = la.data();
+        const T* EXTLIB_RESTRICT m = lb.data();
+        detail::lane_dot(a, b, o, n);
+        for (std::size_t i = 0; i < n; i++) {
+            l[i] *= m[i];
+        }
+        simd::sqrt(l, n);
+        // Rounding can push the cosine of nearly parallel vectors past 1
+        for (std::size_t i = 0; i < n; i++) {
+            o[i] = std::max((T)-1, std::min((T)1, o[i] / l[i]));
+        }
+        math::acos(std::span<const T>(o, n), std::span<T>(o, n));
+    }
+
+    // out[i] = angle between a[i] and b[i] in degrees, float and double only
+    template<typename T, std::size_t N>
+    inline void angle_deg(const VecArray<T, N> &a, const VecArray<T, N> &b, std::span<T> out) {
+        angle(a, b, out);
+        T* EXTLIB_RESTRICT o = out.data();
+        for (std::size_t i = 0; i < a.size(); i++) {
+            o[i] *= (T)(180 / 3.14159265358979323846);
+        }
+    }
+
+    // Compares a and b lane by lane with math::compare, first and max_index are vector indices
+    // mismatches counts components, a vector with two bad components counts twice
+    template<typename T, std::size_t N>
+    inline math::Comparison<T> compare(const VecArray<T, N> &a, const VecArray<T, N> &b, const math::Tolerance<T> &tolerance = {}) {
+        detail::check_size(b, a.size());
+        math::Comparison<T> out;
+        out.first = a.size();
+        for (std::size_t l = 0; l < N; l++) {
+            math::Comparison<T> lane = math::compare(std::span<const T>(a.lane(l), a.size()), std::span<const T>(b.lane(l), b.size()), tolerance);
+            out.first = std::min(out.first, lane.first);
+            out.mismatches += lane.mismatches;
+            if (lane.max_error > out.max_error) {
+                out.max_error = lane.max_error;
+                out.max_index = lane.max_index;
+            }
+            out.max_ulps = std::max(out.max_ulps, lane.max_ulps);
+        }
+        return out;
+    }
+}
+
+#endif
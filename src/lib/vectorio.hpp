@@ -0,0 +1,290 @@
+#ifndef VECTORIOHPP
+#define VECTORIOHPP
+
+#include <charconv>
+#include <cstddef>
+#include <fstream>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include "parallel.hpp"
+#include "vector.hpp"
+
+// Locale independent text formatting and parsing of vectors with to_chars/from_chars
+// Floats are written in their shortest form that parses back to the same value
+namespace vecio {
+
+    // Returns the most characters a single component of type T can take
+    template<typename T>
+    constexpr std::size_t max_chars() {
+        static_assert(std::is_arithmetic_v<T>, "Only arithmetic components can be formatted");
+        if constexpr (std::is_floating_point_v<T>) {
+            // Sign, digits, point, e, exponent sign and up to 4 exponent digits
+            return std::numeric_limits<T>::max_digits10 + 8;
+        } else {
+            return std::numeric_limits<T>::digits10 + 2;
+        }
+    }
+
+    // Returns the most characters a line with a Vec<T, N> can take, separators and newline included
+    template<typename T, std::size_t N>
+    constexpr std::size_t max_chars() {
+        return N * (max_chars<T>() + 1);
+    }
+
+    // Writes the components of vec separated by separator, returns the end of the written text
+    template<typename T, std::size_t N>
+    inline char* format(const Vec<T, N> &vec, char* first, char* last, char separator = ',') {
+        for (std::size_t i = 0; i < N; i++) {
+            if (i > 0) {
+                if (first == last) {
+                    throw std::invalid_argument("Output span too small");
+                }
+                *first++ = separator;
+            }
+            std::to_chars_result result = std::to_chars(first, last, vec.get(i));
+            if (result.ec != std::errc()) {
+                throw std::invalid_argument("Output span too small");
+            }
+            first = result.ptr;
+        }
+        return first;
+    }
+
+    // Writes one vector per line, returns the number of characters written
+    // max_chars<T, N>() * vecs.size() characters are always enough
+    template<typename T, std::size_t N>
+    inline std::size_t format(std::span<const Vec<T, N>> vecs, std::span<char> out, char separator = ',') {
+        char* first = out.data();
+        char* last = out.data() + out.size();
+        for (const Vec<T, N> &vec : vecs) {
+            first = format(vec, first, last, separator);
+            if (first == last) {
+                throw std::invalid_argument("Output span too small");
+            }
+            *first++ = '\n';
+        }
+        return (std::size_t)(first - out.data());
+    }
+
+    // Returns the vectors as text, one per line, formatted in parallel chunks
+    template<typename T, std::size_t N>
+    inline std::string format(std::span<const Vec<T, N>> vecs, char separator = ',', std::size_t threads = 0) {
+        const std::size_t count = parallel::chunks(vecs.size(), threads);
+        std::vector<std::string> parts(count);
+        parallel::for_chunks(vecs.size(), [&](std::size_t begin, std::size_t end, std::size_t chunk) {
+            std::string &part = parts[chunk];
+            part.resize((end - begin) * max_chars<T, N>());
+            part.resize(format(vecs.subspan(begin, end - begin), std::span<char>(part), separator));
+        }, count);
+        std::size_t size = 0;
+        for (const std::string &part : parts) {
+            size += part.size();
+        }
+        std::string out;
+        out.reserve(size);
+        for (const std::string &part : parts) {
+            out += part;
+        }
+        return out;
+    }
+
+    namespace detail {
+        constexpr bool is_space(char c) {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        constexpr bool is_separator(char c) {
+            return is_space(c) || c == ',' || c == ';';
+        }
+
+        constexpr bool is_number_start(char c) {
+            return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.';
+        }
+
+        template<typename T>
+        inline const char* parse_component(const char* first, const char* last, T &out) {
+            // from_chars does not take a leading +
+            if (first != last && *first == '+') {
+                first++;
+            }
+            std::from_chars_result result = std::from_chars(first, last, out);
+            if (result.ec != std::errc()) {
+                throw std::invalid_argument("Invalid vector component");
+            }
+            return result.ptr;
+        }
+    }
+
+    // Parses N components separated by spaces, tabs, commas or semicolons, returns the end of the parsed text
+    template<typename T, std::size_t N>
+    inline const char* parse(const char* first, const char* last, Vec<T, N> &out) {
+        for (std::size_t i = 0; i < N; i++) {
+            while (first != last && (detail::is_separator(*first) || (i == 0 && *first == '\n'))) {
+                first++;
+            }
+            first = detail::parse_component(first, last, out.get(i));
+        }
+        return first;
+    }
+
+    // Parses a single vector, only separators may follow it
+    template<typename T, std::size_t N>
+    inline Vec<T, N> parse(std::string_view text) {
+        Vec<T, N> out;
+        const char* end = parse(text.data(), text.data() + text.size(), out);
+        while (end != text.data() + text.size()) {
+            if (!detail::is_separator(*end) && *end != '\n') {
+                throw std::invalid_argument("Invalid vector");
+            }
+            end++;
+        }
+        return out;
+    }
+
+    // Parses one vector per line and appends them to out, returns the number of vectors added
+    // Lines that do not start with a number, like CSV headers and comments, are skipped and extra columns are ignored
+    template<typename T, std::size_t N>
+    inline std::size_t parse(std::string_view text, std::vector<Vec<T, N>> &out) {
+        const char* first = text.data();
+        const char* last = text.data() + text.size();
+        const std::size_t before = out.size();
+        while (first != last) {
+            const char* end = std::char_traits<char>::find(first, (std::size_t)(last - first), '\n');
+            if (end == nullptr) {
+                end = last;
+            }
+            const char* p = first;
+            while (p != end && detail::is_space(*p)) {
+                p++;
+            }
+            if (p != end && detail::is_number_start(*p)) {
+                Vec<T, N> vec;
+                parse(p, end, vec);
+                out.push_back(vec);
+            }
+            first = end == last ? last : end + 1;
+        }
+        return out.size() - before;
+    }
+
+    // Parses one vector per line like parse(text, out), splitting the text into line aligned chunks parsed in parallel
+    template<typename T, std::size_t N>
+    inline std::vector<Vec<T, N>> parse_points(std::string_view text, std::size_t threads = 0) {
+        const std::size_t count = parallel::chunks(text.size(), threads);
+        std::vector<std::vector<Vec<T, N>>> parts(count);
+        // Every chunk starts after the first newline at or past its nominal begin, so each line belongs to one chunk
+        auto line_start = [&](std::size_t pos) {
+            if (pos == 0) {
+                return pos;
+            }
+            std::size_t newline = text.find('\n', pos - 1);
+            return newline == std::string_view::npos ? text.size() : newline + 1;
+        };
+        parallel::for_chunks(text.size(), [&](std::size_t begin, std::size_t end, std::size_t chunk) {
+            begin = line_start(begin);
+            end = end == text.size() ? end : line_start(end);
+            if (begin < end) {
+                std::vector<Vec<T, N>> &part = parts[chunk];
+                // Points are rarely shorter than 2 characters per component
+                part.reserve((end - begin) / (N * 2 + 1));
+                parse(text.substr(begin, end - begin), part);
+            }
+        }, count);
+        std::size_t size = 0;
+        for (const std::vector<Vec<T, N>> &part : parts) {
+            size += part.size();
+        }
+        std::vector<Vec<T, N>> out;
+        out.reserve(size);
+        for (const std::vector<Vec<T, N>> &part : parts) {
+            out.insert(out.end(), part.begin(), part.end());
+        }
+        return out;
+    }
+
+    /**
+     * @brief Reads a CSV or XYZ point file block by block, every block is parsed in parallel chunks
+     *
+     * Components may be separated by spaces, tabs, commas or semicolons, one point per line.
+     * Header lines and columns after the first N are skipped.
+     *
+     * @tparam T Type of the components
+     * @tparam N Number of components
+     */
+    template<typename T, std::size_t N>
+    class PointReader {
+    public:
+        inline explicit PointReader(const std::string &path, std::size_t block = 16 << 20, std::size_t threads = 0)
+            : stream(path, std::ios::binary), block(block), threads(threads) {
+            if (!stream) {
+                throw std::runtime_error("Could not open " + path);
+            }
+        }
+
+        // Replaces out with the points of the next block, returns false once the file is exhausted
+        inline bool next(std::vector<Vec<T, N>> &out) {
+            out.clear();
+            while (out.empty()) {
+                if (!fill()) {
+                    return false;
+                }
+                std::size_t end = buffer.rfind('\n');
+                if (stream.eof()) {
+                    end = buffer.size();
+                } else if (end == std::string::npos) {
+                    // A single line longer than a block, read more
+                    continue;
+                } else {
+                    end++;
+                }
+                out = parse_points<T, N>(std::string_view(buffer).substr(0, end), threads);
+                // The partial last line moves to the front for the next block
+                buffer.erase(0, end);
+            }
+            return true;
+        }
+
+        // Reads every remaining point
+        inline std::vector<Vec<T, N>> read_all() {
+            std::vector<Vec<T, N>> out;
+            std::vector<Vec<T, N>> points;
+            while (next(points)) {
+                out.insert(out.end(), points.begin(), points.end());
+            }
+            return out;
+        }
+
+    private:
+        // Appends up to a block to the buffer, returns false when there is nothing left to parse
+        inline bool fill() {
+            if (stream.eof()) {
+                return !buffer.empty();
+            }
+            std::size_t size = buffer.size();
+            buffer.resize(size + block);
+            stream.read(buffer.data() + size, (std::streamsize)block);
+            buffer.resize(size + (std::size_t)stream.gcount());
+            return !buffer.empty();
+        }
+
+        std::ifstream stream;
+        std::string buffer;
+        std::size_t block;
+        std::size_t threads;
+    };
+
+    // Reads every point of a CSV or XYZ file
+    template<typename T, std::size_t N>
+    inline std::vector<Vec<T, N>> read_points(const std::string &path, std::size_t threads = 0) {
+        return PointReader<T, N>(path, 16 << 20, threads).read_all();
+    }
+}
+
+#endif
@@ -0,0 +1,89 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <span>
+#include <vector>
+
+#include "../lib/fastmath.hpp"
+
+// Accuracy checks for the fastmath kernels, exits with 1 when one fails
+// Usage: test
+
+namespace {
+
+    int failures = 0;
+
+    // Distance between got and the exact ref in units of the float ulp at ref
+    double ulp_error(float got, double ref) {
+        const float rounded = (float)ref;
+        const double ulp = (double)std::nextafter(std::fabs(rounded), INFINITY) - std::fabs((double)rounded);
+        return std::fabs((double)got - ref) / ulp;
+    }
+
+    template<typename Kernel, typename Reference>
+    void check_float(const char* name, const std::vector<float> &in, Kernel kernel, Reference reference, double limit) {
+        std::vector<float> out(in.size());
+        kernel(std::span<const float>(in), std::span<float>(out));
+        double worst = 0;
+        float at = 0;
+        for (std::size_t i = 0; i < in.size(); i++) {
+            const double error = ulp_error(out[i], reference((double)in[i]));
+            if (!(error <= worst)) {
+                worst = error;
+                at = in[i];
+            }
+        }
+        const bool pass = worst <= limit;
+        std::printf("%-6s %-32s %zu inputs, max %.3f ulp at %.9g\n", pass ? "ok" : "FAIL", name, in.size(), worst, at);
+        failures += pass ? 0 : 1;
+    }
+
+    // Floats within 256 ulp of every multiple of pi / 2 up to limit, where the range reduction cancels
+    std::vector<float> near_half_pi(float limit) {
+        std::vector<float> in;
+        for (int k = 1; k * 1.57079632679489661923 <= limit; k++) {
+            float x = (float)(k * 1.57079632679489661923);
+            for (int i = 0; i < 256; i++) {
+                x = std::nextafter(x, 0.0f);
+            }
+            for (int i = 0; i < 513 && x <= limit; i++, x = std::nextafter(x, limit)) {
+                in.push_back(x);
+                in.push_back(-x);
+            }
+        }
+        return in;
+    }
+
+    // Every stride-th float in [lo, hi]
+    std::vector<float> sweep(float lo, float hi, std::size_t stride) {
+        std::vector<float> in;
+        std::size_t i = 0;
+        for (float x = lo; x <= hi; x = std::nextafter(x, hi + 1), i++) {
+            if (i % stride == 0) {
+                in.push_back(x);
+                in.push_back(-x);
+            }
+        }
+        return in;
+    }
+
+    void fastmath_tests() {
+        auto sin = [](std::span<const float> in, std::span<float> out) { math::sin(in, out); };
+        auto cos = [](std::span<const float> in, std::span<float> out) { math::cos(in, out); };
+        auto ref_sin = [](double x) { return std::sin(x); };
+        auto ref_cos = [](double x) { return std::cos(x); };
+
+        const std::vector<float> near = near_half_pi(512);
+        check_float("sin near multiples of pi/2", near, sin, ref_sin, 1.6);
+        check_float("cos near multiples of pi/2", near, cos, ref_cos, 1.6);
+
+        const std::vector<float> all = sweep(0.01f, 512, 31);
+        check_float("sin over [0.01, 512]", all, sin, ref_sin, 1.6);
+        check_float("cos over [0.01, 512]", all, cos, ref_cos, 1.6);
+    }
+}
+
+int main() {
+    fastmath_tests();
+    return failures == 0 ? 0 : 1;
+}